@@ -0,0 +1,224 @@
+#!/bin/bash
+#
+# Benchmark of mfind over synthetic trees of different shapes (see genTree.c).
+# Each shape is searched with every thread count in THREADS, RUNS times after
+# one warm-up run. The fastest wall time is kept, as the one least disturbed
+# by other load, along with the counters of --stats and the number of system
+# calls of one more run under countSyscalls.c. The results are written as
+# JSON and compared with a stored baseline; the script fails if a wall time
+# or syscall count grew by more than TOLERANCE percent, if a count that only
+# depends on the tree changed, or if a syscall count is missing.
+#
+# Run with "make bench", or "make bench-baseline" to store a new baseline.
+# Wall times depend on the machine, so a baseline is only meaningful on the
+# machine that wrote it.
+#
+# Environment:
+# MFIND		The binary. Default is ../mfind, next to this directory.
+# BENCH_DIR	Where trees and results are kept. Default is /tmp/mfind-bench.
+#			Trees are only generated again when their shape changes.
+# THREADS	Thread counts to sweep. Default is "1 2 4 8".
+# RUNS		Runs of each search. Default is 5.
+# TOLERANCE	Allowed growth in percent. Default is 25.
+# BASELINE	The baseline. Default is baseline.json in this directory.
+# UPDATE	If 1, the results are stored as the baseline instead.
+# OPTS		More options for every search, e.g. "--inode-order".
+# COLD		If 1, the page, dentry and inode caches are dropped before each
+#			run, so that the tree is read from the disk. Needs root.
+#
+# Author: mfind contributors
+#
+# Final build: 2026-10-17
+
+HERE="$(cd "$(dirname "$0")" && pwd)"
+MFIND="${MFIND:-$HERE/../mfind}"
+GENTREE="$HERE/genTree"
+COUNTSYSCALLS="$HERE/countSyscalls"
+BENCH_DIR="${BENCH_DIR:-/tmp/mfind-bench}"
+THREADS="${THREADS:-1 2 4 8}"
+RUNS="${RUNS:-5}"
+TOLERANCE="${TOLERANCE:-25}"
+BASELINE="${BASELINE:-$HERE/baseline.json}"
+OPTS="${OPTS:-}"
+COLD="${COLD:-0}"
+RESULTS="$BENCH_DIR/results.json"
+
+# Wall times below this many ms over the baseline are noise, not regressions
+NOISE_MS=2
+
+# name and genTree options of each shape
+SHAPES=(
+	"deep		-d 12 -f 2 -n 3 -l 4:12 -s 1"
+	"wide		-d 2 -f 120 -n 6 -l 8:24 -s 1"
+	"giant		-d 0 -n 100000 -l 8:32 -s 1000"
+	"tiny		-d 6 -f 5 -n 0 -l 1:6"
+)
+
+# Generates a shape's tree, unless it exists with the same options.
+# $1 - name of the shape, $2... - genTree options
+genShape () {
+
+	local name="$1"
+	shift
+	if [ "$(cat "$BENCH_DIR/$name.opts" 2>/dev/null)" != "$*" ]; then
+
+		rm -rf "${BENCH_DIR:?}/$name" "$BENCH_DIR/$name.opts"
+		echo -n "generating $name: " >&2
+		"$GENTREE" "$@" "$BENCH_DIR/$name" >&2 || exit 1
+		echo "$*" > "$BENCH_DIR/$name.opts"
+	fi
+}
+
+# Prints the value of a number in a line of JSON.
+# $1 - the key, $2 - the line
+field () {
+
+	echo "$2" | sed -n "s/.*\"$1\": *\(-\?[0-9.]*\).*/\1/p"
+}
+
+# Drops the caches, with COLD=1, so that the next run reads from the disk.
+dropCaches () {
+
+	if [ "$COLD" = "1" ]; then
+
+		sync
+		if ! echo 3 > /proc/sys/vm/drop_caches; then
+
+			echo "COLD=1 needs root, to write /proc/sys/vm/drop_caches" >&2
+			exit 1
+		fi
+	fi
+}
+
+# Searches a shape with some threads, and prints the result as a JSON line.
+# $1 - name of the shape, $2 - number of threads
+runShape () {
+
+	local name="$1" p="$2" times=() i start end syscalls=-1
+	"$MFIND" -p "$p" $OPTS "$BENCH_DIR/$name" needle > /dev/null || exit 1
+	for ((i = 0; i < RUNS; i++)); do
+
+		dropCaches
+		start=$(date +%s%N)
+		"$MFIND" -p "$p" $OPTS --stats="$BENCH_DIR/stats.json" \
+			"$BENCH_DIR/$name" needle > /dev/null || exit 1
+		end=$(date +%s%N)
+		times+=($(( (end - start) / 1000 )))
+	done
+	local best
+	best=$(printf '%s\n' "${times[@]}" | sort -n | head -n 1)
+
+	syscalls=$("$COUNTSYSCALLS" "$MFIND" -p "$p" $OPTS "$BENCH_DIR/$name" \
+			   needle 2>&1 > /dev/null | tail -n 1)
+	if ! [ "$syscalls" -ge 0 ] 2>/dev/null; then
+
+		echo "$name -p$p: the system calls could not be counted" >&2
+		exit 1
+	fi
+
+	local stats total
+	stats=$(tr -d '\n' < "$BENCH_DIR/stats.json")
+	total=$(echo "$stats" | sed 's/.*"total": *{\([^}]*\)}.*/\1/')
+	printf '{"shape": "%s", "threads": %d, "wallMs": %d.%03d, ' "$name" "$p" \
+		   $(( best / 1000 )) $(( best % 1000 ))
+	printf '"dirsOpened": %s, "entries": %s, "statCalls": %s, ' \
+		   "$(field dirsOpened "$total")" "$(field entries "$total")" \
+		   "$(field statCalls "$total")"
+	printf '"matches": %s, "syscalls": %s}' "$(field matches "$total")" \
+		   "$syscalls"
+}
+
+# Compares the results with the baseline. Prints every regression.
+# return: 0 if there were none, else 1
+compare () {
+
+	local line base res=0 shape p key now old
+	while read -r line; do
+
+		shape=$(echo "$line" | sed -n 's/.*"shape": *"\([^"]*\)".*/\1/p')
+		[ -z "$shape" ] && continue
+		p=$(field threads "$line")
+		base=$(grep "\"shape\": \"$shape\", \"threads\": $p," "$BASELINE")
+		if [ -z "$base" ]; then
+
+			echo "$shape -p$p: not in baseline"
+			continue
+		fi
+		for key in dirsOpened entries matches; do
+
+			now=$(field $key "$line")
+			old=$(field $key "$base")
+			if [ "$now" != "$old" ]; then
+
+				echo "REGRESSION $shape -p$p: $key $old -> $now"
+				res=1
+			fi
+		done
+		if [ "$(field syscalls "$base")" -lt 0 ] 2>/dev/null; then
+
+			echo "$shape -p$p: no syscall count in baseline" \
+				 "(make bench-baseline)"
+			res=1
+		fi
+		for key in wallMs syscalls; do
+
+			now=$(field $key "$line")
+			old=$(field $key "$base")
+			if awk -v now="$now" -v old="$old" -v tol="$TOLERANCE" \
+				   -v noise="$NOISE_MS" -v key="$key" 'BEGIN {
+					if (old < 0) exit 1
+					if (key == "wallMs" && now - old <= noise) exit 1
+					exit !(now > old * (1 + tol / 100)) }'; then
+
+				echo "REGRESSION $shape -p$p: $key $old -> $now"
+				res=1
+			fi
+		done
+		printf '%-6s -p%-3s %10s ms (baseline %s)\n' "$shape" "$p" \
+			   "$(field wallMs "$line")" "$(field wallMs "$base")"
+	done < "$RESULTS"
+	return $res
+}
+
+if [ ! -x "$MFIND" ] || [ ! -x "$GENTREE" ] || [ ! -x "$COUNTSYSCALLS" ]; then
+
+	echo "Build $MFIND, $GENTREE and $COUNTSYSCALLS first (make bench)" >&2
+	exit 1
+fi
+mkdir -p "$BENCH_DIR" || exit 1
+for shape in "${SHAPES[@]}"; do
+
+	genShape $shape
+done
+
+{
+	echo "{"
+	echo "  \"results\": ["
+	first=1
+	for shape in "${SHAPES[@]}"; do
+
+		name=$(echo $shape | cut -d' ' -f1)
+		for p in $THREADS; do
+
+			record=$(runShape "$name" "$p") || exit 1
+			[ $first -eq 0 ] && echo ","
+			first=0
+			echo -n "    $record"
+		done
+	done
+	echo
+	echo "  ]"
+	echo "}"
+} > "$RESULTS" || exit 1
+
+if [ "$UPDATE" = "1" ]; then
+
+	cp "$RESULTS" "$BASELINE" && echo "Stored baseline $BASELINE"
+elif [ ! -f "$BASELINE" ]; then
+
+	cat "$RESULTS"
+	echo "No baseline at $BASELINE (make bench-baseline)" >&2
+else
+
+	compare
+fi
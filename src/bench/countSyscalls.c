@@ -0,0 +1,150 @@
+/*
+* countSyscalls - Runs a command and counts the system calls made by it and
+* every thread and process it starts, like "strace -f -c" but without needing
+* strace. Used by bench.sh.
+*
+* Synopsis: countSyscalls command [argument ...]
+*
+* The command's output is left as it is. When it has exited, the count is
+* printed as the last line on stderr, and countSyscalls exits with the
+* command's exit status. If the command cannot be traced, -1 is printed and
+* the exit status is 1.
+*
+* Author: mfind contributors
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+
+#define TRACE_OPTIONS (PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | \
+					   PTRACE_O_TRACEFORK | PTRACE_O_TRACEVFORK | \
+					   PTRACE_O_TRACEEXEC | PTRACE_O_EXITKILL)
+
+/*
+* description: Starts the command in a child that stops itself until the
+* tracer is attached.
+* param[in]: argv - The command and its arguments.
+* return: The child's pid, or -1 on failure.
+*/
+static pid_t countStart (char **argv) {
+
+	pid_t pid = fork();
+	if (pid == 0) {
+
+		if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) < 0) {
+
+			perror("ptrace");
+			_exit(127);
+		}
+		raise(SIGSTOP);
+		execvp(argv[0], argv);
+		perror(argv[0]);
+		_exit(127);
+	} else if (pid < 0) {
+
+		perror("fork");
+	}
+	return pid;
+}
+
+/*
+* description: Tells if a syscall stop is the entry of a call, rather than
+* its exit.
+* param[in]: pid - The stopped thread.
+* return: If it is an entry; 1, else 0.
+*/
+static int countIsEntry (pid_t pid) {
+
+	struct __ptrace_syscall_info info;
+	if (ptrace(PTRACE_GET_SYSCALL_INFO, pid, sizeof(info), &info) <= 0) {
+
+		return 0;
+	}
+	return info.op == PTRACE_SYSCALL_INFO_ENTRY;
+}
+
+/*
+* description: Follows the command and all its threads and children until
+* they have exited, counting the entries of system calls.
+* param[in]: child - The stopped command.
+* param[out]: status - The command's exit status.
+* return: The number of system calls, or -1 if the command could not be
+* traced.
+*/
+static long countTrace (pid_t child, int *status) {
+
+	int st;
+	if (waitpid(child, &st, 0) != child || !WIFSTOPPED(st) ||
+		ptrace(PTRACE_SETOPTIONS, child, NULL, TRACE_OPTIONS) < 0 ||
+		ptrace(PTRACE_SYSCALL, child, NULL, NULL) < 0) {
+
+		perror("ptrace");
+		kill(child, SIGKILL);
+		waitpid(child, NULL, 0);
+		return -1;
+	}
+
+	long calls = 0;
+	*status = 1;
+	for (;;) {
+
+		pid_t pid = waitpid(-1, &st, __WALL);
+		if (pid < 0) {
+
+			if (errno == EINTR) {
+
+				continue;
+			}
+			break;
+		}
+		if (WIFEXITED(st) || WIFSIGNALED(st)) {
+
+			if (pid == child) {
+
+				*status = WIFEXITED(st) ? WEXITSTATUS(st) :
+						  128 + WTERMSIG(st);
+			}
+			continue;
+		}
+		int sig = WSTOPSIG(st);
+		if (sig == (SIGTRAP | 0x80)) {
+
+			calls += countIsEntry(pid);
+			sig = 0;
+		} else if (sig == SIGTRAP && st >> 16 != 0) {
+
+			/* An event of a clone, fork, vfork or exec					*/
+			sig = 0;
+		} else if (sig == SIGSTOP) {
+
+			/* The first stop of a new thread or process					*/
+			sig = 0;
+		}
+		ptrace(PTRACE_SYSCALL, pid, NULL, (void *)(long)sig);
+	}
+	return calls;
+}
+
+int main (int argc, char **argv) {
+
+	if (argc < 2) {
+
+		fprintf(stderr, "Usage: %s command [argument ...]\n", argv[0]);
+		return 1;
+	}
+	pid_t child = countStart(argv + 1);
+	if (child < 0) {
+
+		fprintf(stderr, "-1\n");
+		return 1;
+	}
+	int status = 1;
+	long calls = countTrace(child, &status);
+	fprintf(stderr, "%ld\n", calls);
+	return calls < 0 ? 1 : status;
+}
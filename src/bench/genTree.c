@@ -0,0 +1,297 @@
+/*
+* genTree - Generates a synthetic directory tree for benchmarking mfind. The
+* tree depends only on the options and the seed, so two runs with the same
+* options create the same names in the same places.
+*
+* Synopsis: genTree [-d depth] [-f fanout] [-n files] [-l min:max]
+* [-s symlinks] [-e every] [-r seed] root
+*
+* -d		Levels of directories below the root. Default is 3.
+*
+* -f		Number of subdirectories of each directory above the deepest
+* level. Default is 4.
+*
+* -n		Number of files in each directory. Default is 8.
+*
+* -l		Lengths of names, drawn uniformly from min to max. Default is
+* 4:16.
+*
+* -s		Number of symbolic links in each directory, to files and
+* directories next to it. Every tenth is dangling. Default is 0.
+*
+* -e		Puts a file named "needle" in every n'th directory, as a target to
+* search for. Default is 97. If 0, no needles are created.
+*
+* -r		Seed of the random names. Default is 1.
+*
+* root		Directory to create the tree in. Must not exist.
+*
+* On success, prints the number of directories, files and links created.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define GENTREE_NAME_MAX 200
+#define GENTREE_NEEDLE "needle"
+
+/* Shape of the tree, and what has been created so far						*/
+typedef struct genTree {
+
+	int depth;
+	int fanout;
+	int files;
+	int minName;
+	int maxName;
+	int links;
+	long every;
+	uint64_t seed;
+	long nrDirs;
+	long nrFiles;
+	long nrLinks;
+} genTree;
+
+static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789_-.";
+
+/*
+* description: Gets the next number from a xorshift64* generator.
+* param[in]: g - The tree, which holds the generator's state.
+* return: The number.
+*/
+static uint64_t genRandom (genTree *g) {
+
+	g -> seed ^= g -> seed >> 12;
+	g -> seed ^= g -> seed << 25;
+	g -> seed ^= g -> seed >> 27;
+	return g -> seed * 2685821657736338717ull;
+}
+
+/*
+* description: Makes a random name, that is not "." or "..", and does not
+* start with a dot so that it is never hidden.
+* param[in]: g - The tree.
+* param[in]: name - Buffer of at least GENTREE_NAME_MAX + 1 bytes.
+*/
+static void genName (genTree *g, char *name) {
+
+	int len = g -> minName +
+			  genRandom(g) % (g -> maxName - g -> minName + 1);
+	for (int i = 0; i < len; i++) {
+
+		/* The last three characters are not valid first characters */
+		int range = i == 0 ? (int)sizeof(alphabet) - 4 :
+					(int)sizeof(alphabet) - 1;
+		name[i] = alphabet[genRandom(g) % range];
+	}
+	name[len] = '\0';
+}
+
+/*
+* description: Prints an error about a path and exits.
+* param[in]: path - The path.
+*/
+static void genFail (const char *path) {
+
+	perror(path);
+	exit(1);
+}
+
+/*
+* description: Creates an entry with a random name in a directory. A name that
+* already exists is drawn again.
+* param[in]: g - The tree.
+* param[in]: dir - Path of the directory.
+* param[in]: type - 'd' for a directory, 'f' for a file, 'l' for a link.
+* param[in]: linkTarget - What a link points to; ignored for other types.
+* param[out]: path - The path of the new entry, of at least PATH_MAX bytes.
+*/
+static void genEntry (genTree *g, const char *dir, char type,
+					  const char *linkTarget, char *path) {
+
+	char name[GENTREE_NAME_MAX + 1];
+	for (;;) {
+
+		genName(g, name);
+		if (snprintf(path, PATH_MAX, "%s/%s", dir, name) >= PATH_MAX) {
+
+			errno = ENAMETOOLONG;
+			genFail(dir);
+		}
+		int res;
+		if (type == 'd') {
+
+			res = mkdir(path, 0755);
+		} else if (type == 'l') {
+
+			res = symlink(linkTarget, path);
+		} else {
+
+			int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+			res = fd < 0 ? -1 : close(fd);
+		}
+		if (res == 0) {
+
+			return;
+		} else if (errno != EEXIST) {
+
+			genFail(path);
+		}
+	}
+}
+
+/*
+* description: Fills a directory with files, links and, unless it is at the
+* deepest level, subdirectories, which are then filled in turn.
+* param[in]: g - The tree.
+* param[in]: dir - Path of the directory.
+* param[in]: level - Level of the directory; the root is at 0.
+*/
+static void genDir (genTree *g, const char *dir, int level) {
+
+	char path[PATH_MAX];
+	char target[PATH_MAX];
+	target[0] = '\0';
+	g -> nrDirs++;
+	if (g -> every > 0 && (g -> nrDirs - 1) % g -> every == 0) {
+
+		snprintf(path, PATH_MAX, "%s/%s", dir, GENTREE_NEEDLE);
+		int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+		if (fd < 0 || close(fd) != 0) {
+
+			genFail(path);
+		}
+		g -> nrFiles++;
+	}
+	for (int i = 0; i < g -> files; i++) {
+
+		genEntry(g, dir, 'f', NULL, path);
+		g -> nrFiles++;
+		strcpy(target, strrchr(path, '/') + 1);
+	}
+
+	int nrSubdirs = level < g -> depth ? g -> fanout : 0;
+	char (*subdirs)[PATH_MAX] = malloc(sizeof(*subdirs) * (nrSubdirs + 1));
+	if (subdirs == NULL) {
+
+		genFail("malloc");
+	}
+	for (int i = 0; i < nrSubdirs; i++) {
+
+		genEntry(g, dir, 'd', NULL, subdirs[i]);
+		strcpy(target, strrchr(subdirs[i], '/') + 1);
+	}
+	for (int i = 0; i < g -> links; i++) {
+
+		/* Links point to the last file or directory created, or nowhere */
+		const char *to = i % 10 == 9 || target[0] == '\0' ?
+						 "does-not-exist" : target;
+		genEntry(g, dir, 'l', to, path);
+		g -> nrLinks++;
+	}
+	for (int i = 0; i < nrSubdirs; i++) {
+
+		genDir(g, subdirs[i], level + 1);
+	}
+	free(subdirs);
+}
+
+/*
+* description: Parses a non-negative number of an option, or exits.
+* param[in]: opt - The option.
+* param[in]: str - The number.
+* return: The number.
+*/
+static long genParseNumber (int opt, const char *str) {
+
+	char *end;
+	errno = 0;
+	long n = strtol(str, &end, 10);
+	if (errno != 0 || end == str || *end != '\0' || n < 0) {
+
+		fprintf(stderr, "Invalid argument: -%c must be a non-negative "
+						"integer\n", opt);
+		exit(1);
+	}
+	return n;
+}
+
+int main (int argc, char *argv[]) {
+
+	genTree g = {
+		.depth = 3, .fanout = 4, .files = 8, .minName = 4, .maxName = 16,
+		.links = 0, .every = 97, .seed = 1
+	};
+	int opt;
+	while ((opt = getopt(argc, argv, "d:f:n:l:s:e:r:")) != -1) {
+
+		switch (opt) {
+
+			case 'd':
+				g.depth = genParseNumber(opt, optarg);
+				break;
+
+			case 'f':
+				g.fanout = genParseNumber(opt, optarg);
+				break;
+
+			case 'n':
+				g.files = genParseNumber(opt, optarg);
+				break;
+
+			case 'l':
+				if (sscanf(optarg, "%d:%d", &g.minName, &g.maxName) != 2 ||
+					g.minName < 1 || g.maxName < g.minName ||
+					g.maxName > GENTREE_NAME_MAX) {
+
+					fprintf(stderr, "Invalid argument: -l must be min:max, "
+									"with 1 <= min <= max <= %d\n",
+									GENTREE_NAME_MAX);
+					exit(1);
+				}
+				break;
+
+			case 's':
+				g.links = genParseNumber(opt, optarg);
+				break;
+
+			case 'e':
+				g.every = genParseNumber(opt, optarg);
+				break;
+
+			case 'r':
+				/* A xorshift generator must not be seeded with 0 */
+				g.seed = genParseNumber(opt, optarg) * 2 + 1;
+				break;
+
+			default:
+				fprintf(stderr, "Usage: %s [-d depth] [-f fanout] [-n files] "
+								"[-l min:max] [-s symlinks] [-e every] "
+								"[-r seed] root\n", argv[0]);
+				exit(1);
+		}
+	}
+	if (optind != argc - 1) {
+
+		fprintf(stderr, "Invalid argument: exactly one root must be given\n");
+		exit(1);
+	}
+	if (mkdir(argv[optind], 0755) != 0) {
+
+		genFail(argv[optind]);
+	}
+	genDir(&g, argv[optind], 0);
+	printf("%ld directories, %ld files, %ld links\n", g.nrDirs, g.nrFiles,
+		   g.nrLinks);
+	return 0;
+}
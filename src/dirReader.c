@@ -0,0 +1,127 @@
+/*
+* Bulk directory reader. Reads directory entries with the getdents64 system
+* call, straight into a large buffer owned by the reader. The entries are
+* walked in place, without being copied. Each thread should own one reader and
+* reuse it for every directory it reads.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "dirReader.h"
+#include "saferMemHandler.h"
+
+struct dirReader {
+
+	char *buf;
+	size_t size;
+	size_t pos;
+	size_t len;
+	int fd;
+	int error;
+};
+
+/*
+* description: Creates and allocates memory for a reader and its buffer.
+* param[in]: bufSize - Size of the buffer in bytes. At least
+* DIRREADER_MIN_SIZE will be used.
+* return: The reader.
+*/
+dirReader *dirReaderNew (size_t bufSize) {
+
+	dirReader *r = smalloc(sizeof(*r));
+	r -> size = bufSize < DIRREADER_MIN_SIZE ? DIRREADER_MIN_SIZE : bufSize;
+	r -> buf = smalloc(r -> size);
+	r -> pos = 0;
+	r -> len = 0;
+	r -> fd = -1;
+	r -> error = 0;
+	return r;
+}
+
+/*
+* description: Starts reading a directory. The reader does not take ownership
+* of the fd, and will not close it.
+* param[in]: r - The reader.
+* param[in]: fd - Open fd of the directory.
+*/
+void dirReaderOpen (dirReader *r, int fd) {
+
+	r -> fd = fd;
+	r -> pos = 0;
+	r -> len = 0;
+	r -> error = 0;
+}
+
+/*
+* description: Gets the next entry in the directory. Refills the buffer with
+* getdents64 when all entries in it have been walked. The entry is valid until
+* the buffer is refilled (see dirReaderIsDrained()).
+* param[in]: r - The reader.
+* return: Pointer to the entry in the buffer, or NULL if there are no more
+* entries or reading failed (see dirReaderError()).
+*/
+dirEntry *dirReaderNext (dirReader *r) {
+
+	if (r -> pos >= r -> len) {
+
+		if (r -> fd < 0) {
+
+			return NULL;
+		}
+		long nread = syscall(SYS_getdents64, r -> fd, r -> buf, r -> size);
+		if (nread <= 0) {
+
+			r -> error = nread < 0 ? errno : 0;
+			r -> fd = -1;
+			return NULL;
+		}
+		r -> pos = 0;
+		r -> len = nread;
+	}
+	dirEntry *entry = (dirEntry *)&r -> buf[r -> pos];
+	r -> pos += entry -> d_reclen;
+	return entry;
+}
+
+/*
+* description: Checks if all entries in the buffer have been walked, so that
+* the next call to dirReaderNext() refills it. Entries gotten before then are
+* valid until that call.
+* param[in]: r - The reader.
+* return: If the buffer is drained; 1, else 0.
+*/
+int dirReaderIsDrained (dirReader *r) {
+
+	return r -> pos >= r -> len;
+}
+
+/*
+* description: Gets the error from the last failed read.
+* param[in]: r - The reader.
+* return: The errno value of the failed getdents64, or 0 if none failed.
+*/
+int dirReaderError (dirReader *r) {
+
+	return r -> error;
+}
+
+/*
+* description: Frees all memory allocated by the reader, including the reader.
+* param[in]: r - The reader.
+*/
+void dirReaderKill (dirReader *r) {
+
+	if (r != NULL) {
+
+		sfree(r -> buf);
+		sfree(r);
+	}
+}
@@ -0,0 +1,79 @@
+/*
+* Bulk directory reader. Reads directory entries with the getdents64 system
+* call, straight into a large buffer owned by the reader. The entries are
+* walked in place, without being copied. Each thread should own one reader and
+* reuse it for every directory it reads.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#ifndef __DIRREADER__
+#define __DIRREADER__
+
+/* Default and minimum size of a reader's buffer in bytes					*/
+#define DIRREADER_DEFAULT_SIZE (256 * 1024)
+#define DIRREADER_MIN_SIZE 4096
+
+/* Directory entry, as laid out by getdents64 (struct linux_dirent64)		*/
+typedef struct dirEntry {
+
+	unsigned long long d_ino;
+	long long d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+} dirEntry;
+
+typedef struct dirReader dirReader;
+
+/*
+* description: Creates and allocates memory for a reader and its buffer.
+* param[in]: bufSize - Size of the buffer in bytes. At least
+* DIRREADER_MIN_SIZE will be used.
+* return: The reader.
+*/
+dirReader *dirReaderNew (size_t bufSize);
+
+/*
+* description: Starts reading a directory. The reader does not take ownership
+* of the fd, and will not close it.
+* param[in]: r - The reader.
+* param[in]: fd - Open fd of the directory.
+*/
+void dirReaderOpen (dirReader *r, int fd);
+
+/*
+* description: Gets the next entry in the directory. Refills the buffer with
+* getdents64 when all entries in it have been walked. The entry is valid until
+* the buffer is refilled (see dirReaderIsDrained()).
+* param[in]: r - The reader.
+* return: Pointer to the entry in the buffer, or NULL if there are no more
+* entries or reading failed (see dirReaderError()).
+*/
+dirEntry *dirReaderNext (dirReader *r);
+
+/*
+* description: Checks if all entries in the buffer have been walked, so that
+* the next call to dirReaderNext() refills it. Entries gotten before then are
+* valid until that call.
+* param[in]: r - The reader.
+* return: If the buffer is drained; 1, else 0.
+*/
+int dirReaderIsDrained (dirReader *r);
+
+/*
+* description: Gets the error from the last failed read.
+* param[in]: r - The reader.
+* return: The errno value of the failed getdents64, or 0 if none failed.
+*/
+int dirReaderError (dirReader *r);
+
+/*
+* description: Frees all memory allocated by the reader, including the reader.
+* param[in]: r - The reader.
+*/
+void dirReaderKill (dirReader *r);
+
+#endif //__DIRREADER__
@@ -0,0 +1,320 @@
+/*
+* Minimal io_uring submission ring, used to keep many openat and statx
+* requests in flight from one thread. Talks to the kernel directly with the
+* io_uring_setup and io_uring_enter system calls. A ring must only be used by
+* the thread that owns it.
+*
+* The kernel has no io_uring operation for reading directory entries, so
+* those are still read with getdents64 (see dirReader.h).
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "ioRing.h"
+#include "saferMemHandler.h"
+
+struct ioRing {
+
+	int fd;
+	unsigned int depth;
+
+	/* Submission queue													*/
+	void *sqMap;
+	size_t sqMapSize;
+	unsigned int *sqHead;
+	unsigned int *sqTail;
+	unsigned int *sqMask;
+	unsigned int *sqArray;
+	struct io_uring_sqe *sqes;
+	size_t sqesSize;
+	unsigned int sqPending;
+
+	/* Completion queue														*/
+	void *cqMap;
+	size_t cqMapSize;
+	unsigned int *cqHead;
+	unsigned int *cqTail;
+	unsigned int *cqMask;
+	struct io_uring_cqe *cqes;
+};
+
+/*
+* description: Creates a ring and maps its queues.
+* param[in]: depth - Number of requests that can be in flight.
+* return: The ring, or NULL if io_uring is not available (errno is set).
+*/
+ioRing *ioRingNew (unsigned int depth) {
+
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	int fd = syscall(__NR_io_uring_setup, depth, &p);
+	if (fd < 0) {
+
+		return NULL;
+	}
+
+	ioRing *r = smalloc(sizeof(*r));
+	r -> fd = fd;
+	r -> depth = p.sq_entries;
+	r -> sqPending = 0;
+	r -> sqMapSize = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	r -> cqMapSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+
+		if (r -> cqMapSize > r -> sqMapSize) {
+
+			r -> sqMapSize = r -> cqMapSize;
+		}
+		r -> cqMapSize = 0;
+	}
+
+	r -> sqMap = mmap(NULL, r -> sqMapSize, PROT_READ | PROT_WRITE,
+					  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	r -> cqMap = r -> sqMap;
+	if (r -> sqMap != MAP_FAILED && r -> cqMapSize != 0) {
+
+		r -> cqMap = mmap(NULL, r -> cqMapSize, PROT_READ | PROT_WRITE,
+						  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	}
+	r -> sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+	r -> sqes = MAP_FAILED;
+	if (r -> sqMap != MAP_FAILED && r -> cqMap != MAP_FAILED) {
+
+		r -> sqes = mmap(NULL, r -> sqesSize, PROT_READ | PROT_WRITE,
+						 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	}
+	if (r -> sqes == MAP_FAILED) {
+
+		int err = errno;
+		if (r -> cqMapSize != 0 && r -> cqMap != MAP_FAILED) {
+
+			munmap(r -> cqMap, r -> cqMapSize);
+		}
+		if (r -> sqMap != MAP_FAILED) {
+
+			munmap(r -> sqMap, r -> sqMapSize);
+		}
+		close(fd);
+		sfree(r);
+		errno = err;
+		return NULL;
+	}
+
+	char *sq = r -> sqMap;
+	r -> sqHead = (unsigned int *)(sq + p.sq_off.head);
+	r -> sqTail = (unsigned int *)(sq + p.sq_off.tail);
+	r -> sqMask = (unsigned int *)(sq + p.sq_off.ring_mask);
+	r -> sqArray = (unsigned int *)(sq + p.sq_off.array);
+	char *cq = r -> cqMap;
+	r -> cqHead = (unsigned int *)(cq + p.cq_off.head);
+	r -> cqTail = (unsigned int *)(cq + p.cq_off.tail);
+	r -> cqMask = (unsigned int *)(cq + p.cq_off.ring_mask);
+	r -> cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+	return r;
+}
+
+/*
+* description: Gets the number of requests that can be prepared before the
+* ring must be submitted.
+* param[in]: r - The ring.
+* return: The number of free submission entries.
+*/
+unsigned int ioRingSpace (ioRing *r) {
+
+	return r -> depth - r -> sqPending;
+}
+
+/*
+* description: Gets the next free submission entry, cleared.
+* param[in]: r - The ring.
+* return: The entry, or NULL if the ring is full.
+*/
+static struct io_uring_sqe *ioRingGetSqe (ioRing *r) {
+
+	if (r -> sqPending == r -> depth) {
+
+		return NULL;
+	}
+	unsigned int tail = *r -> sqTail + r -> sqPending;
+	unsigned int index = tail & *r -> sqMask;
+	struct io_uring_sqe *sqe = &r -> sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	r -> sqArray[index] = index;
+	r -> sqPending++;
+	return sqe;
+}
+
+/*
+* description: Prepares a statx request. Nothing is sent to the kernel until
+* ioRingSubmit(). path and buf must stay valid until the request completes.
+* param[in]: r - The ring.
+* param[in]: dirfd - Directory fd that path is relative to.
+* param[in]: path - The path.
+* param[in]: flags - statx flags (AT_*).
+* param[in]: mask - statx mask (STATX_*).
+* param[out]: buf - Filled when the request completes.
+* param[in]: userData - Value returned with the completion.
+* return: 1 if prepared, 0 if the ring is full.
+*/
+int ioRingPrepStatx (ioRing *r, int dirfd, const char *path, int flags,
+					 unsigned int mask, struct statx *buf,
+					 unsigned long long userData) {
+
+	struct io_uring_sqe *sqe = ioRingGetSqe(r);
+	if (sqe == NULL) {
+
+		return 0;
+	}
+	sqe -> opcode = IORING_OP_STATX;
+	sqe -> fd = dirfd;
+	sqe -> addr = (unsigned long)path;
+	sqe -> len = mask;
+	sqe -> off = (unsigned long)buf;
+	sqe -> statx_flags = flags;
+	sqe -> user_data = userData;
+	return 1;
+}
+
+/*
+* description: Prepares an openat request. Nothing is sent to the kernel until
+* ioRingSubmit(). path must stay valid until the request completes.
+* param[in]: r - The ring.
+* param[in]: dirfd - Directory fd that path is relative to.
+* param[in]: path - The path.
+* param[in]: flags - open flags (O_*).
+* param[in]: userData - Value returned with the completion.
+* return: 1 if prepared, 0 if the ring is full.
+*/
+int ioRingPrepOpenat (ioRing *r, int dirfd, const char *path, int flags,
+					  unsigned long long userData) {
+
+	struct io_uring_sqe *sqe = ioRingGetSqe(r);
+	if (sqe == NULL) {
+
+		return 0;
+	}
+	sqe -> opcode = IORING_OP_OPENAT;
+	sqe -> fd = dirfd;
+	sqe -> addr = (unsigned long)path;
+	sqe -> open_flags = flags;
+	sqe -> user_data = userData;
+	return 1;
+}
+
+/*
+* description: Waits until a number of completions are in the completion
+* queue. If the kernel cannot wait, other than when interrupted, the queue is
+* polled instead, as the requests complete all the same.
+* param[in]: r - The ring.
+* param[in]: count - Number of completions to wait for.
+*/
+static void ioRingWait (ioRing *r, unsigned int count) {
+
+	while (__atomic_load_n(r -> cqTail, __ATOMIC_ACQUIRE) - *r -> cqHead <
+		   count) {
+
+		if (syscall(__NR_io_uring_enter, r -> fd, 0, count,
+					IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR) {
+
+			sched_yield();
+		}
+	}
+}
+
+/*
+* description: Submits all prepared requests, and waits until all of them
+* have completed. If the submission fails, the requests the kernel did not
+* take are withdrawn, and it still waits for those it took, so that no
+* request is left writing into its buffers. Their completions can be reaped
+* before the ring is killed.
+* param[in]: r - The ring.
+* return: Number of requests submitted, or -1 on error (errno is set).
+*/
+int ioRingSubmit (ioRing *r) {
+
+	unsigned int toSubmit = r -> sqPending;
+	if (toSubmit == 0) {
+
+		return 0;
+	}
+	unsigned int first = *r -> sqTail;
+	__atomic_store_n(r -> sqTail, first + toSubmit, __ATOMIC_RELEASE);
+	r -> sqPending = 0;
+
+	unsigned int submitted = 0;
+	while (submitted < toSubmit) {
+
+		int rc = syscall(__NR_io_uring_enter, r -> fd, toSubmit - submitted,
+						 toSubmit - submitted, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (rc < 0 && errno != EINTR) {
+
+			/* The kernel's head tells how many it took; the rest are taken
+			back, and those taken are waited for							*/
+			int err = errno;
+			unsigned int head = __atomic_load_n(r -> sqHead, __ATOMIC_ACQUIRE);
+			__atomic_store_n(r -> sqTail, head, __ATOMIC_RELEASE);
+			ioRingWait(r, head - first);
+			errno = err;
+			return -1;
+		} else if (rc > 0) {
+
+			submitted += rc;
+		}
+	}
+
+	/* Completions might still be missing if the wait was interrupted		*/
+	ioRingWait(r, toSubmit);
+	return toSubmit;
+}
+
+/*
+* description: Gets the next completion of a submitted request.
+* param[in]: r - The ring.
+* param[out]: userData - The value the request was prepared with.
+* param[out]: res - Result of the request. Negative errno on failure.
+* return: 1 if a completion was read, 0 if there are none.
+*/
+int ioRingReap (ioRing *r, unsigned long long *userData, int *res) {
+
+	unsigned int head = *r -> cqHead;
+	if (head == __atomic_load_n(r -> cqTail, __ATOMIC_ACQUIRE)) {
+
+		return 0;
+	}
+	struct io_uring_cqe *cqe = &r -> cqes[head & *r -> cqMask];
+	*userData = cqe -> user_data;
+	*res = cqe -> res;
+	__atomic_store_n(r -> cqHead, head + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+/*
+* description: Unmaps and closes the ring, and frees its memory.
+* param[in]: r - The ring.
+*/
+void ioRingKill (ioRing *r) {
+
+	if (r != NULL) {
+
+		munmap(r -> sqes, r -> sqesSize);
+		if (r -> cqMapSize != 0) {
+
+			munmap(r -> cqMap, r -> cqMapSize);
+		}
+		munmap(r -> sqMap, r -> sqMapSize);
+		close(r -> fd);
+		sfree(r);
+	}
+}
@@ -0,0 +1,95 @@
+/*
+* Minimal io_uring submission ring, used to keep many openat and statx
+* requests in flight from one thread. Talks to the kernel directly with the
+* io_uring_setup and io_uring_enter system calls. A ring must only be used by
+* the thread that owns it.
+*
+* The kernel has no io_uring operation for reading directory entries, so
+* those are still read with getdents64 (see dirReader.h).
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#ifndef __IORING__
+#define __IORING__
+
+/* Default number of requests a ring can have in flight						*/
+#define IORING_DEFAULT_DEPTH 64
+
+struct statx;
+
+typedef struct ioRing ioRing;
+
+/*
+* description: Creates a ring and maps its queues.
+* param[in]: depth - Number of requests that can be in flight.
+* return: The ring, or NULL if io_uring is not available (errno is set).
+*/
+ioRing *ioRingNew (unsigned int depth);
+
+/*
+* description: Gets the number of requests that can be prepared before the
+* ring must be submitted.
+* param[in]: r - The ring.
+* return: The number of free submission entries.
+*/
+unsigned int ioRingSpace (ioRing *r);
+
+/*
+* description: Prepares a statx request. Nothing is sent to the kernel until
+* ioRingSubmit(). path and buf must stay valid until the request completes.
+* param[in]: r - The ring.
+* param[in]: dirfd - Directory fd that path is relative to.
+* param[in]: path - The path.
+* param[in]: flags - statx flags (AT_*).
+* param[in]: mask - statx mask (STATX_*).
+* param[out]: buf - Filled when the request completes.
+* param[in]: userData - Value returned with the completion.
+* return: 1 if prepared, 0 if the ring is full.
+*/
+int ioRingPrepStatx (ioRing *r, int dirfd, const char *path, int flags,
+					 unsigned int mask, struct statx *buf,
+					 unsigned long long userData);
+
+/*
+* description: Prepares an openat request. Nothing is sent to the kernel until
+* ioRingSubmit(). path must stay valid until the request completes.
+* param[in]: r - The ring.
+* param[in]: dirfd - Directory fd that path is relative to.
+* param[in]: path - The path.
+* param[in]: flags - open flags (O_*).
+* param[in]: userData - Value returned with the completion.
+* return: 1 if prepared, 0 if the ring is full.
+*/
+int ioRingPrepOpenat (ioRing *r, int dirfd, const char *path, int flags,
+					  unsigned long long userData);
+
+/*
+* description: Submits all prepared requests, and waits until all of them
+* have completed. If the submission fails, the requests the kernel did not
+* take are withdrawn, and it still waits for those it took, so that no
+* request is left writing into its buffers. Their completions can be reaped
+* before the ring is killed.
+* param[in]: r - The ring.
+* return: Number of requests submitted, or -1 on error (errno is set).
+*/
+int ioRingSubmit (ioRing *r);
+
+/*
+* description: Gets the next completion of a submitted request.
+* param[in]: r - The ring.
+* param[out]: userData - The value the request was prepared with.
+* param[out]: res - Result of the request. Negative errno on failure.
+* return: 1 if a completion was read, 0 if there are none.
+*/
+int ioRingReap (ioRing *r, unsigned long long *userData, int *res);
+
+/*
+* description: Unmaps and closes the ring, and frees its memory.
+* param[in]: r - The ring.
+*/
+void ioRingKill (ioRing *r);
+
+#endif //__IORING__
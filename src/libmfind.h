@@ -0,0 +1,139 @@
+/*
+* libmfind - the search of mfind as a library. A search is an mfindSearch,
+* created from an args struct (see parseMfind.h, and argsInit() for the
+* defaults), that holds all of its state, so several searches can run at once
+* in one process, each from its own thread. Matches are passed to a callback
+* as they are found, from whichever of the search's threads found them.
+*
+*	args a;
+*	argsInit(&a);
+*	argsAddTarget(&a, "mfind.c");
+*	... fill in a.start, a.nrStart, a.nrthr and so on ...
+*	mfindSearch *s = mfindSearchNew(&a, onMatch, &myData);
+*	long nrResults = mfindSearchRun(s);
+*	mfindSearchKill(s);
+*
+* Link with libmfind.a and -pthread.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#ifndef __LIBMFIND__
+#define __LIBMFIND__
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "parseMfind.h"
+
+typedef struct mfindSearch mfindSearch;
+
+/* Metadata of a match, as from stat(2) - its inode number, size in bytes,
+mode (type and permission bits) and time of last modification				*/
+typedef struct mfindStat {
+
+	unsigned long long ino;
+	unsigned long long size;
+	unsigned int mode;
+	long long mtimeSec;
+	unsigned int mtimeNsec;
+} mfindStat;
+
+/* A match, as passed to the callback. path is only valid during the call.
+With more than one distinct target, matched holds the indexes of the targets
+the entry matched (see mfindSearchTargetName()), else it is NULL. thread is
+the id of the search's thread that found it, from 0 (the thread that called
+mfindSearchRun()) to nrthr, so that the callback can keep state per thread
+without locking. If a -> output is OUTPUT_JSON, stat holds the metadata of
+the entry, else (or if it could not be stat'ed) it is NULL. It is taken from
+the stat the search made of the entry, if any, so an entry is stat'ed at most
+once																		*/
+typedef struct mfindMatch {
+
+	const char *path;
+	size_t pathLen;
+	char type;
+	int depth;
+	const int *matched;
+	int nrMatched;
+	int thread;
+	const mfindStat *stat;
+} mfindMatch;
+
+/* Called for each match. Called concurrently by the search's threads		*/
+typedef void (*mfindCallback) (const mfindMatch *match, void *data);
+
+/*
+* description: Creates a search. The targets are compiled, and each thread's
+* buffers allocated, but no directory is read until mfindSearchRun().
+* param[in]: a - The arguments of the search. Must stay valid, and not be
+* changed, until the search is killed.
+* param[in]: callback - Called for each match, or NULL to only count them.
+* param[in]: data - Passed to the callback.
+* return: The search, or NULL if a target is invalid, or the search could not
+* be set up (a message is printed to stderr).
+*/
+mfindSearch *mfindSearchNew (args *a, mfindCallback callback, void *data);
+
+/*
+* description: Runs a search, with the calling thread and a -> nrthr more,
+* and returns once all of them are done. If a -> autoThreads is set, only as
+* many of them search at once as are found to be faster (see -p auto). May
+* only be called once per search.
+* param[in]: s - The search.
+* return: Number of matches reported, or -1 if the search had already been
+* run, its threads could not all be created, or an index could not be written
+* (a message is printed to stderr).
+*/
+long mfindSearchRun (mfindSearch *s);
+
+/*
+* description: Stops a running search. Its threads stop reading directories,
+* and mfindSearchRun() returns the matches found so far. No index is written.
+* May be called from any thread, and from a signal handler.
+* param[in]: s - The search.
+*/
+void mfindSearchStop (mfindSearch *s);
+
+/*
+* description: Gets the number of threads of a search, including the one that
+* runs it.
+* param[in]: s - The search.
+* return: The number of threads.
+*/
+int mfindSearchNrThreads (mfindSearch *s);
+
+/*
+* description: Gets the id of one of a search's threads, once it has run.
+* param[in]: s - The search.
+* param[in]: thread - The thread, from 0 to mfindSearchNrThreads() - 1.
+* return: Its id.
+*/
+pthread_t mfindSearchThreadId (mfindSearch *s, int thread);
+
+/*
+* description: Gets the number of directories one of a search's threads read,
+* once it has run.
+* param[in]: s - The search.
+* param[in]: thread - The thread, from 0 to mfindSearchNrThreads() - 1.
+* return: The number of directories.
+*/
+int mfindSearchThreadReads (mfindSearch *s, int thread);
+
+/*
+* description: Gets the name of a target of a search, as it was given.
+* param[in]: s - The search.
+* param[in]: id - The target's index, as in mfindMatch.matched.
+* return: The name.
+*/
+const char *mfindSearchTargetName (mfindSearch *s, int id);
+
+/*
+* description: Frees all memory allocated by a search, including the search.
+* param[in]: s - The search.
+*/
+void mfindSearchKill (mfindSearch *s);
+
+#endif //__LIBMFIND__
@@ -0,0 +1,561 @@
+/*
+* Command line front end of mfind (see mfind.c for its usage). Parses the
+* arguments, and runs the search through libmfind (see libmfind.h), with each
+* thread writing its matches to its own output buffer. A search can also be
+* answered from an index, and an index kept up to date with --watch.
+*
+* Author: mfind contributors. main() was moved here from mfind.c, by Buster
+* Hultgren Wärn <dv17bhn@cs.umu.se>.
+*
+* Final build: 2026-10-17
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "libmfind.h"
+#include "main.h"
+#include "outBuffer.h"
+#include "targetSet.h"
+#include "matcher.h"
+#include "nameIndex.h"
+#include "watch.h"
+#include "parseMfind.h"
+#include "saferMemHandler.h"
+
+
+int main (int argc, char *argv[]) {
+
+	args a;
+	argsInit(&a);
+	parseArgs(&a, argc, argv);
+	long nrResults = 0;
+	if (a.index != NULL) {
+
+		nrResults = runIndexQuery(&a);
+	} else if (a.nrStart > 0) {
+
+		initSignals();
+		nrResults = runSearch(&a);
+		if (a.watch && !INTERRUPTED &&
+			!watchRun(a.buildIndex, a.rescan, &INTERRUPTED)) {
+
+			argsKill(&a);
+			exit(1);
+		}
+	}
+	int report = a.report;
+	argsKill(&a);
+	arenaKill();
+	if (INTERRUPTED) {								/* Die by the signal	*/
+
+		signal(INTERRUPTED, SIG_DFL);
+		raise(INTERRUPTED);
+	}
+	return report == REPORT_EXISTS && nrResults == 0 ? 1 : 0;
+}
+
+/*
+* description: Runs a search of the starting directories, printing each match,
+* or their number with --count, and then the number of directories each
+* thread read (only when printing matches as lines, so that the output of
+* --print0, --json, --count and --exists is only records).
+* param[in]: a - args struct filled with parsed arguments.
+* return: Number of matches reported.
+*/
+long runSearch (args *a) {
+
+	cliOutput out;
+	mfindSearch *s = mfindSearchNew(a, printMatch, &out);
+	if (s == NULL) {
+
+		argsKill(a);
+		exit(1);
+	}
+	int nrThreads = mfindSearchNrThreads(s);
+	out.s = s;
+	out.output = a -> output;
+	out.threads = smalloc(sizeof(*out.threads) * nrThreads);
+	for (int i = 0; i < nrThreads; i++) {
+
+		out.threads[i].out = outBufferNew(STDOUT_FILENO,
+										  OUTBUFFER_DEFAULT_SIZE);
+		out.threads[i].line = NULL;
+		out.threads[i].lineSize = 0;
+	}
+
+	int summary = a -> output == OUTPUT_LINES && a -> report == REPORT_PATHS;
+	if (summary) {
+
+		printf("\n");
+	}
+	fflush(stdout);				/* Threads write to stdout without stdio	*/
+	SEARCH = s;
+	if (INTERRUPTED) {								/* Before SEARCH was set*/
+
+		mfindSearchStop(s);
+	}
+	long nrResults = mfindSearchRun(s);
+	SEARCH = NULL;
+	for (int i = 0; i < nrThreads; i++) {
+
+		outBufferKill(out.threads[i].out);
+		sfree(out.threads[i].line);
+	}
+	sfree(out.threads);
+	if (a -> report == REPORT_COUNT && nrResults >= 0) {
+
+		printf("%ld\n", nrResults);
+	}
+	summary = summary && nrResults >= 0;	/* Not all threads may have run	*/
+	if (summary) {
+
+		printf("\n");
+	}
+	for (int i = 1; i <= nrThreads && summary; i++) {
+
+		int id = i % nrThreads;				/* The main thread is last		*/
+		printf("Thread: %ld Reads: %d\n", mfindSearchThreadId(s, id),
+			   mfindSearchThreadReads(s, id));
+	}
+	mfindSearchKill(s);
+	if (nrResults < 0) {
+
+		argsKill(a);
+		exit(1);
+	}
+	return nrResults;
+}
+
+/*
+* description: Writes a match to its thread's output buffer (see
+* writeEntry()).
+* param[in]: match - The match.
+* param[in]: data - The output of the search (cliOutput).
+*/
+void printMatch (const mfindMatch *match, void *data) {
+
+	cliOutput *out = data;
+	int nrNames = match -> matched != NULL ? match -> nrMatched : 0;
+	const char *names[nrNames > 0 ? nrNames : 1];
+	for (int i = 0; i < nrNames; i++) {
+
+		names[i] = mfindSearchTargetName(out -> s, match -> matched[i]);
+	}
+	writeEntry(&out -> threads[match -> thread], out -> output, match -> path,
+			   match -> pathLen, match -> type, match -> depth, match -> stat,
+			   names, nrNames);
+}
+
+/*
+* description: Writes a found entry to an output buffer, as a line or a NUL
+* ended path, followed by the targets it matched separated by tabs, or as a
+* JSON object on a line. The record is written in place in the buffer, unless
+* it is larger than the buffer.
+* param[in]: t - Output of the thread.
+* param[in]: output - OUTPUT_LINES, OUTPUT_PRINT0 or OUTPUT_JSON.
+* param[in]: path - Path of the entry.
+* param[in]: pathLen - Length of the path.
+* param[in]: type - Type of the entry.
+* param[in]: depth - Depth of the entry, or -1 if it is not known.
+* param[in]: st - Metadata of the entry, or NULL if it is not known.
+* param[in]: names - The targets it matched, if more than one was searched for.
+* param[in]: nrNames - Number of targets in names.
+*/
+void writeEntry (cliThread *t, int output, const char *path, size_t pathLen,
+				 char type, int depth, const mfindStat *st, const char **names,
+				 int nrNames) {
+
+	size_t size = pathLen + 1;
+	if (output == OUTPUT_JSON) {
+
+		size = jsonEntrySize(pathLen, names, nrNames);
+	} else {
+
+		for (int i = 0; i < nrNames; i++) {
+
+			size += 1 + strlen(names[i]);
+		}
+	}
+	char *rec = outBufferReserve(t -> out, size);
+	if (rec == NULL) {						/* Larger than the buffer		*/
+
+		if (size > t -> lineSize) {
+
+			t -> lineSize = size * 2;
+			t -> line = srealloc(t -> line, t -> lineSize);
+		}
+		rec = t -> line;
+	}
+
+	size_t len = 0;
+	if (output == OUTPUT_JSON) {
+
+		len = jsonWriteEntry(rec, path, pathLen, type, depth, st, names,
+							 nrNames);
+	} else {
+
+		memcpy(rec, path, pathLen);
+		len = pathLen;
+		for (int i = 0; i < nrNames; i++) {
+
+			size_t nameLen = strlen(names[i]);
+			rec[len++] = '\t';
+			memcpy(&rec[len], names[i], nameLen);
+			len += nameLen;
+		}
+		rec[len++] = output == OUTPUT_PRINT0 ? '\0' : '\n';
+	}
+	if (rec == t -> line) {
+
+		outBufferRecord(t -> out, rec, len);
+	} else {
+
+		outBufferCommit(t -> out, len);
+	}
+}
+
+/*
+* description: Writes a found entry as a JSON object, ended by a newline:
+* {"path", "type", "depth", "size", "mtime", "inode", "mode", "targets"}.
+* depth, the metadata and targets are left out if not known. dst must have
+* room for jsonEntrySize() bytes.
+* param[in]: dst - Where to write it.
+* param[in]: path - Path of the entry.
+* param[in]: pathLen - Length of the path.
+* param[in]: type - Type of the entry.
+* param[in]: depth - Depth of the entry, or -1 if it is not known.
+* param[in]: st - Metadata of the entry, or NULL if it is not known.
+* param[in]: names - The targets it matched.
+* param[in]: nrNames - Number of targets in names, 0 to leave them out.
+* return: Number of bytes written.
+*/
+size_t jsonWriteEntry (char *dst, const char *path, size_t pathLen, char type,
+					   int depth, const mfindStat *st, const char **names,
+					   int nrNames) {
+
+	char *p = dst;
+	memcpy(p, "{\"path\":", 8);
+	p += 8;
+	p += jsonWriteString(p, path, pathLen);
+	p += sprintf(p, ",\"type\":\"%c\"", type);
+	if (depth >= 0) {
+
+		p += sprintf(p, ",\"depth\":%d", depth);
+	}
+	if (st != NULL) {
+
+		/* Before 1970, -0.5 s is -1 s and 5e8 ns: the fraction is borrowed	*/
+		long long sec = st -> mtimeSec;
+		unsigned int nsec = st -> mtimeNsec;
+		const char *sign = "";
+		if (sec < 0) {
+
+			sign = "-";
+			if (nsec > 0) {
+
+				sec++;
+				nsec = 1000000000 - nsec;
+			}
+			sec = -sec;
+		}
+		p += sprintf(p, ",\"size\":%llu,\"mtime\":%s%lld.%09u,\"inode\":%llu,"
+					 "\"mode\":\"%04o\"", st -> size, sign, sec, nsec,
+					 st -> ino, st -> mode & 07777);
+	}
+	if (nrNames > 0) {
+
+		memcpy(p, ",\"targets\":[", 12);
+		p += 12;
+		for (int i = 0; i < nrNames; i++) {
+
+			if (i > 0) {
+
+				*p++ = ',';
+			}
+			p += jsonWriteString(p, names[i], strlen(names[i]));
+		}
+		*p++ = ']';
+	}
+	*p++ = '}';
+	*p++ = '\n';
+	return p - dst;
+}
+
+/*
+* description: Gets the most bytes jsonWriteEntry() may write for an entry -
+* every byte of the path and targets could need to be escaped.
+* param[in]: pathLen - Length of the path.
+* param[in]: names - The targets it matched.
+* param[in]: nrNames - Number of targets in names.
+* return: The number of bytes.
+*/
+size_t jsonEntrySize (size_t pathLen, const char **names, int nrNames) {
+
+	size_t size = JSON_FIXED_SIZE + 2 + 6 * pathLen;
+	for (int i = 0; i < nrNames; i++) {
+
+		size += 3 + 6 * strlen(names[i]);
+	}
+	return size;
+}
+
+/*
+* description: Writes a string as a quoted JSON string. Quotes, backslashes
+* and control characters are escaped, and so are bytes that are not part of
+* valid UTF-8 (as \u00XX), so that any name gives valid JSON.
+* param[in]: dst - Where to write it, with room for 2 + 6 * len bytes.
+* param[in]: s - The string.
+* param[in]: len - Length of the string.
+* return: Number of bytes written.
+*/
+size_t jsonWriteString (char *dst, const char *s, size_t len) {
+
+	static const char hex[] = "0123456789abcdef";
+	const unsigned char *u = (const unsigned char *)s;
+	char *p = dst;
+	*p++ = '"';
+	for (size_t i = 0; i < len;) {
+
+		unsigned char c = u[i];
+		int seqLen = 0;
+		if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\') {
+
+			*p++ = c;
+			i++;
+		} else if (c == '"' || c == '\\') {
+
+			*p++ = '\\';
+			*p++ = c;
+			i++;
+		} else if (c >= 0x80 && (seqLen = utf8SeqLen(&u[i], len - i)) > 0) {
+
+			memcpy(p, &u[i], seqLen);
+			p += seqLen;
+			i += seqLen;
+		} else {
+
+			/* A control character, or a byte that is not UTF-8				*/
+			memcpy(p, "\\u00", 4);
+			p[4] = hex[c >> 4];
+			p[5] = hex[c & 0xf];
+			p += 6;
+			i++;
+		}
+	}
+	*p++ = '"';
+	return p - dst;
+}
+
+/*
+* description: Gets the length of the UTF-8 sequence a multibyte character
+* starts with, if it is valid (not overlong, not a surrogate, and at most
+* U+10FFFF).
+* param[in]: s - The sequence.
+* param[in]: len - Bytes left in the string.
+* return: Its length (2 to 4), or 0 if it is not valid.
+*/
+int utf8SeqLen (const unsigned char *s, size_t len) {
+
+	int seqLen = 0;
+	unsigned char lo = 0x80;					/* Range of the second byte	*/
+	unsigned char hi = 0xbf;
+	if (s[0] >= 0xc2 && s[0] <= 0xdf) {
+
+		seqLen = 2;
+	} else if (s[0] >= 0xe0 && s[0] <= 0xef) {
+
+		seqLen = 3;
+		lo = s[0] == 0xe0 ? 0xa0 : lo;
+		hi = s[0] == 0xed ? 0x9f : hi;
+	} else if (s[0] >= 0xf0 && s[0] <= 0xf4) {
+
+		seqLen = 4;
+		lo = s[0] == 0xf0 ? 0x90 : lo;
+		hi = s[0] == 0xf4 ? 0x8f : hi;
+	}
+	if (seqLen == 0 || (size_t)seqLen > len || s[1] < lo || s[1] > hi) {
+
+		return 0;
+	}
+	for (int i = 2; i < seqLen; i++) {
+
+		if ((s[i] & 0xc0) != 0x80) {
+
+			return 0;
+		}
+	}
+	return seqLen;
+}
+
+/*
+* description: Answers a search from an index built by --build-index, instead
+* of walking the tree. Literal targets are found by binary search, and
+* patterns are matched once against each distinct name in the index.
+* param[in]: a - args struct filled with parsed arguments.
+* return: Number of matches reported.
+*/
+long runIndexQuery (args *a) {
+
+	nameIndex *ix = nameIndexOpen(a -> index);
+	if (ix == NULL) {
+
+		argsKill(a);
+		exit(1);
+	}
+	targetSet *targets = targetSetNew(a -> targets, a -> nrTargets,
+									  a -> matchMode);
+	if (targets == NULL) {
+
+		nameIndexClose(ix);
+		argsKill(a);
+		exit(1);
+	}
+	nameIndexCheckStale(ix);
+	int *matched = smalloc(sizeof(*matched) * a -> nrTargets);
+	long limit = a -> report == REPORT_EXISTS ? 1 :
+				 a -> maxResults > 0 ? a -> maxResults : -1;
+	cliThread out = {NULL, NULL, 0};
+	cliThread *t = NULL;
+	if (a -> report == REPORT_PATHS) {
+
+		fflush(stdout);
+		out.out = outBufferNew(STDOUT_FILENO, OUTBUFFER_DEFAULT_SIZE);
+		t = &out;
+	}
+	long nrResults = 0;
+
+	if (a -> matchMode == MATCH_LITERAL) {
+
+		/* Each distinct name once, even if several targets have it			*/
+		int64_t nameIds[targetSetSize(targets)];
+		int nrNames = 0;
+		for (int i = 0; i < targetSetSize(targets); i++) {
+
+			int64_t nameId = nameIndexFind(ix, targetSetKey(targets, i));
+			int seen = 0;
+			for (int j = 0; j < nrNames && !seen; j++) {
+
+				seen = nameIds[j] == nameId;
+			}
+			if (nameId >= 0 && !seen) {
+
+				nameIds[nrNames++] = nameId;
+			}
+		}
+		for (int i = 0; i < nrNames && nrResults != limit; i++) {
+
+			nrResults += indexPrintMatches(ix, targets, a -> type, nameIds[i],
+										   matched, limit < 0 ? -1 :
+										   limit - nrResults, t, a -> output);
+		}
+	} else {
+
+		uint32_t nrNames = nameIndexNrNames(ix);
+		for (uint32_t i = 0; i < nrNames && nrResults != limit; i++) {
+
+			nrResults += indexPrintMatches(ix, targets, a -> type, i, matched,
+										   limit < 0 ? -1 : limit - nrResults,
+										   t, a -> output);
+		}
+	}
+	outBufferKill(out.out);
+	sfree(out.line);
+	if (a -> report == REPORT_COUNT) {
+
+		printf("%ld\n", nrResults);
+	}
+	sfree(matched);
+	targetSetKill(targets);
+	nameIndexClose(ix);
+	return nrResults;
+}
+
+/*
+* description: Writes the paths of all entries in an index with a name, if the
+* name matches any target (see writeEntry()). Their depth and metadata are not
+* in the index, so with --json only their path, type and targets are written.
+* param[in]: ix - The index.
+* param[in]: targets - The targets.
+* param[in]: type - Type of target to find, or '\0' for any.
+* param[in]: nameId - Index of the name.
+* param[in]: matched - Scratch for targetSetMatch(), with room for all targets.
+* param[in]: limit - Most matches to report, or -1 for all.
+* param[in]: t - Where the paths are written (see writeEntry()), or NULL if
+* they are only counted.
+* param[in]: output - OUTPUT_LINES, OUTPUT_PRINT0 or OUTPUT_JSON.
+* return: Number of matches reported.
+*/
+long indexPrintMatches (nameIndex *ix, targetSet *targets, char type,
+						uint32_t nameId, int *matched, long limit,
+						cliThread *t, int output) {
+
+	int nrMatched = targetSetMatch(targets, nameIndexName(ix, nameId), matched);
+	if (nrMatched == 0) {
+
+		return 0;
+	}
+	int nrNames = targetSetSize(targets) > 1 ? nrMatched : 0;
+	const char *names[nrNames > 0 ? nrNames : 1];
+	for (int i = 0; i < nrNames; i++) {
+
+		names[i] = targetSetName(targets, matched[i]);
+	}
+	const uint32_t *entries;
+	uint32_t nrEntries = nameIndexEntries(ix, nameId, &entries);
+	long nrResults = 0;
+	for (uint32_t i = 0; i < nrEntries && nrResults != limit; i++) {
+
+		if (type != '\0' && nameIndexType(ix, entries[i]) != type) {
+
+			continue;
+		}
+		nrResults++;
+		if (t != NULL) {
+
+			const char *path = nameIndexPath(ix, entries[i]);
+			writeEntry(t, output, path, strlen(path),
+					   nameIndexType(ix, entries[i]), -1, NULL, names,
+					   nrNames);
+		}
+	}
+	return nrResults;
+}
+
+/*
+* description: Catches SIGINT, SIGTERM and SIGHUP with interruptSearch(), so
+* that the threads stop searching and all found paths are written before
+* exiting.
+*/
+void initSignals (void) {
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = interruptSearch;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGHUP, &sa, NULL);
+}
+
+/*
+* description: Signal handler. Sets INTERRUPTED, and stops the running search,
+* if any.
+* param[in]: sig - The signal.
+*/
+void interruptSearch (int sig) {
+
+	INTERRUPTED = sig;
+	mfindSearch *s = SEARCH;
+	if (s != NULL) {
+
+		mfindSearchStop(s);
+	}
+}
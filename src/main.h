@@ -0,0 +1,176 @@
+/*
+* Command line front end of mfind (see mfind.c for its usage). Parses the
+* arguments, and runs the search through libmfind (see libmfind.h), with each
+* thread writing its matches to its own output buffer. A search can also be
+* answered from an index, and an index kept up to date with --watch.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#ifndef __MAIN__
+#define __MAIN__
+
+/* Set to the caught signal's number, when interrupted. The search is then
+stopped, and the process dies by the signal once all output is written		*/
+static volatile sig_atomic_t INTERRUPTED;
+
+/* The running search, for the signal handler to stop						*/
+static _Atomic(mfindSearch *) SEARCH;
+
+/* Typedefs for structs declared other files								*/
+typedef struct outBuffer outBuffer;
+typedef struct targetSet targetSet;
+typedef struct nameIndex nameIndex;
+
+/* Output of one thread of a search - its buffer, and the line a match is
+built in, with more than one target										*/
+typedef struct cliThread {
+
+	outBuffer *out;
+	char *line;
+	size_t lineSize;
+} cliThread;
+
+/* Output of a search, one per thread, written as output (see parseMfind.h)*/
+typedef struct cliOutput {
+
+	mfindSearch *s;
+	cliThread *threads;
+	int output;
+} cliOutput;
+
+/* Most bytes the members of a JSON object other than path and targets take	*/
+#define JSON_FIXED_SIZE 256
+
+/*
+* description: Runs a search of the starting directories, printing each match,
+* or their number with --count, and then the number of directories each
+* thread read (not with --print0 or --json, so that the output is only
+* records).
+* param[in]: a - args struct filled with parsed arguments.
+* return: Number of matches reported.
+*/
+long runSearch (args *a);
+
+/*
+* description: Writes a match to its thread's output buffer (see
+* writeEntry()).
+* param[in]: match - The match.
+* param[in]: data - The output of the search (cliOutput).
+*/
+void printMatch (const mfindMatch *match, void *data);
+
+/*
+* description: Writes a found entry to an output buffer, as a line or a NUL
+* ended path, followed by the targets it matched separated by tabs, or as a
+* JSON object on a line. The record is written in place in the buffer, unless
+* it is larger than the buffer.
+* param[in]: t - Output of the thread.
+* param[in]: output - OUTPUT_LINES, OUTPUT_PRINT0 or OUTPUT_JSON.
+* param[in]: path - Path of the entry.
+* param[in]: pathLen - Length of the path.
+* param[in]: type - Type of the entry.
+* param[in]: depth - Depth of the entry, or -1 if it is not known.
+* param[in]: st - Metadata of the entry, or NULL if it is not known.
+* param[in]: names - The targets it matched, if more than one was searched for.
+* param[in]: nrNames - Number of targets in names.
+*/
+void writeEntry (cliThread *t, int output, const char *path, size_t pathLen,
+				 char type, int depth, const mfindStat *st, const char **names,
+				 int nrNames);
+
+/*
+* description: Writes a found entry as a JSON object, ended by a newline:
+* {"path", "type", "depth", "size", "mtime", "inode", "mode", "targets"}.
+* depth, the metadata and targets are left out if not known. dst must have
+* room for jsonEntrySize() bytes.
+* param[in]: dst - Where to write it.
+* param[in]: path - Path of the entry.
+* param[in]: pathLen - Length of the path.
+* param[in]: type - Type of the entry.
+* param[in]: depth - Depth of the entry, or -1 if it is not known.
+* param[in]: st - Metadata of the entry, or NULL if it is not known.
+* param[in]: names - The targets it matched.
+* param[in]: nrNames - Number of targets in names, 0 to leave them out.
+* return: Number of bytes written.
+*/
+size_t jsonWriteEntry (char *dst, const char *path, size_t pathLen, char type,
+					   int depth, const mfindStat *st, const char **names,
+					   int nrNames);
+
+/*
+* description: Gets the most bytes jsonWriteEntry() may write for an entry -
+* every byte of the path and targets could need to be escaped.
+* param[in]: pathLen - Length of the path.
+* param[in]: names - The targets it matched.
+* param[in]: nrNames - Number of targets in names.
+* return: The number of bytes.
+*/
+size_t jsonEntrySize (size_t pathLen, const char **names, int nrNames);
+
+/*
+* description: Writes a string as a quoted JSON string. Quotes, backslashes
+* and control characters are escaped, and so are bytes that are not part of
+* valid UTF-8 (as \u00XX), so that any name gives valid JSON.
+* param[in]: dst - Where to write it, with room for 2 + 6 * len bytes.
+* param[in]: s - The string.
+* param[in]: len - Length of the string.
+* return: Number of bytes written.
+*/
+size_t jsonWriteString (char *dst, const char *s, size_t len);
+
+/*
+* description: Gets the length of the UTF-8 sequence a multibyte character
+* starts with, if it is valid (not overlong, not a surrogate, and at most
+* U+10FFFF).
+* param[in]: s - The sequence.
+* param[in]: len - Bytes left in the string.
+* return: Its length (2 to 4), or 0 if it is not valid.
+*/
+int utf8SeqLen (const unsigned char *s, size_t len);
+
+/*
+* description: Answers a search from an index built by --build-index, instead
+* of walking the tree. Literal targets are found by binary search, and
+* patterns are matched once against each distinct name in the index.
+* param[in]: a - args struct filled with parsed arguments.
+* return: Number of matches reported.
+*/
+long runIndexQuery (args *a);
+
+/*
+* description: Writes the paths of all entries in an index with a name, if the
+* name matches any target (see writeEntry()). Their depth and metadata are not
+* in the index, so with --json only their path, type and targets are written.
+* param[in]: ix - The index.
+* param[in]: targets - The targets.
+* param[in]: type - Type of target to find, or '\0' for any.
+* param[in]: nameId - Index of the name.
+* param[in]: matched - Scratch for targetSetMatch(), with room for all targets.
+* param[in]: limit - Most matches to report, or -1 for all.
+* param[in]: t - Where the paths are written (see writeEntry()), or NULL if
+* they are only counted.
+* param[in]: output - OUTPUT_LINES, OUTPUT_PRINT0 or OUTPUT_JSON.
+* return: Number of matches reported.
+*/
+long indexPrintMatches (nameIndex *ix, targetSet *targets, char type,
+						uint32_t nameId, int *matched, long limit,
+						cliThread *t, int output);
+
+/*
+* description: Catches SIGINT, SIGTERM and SIGHUP with interruptSearch(), so
+* that the threads stop searching and all found paths are written before
+* exiting.
+*/
+void initSignals (void);
+
+/*
+* description: Signal handler. Sets INTERRUPTED, and stops the running search,
+* if any.
+* param[in]: sig - The signal.
+*/
+void interruptSearch (int sig);
+
+#endif //__MAIN__
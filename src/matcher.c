@@ -0,0 +1,1378 @@
+/*
+* Compiled name matcher. A glob or regex pattern is compiled once into a DFA,
+* which then matches a name in one pass over its bytes, without backtracking
+* and without allocating memory. A literal name is compiled into a signature
+* (length, first and last byte) that rejects almost all names without
+* comparing them, and the rest are compared with SSE2/AVX2 when available. A
+* compiled matcher is read only, so it can be shared by all threads.
+*
+* Globs match the whole name, and support *, ?, [...] (negated with ! or ^)
+* and \ escapes. Regexes are POSIX extended regexes, matching anywhere in the
+* name unless anchored with ^ or $. They support ., [...] (with [:class:]),
+* *, +, ?, {m,n}, |, (...), and the escapes \d \w \s \D \W \S. Back
+* references are not supported.
+*
+* The pattern is parsed into a syntax tree, which is compiled into an NFA
+* (Thompson's construction), which is turned into a DFA (subset construction).
+* A name is matched as the symbols BEGIN, its bytes, END. The anchors ^ and $
+* match the BEGIN and END symbols, which nothing else does.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MATCHER_X86 1
+#else
+#define MATCHER_X86 0
+#endif
+
+#include "matcher.h"
+#include "saferMemHandler.h"
+
+/* Symbols are the 256 byte values plus the BEGIN and END markers			*/
+#define SYM_BEGIN 256
+#define SYM_END 257
+#define NR_SYMS 258
+#define SET_WORDS ((NR_SYMS + 63) / 64)
+
+#define MAX_NFA_STATES 100000
+#define MAX_REPEAT 255
+
+/* Set of symbols															*/
+typedef struct symSet {
+
+	uint64_t bits[SET_WORDS];
+} symSet;
+
+/* Syntax tree node kinds													*/
+#define AST_EMPTY 0
+#define AST_SET 1
+#define AST_CAT 2
+#define AST_ALT 3
+#define AST_REPEAT 4
+
+typedef struct astNode {
+
+	int kind;
+	symSet set;
+	struct astNode *left;
+	struct astNode *right;
+	int min;
+	int max;						/* -1 if there is no upper bound		*/
+} astNode;
+
+/* Parser state. err is set on the first error 								*/
+typedef struct parser {
+
+	const unsigned char *p;
+	const char *err;
+} parser;
+
+/* NFA state kinds															*/
+#define NFA_SET 0
+#define NFA_SPLIT 1
+#define NFA_MATCH 2
+
+/* set is the index of a NFA_SET state's set, or a NFA_MATCH state's
+pattern																		*/
+typedef struct nfaState {
+
+	int kind;
+	int set;
+	int out;
+	int out1;
+} nfaState;
+
+typedef struct nfa {
+
+	nfaState *states;
+	int nrStates;
+	int capacity;
+	symSet *sets;
+	int nrSets;
+	int setCapacity;
+	int overflow;
+} nfa;
+
+/* Compares len bytes of two strings. Chosen at compile time of a literal	*/
+typedef int (*bytesEqualFunc)(const unsigned char *a, const unsigned char *b,
+							  size_t len);
+
+/* A literal is matched by its signature - length, first and last byte -
+before its bytes are compared. For a pattern, transitions are stored
+pre-multiplied by nrClasses, so that a state is the offset of its row. State 0
+is the dead state.															*/
+struct matcher {
+
+	int mode;
+	char *literal;
+	size_t len;
+	unsigned char first;
+	unsigned char last;
+	bytesEqualFunc bytesEqual;
+
+	int nrClasses;
+	unsigned short classOf[NR_SYMS];
+	int start;
+	int *trans;
+	int *acceptStart;
+	int *acceptIds;
+};
+
+/*
+* description: Adds a symbol to a set.
+* param[in]: s - The set.
+* param[in]: sym - The symbol.
+*/
+static void setAdd (symSet *s, int sym) {
+
+	s -> bits[sym / 64] |= (uint64_t)1 << (sym % 64);
+}
+
+/*
+* description: Checks if a symbol is in a set.
+* param[in]: s - The set.
+* param[in]: sym - The symbol.
+* return: If it is; 1, else 0.
+*/
+static int setHas (const symSet *s, int sym) {
+
+	return (s -> bits[sym / 64] >> (sym % 64)) & 1;
+}
+
+/*
+* description: Adds a range of bytes to a set.
+* param[in]: s - The set.
+* param[in]: from - First byte.
+* param[in]: to - Last byte.
+*/
+static void setAddRange (symSet *s, int from, int to) {
+
+	for (int c = from; c <= to; c++) {
+
+		setAdd(s, c);
+	}
+}
+
+/*
+* description: Inverts a set of bytes. BEGIN and END are never in the result.
+* param[in]: s - The set.
+*/
+static void setNegateBytes (symSet *s) {
+
+	for (int c = 0; c < 256; c++) {
+
+		s -> bits[c / 64] ^= (uint64_t)1 << (c % 64);
+	}
+	s -> bits[SYM_BEGIN / 64] &= ~((uint64_t)1 << (SYM_BEGIN % 64));
+	s -> bits[SYM_END / 64] &= ~((uint64_t)1 << (SYM_END % 64));
+}
+
+/*
+* description: Creates a syntax tree node.
+* param[in]: kind - The kind of node.
+* param[in]: left - Left child, or NULL.
+* param[in]: right - Right child, or NULL.
+* return: The node.
+*/
+static astNode *astNew (int kind, astNode *left, astNode *right) {
+
+	astNode *n = scalloc(1, sizeof(*n));
+	n -> kind = kind;
+	n -> left = left;
+	n -> right = right;
+	return n;
+}
+
+/*
+* description: Creates a syntax tree node matching one symbol.
+* param[in]: sym - The symbol.
+* return: The node.
+*/
+static astNode *astSymbol (int sym) {
+
+	astNode *n = astNew(AST_SET, NULL, NULL);
+	setAdd(&n -> set, sym);
+	return n;
+}
+
+/*
+* description: Creates a syntax tree node matching any byte.
+* return: The node.
+*/
+static astNode *astAnyByte (void) {
+
+	astNode *n = astNew(AST_SET, NULL, NULL);
+	setAddRange(&n -> set, 0, 255);
+	return n;
+}
+
+/*
+* description: Creates a syntax tree node repeating a child.
+* param[in]: child - The child.
+* param[in]: min - Minimum number of repetitions.
+* param[in]: max - Maximum number of repetitions, or -1 for no maximum.
+* return: The node.
+*/
+static astNode *astRepeat (astNode *child, int min, int max) {
+
+	astNode *n = astNew(AST_REPEAT, child, NULL);
+	n -> min = min;
+	n -> max = max;
+	return n;
+}
+
+/*
+* description: Concatenates two nodes, either of which may be NULL.
+* param[in]: left - The left node.
+* param[in]: right - The right node.
+* return: The concatenation.
+*/
+static astNode *astCat (astNode *left, astNode *right) {
+
+	if (left == NULL) {
+
+		return right;
+	} else if (right == NULL) {
+
+		return left;
+	}
+	return astNew(AST_CAT, left, right);
+}
+
+/*
+* description: Frees a syntax tree.
+* param[in]: n - The root of the tree.
+*/
+static void astKill (astNode *n) {
+
+	if (n != NULL) {
+
+		astKill(n -> left);
+		astKill(n -> right);
+		sfree(n);
+	}
+}
+
+/*
+* description: Adds a named POSIX character class ([:name:]) to a set.
+* param[in]: s - The set.
+* param[in]: name - Name of the class.
+* param[in]: len - Length of the name.
+* return: If the class exists; 1, else 0.
+*/
+static int setAddPosixClass (symSet *s, const char *name, int len) {
+
+	static const char *names[] = {"alpha", "digit", "alnum", "upper", "lower",
+								  "space", "punct", "xdigit", "blank",
+								  "cntrl", "graph", "print"};
+	int (*tests[])(int) = {isalpha, isdigit, isalnum, isupper, islower,
+						   isspace, ispunct, isxdigit, isblank, iscntrl,
+						   isgraph, isprint};
+	for (size_t i = 0; i < sizeof(names) / sizeof(*names); i++) {
+
+		if ((int)strlen(names[i]) == len && strncmp(names[i], name, len) == 0) {
+
+			for (int c = 0; c < 128; c++) {
+
+				if (tests[i](c)) {
+
+					setAdd(s, c);
+				}
+			}
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+* description: Adds the class of a backslash escape (\d \w \s \D \W \S) to a
+* set, or the escaped byte itself.
+* param[in]: s - The set.
+* param[in]: c - The byte after the backslash.
+*/
+static void setAddEscape (symSet *s, int c) {
+
+	symSet esc;
+	memset(&esc, 0, sizeof(esc));
+	switch (c) {
+
+		case 'd':
+		case 'D':
+			setAddRange(&esc, '0', '9');
+			break;
+
+		case 'w':
+		case 'W':
+			setAddRange(&esc, '0', '9');
+			setAddRange(&esc, 'a', 'z');
+			setAddRange(&esc, 'A', 'Z');
+			setAdd(&esc, '_');
+			break;
+
+		case 's':
+		case 'S':
+			setAddPosixClass(&esc, "space", 5);
+			break;
+
+		case 't':
+			setAdd(&esc, '\t');
+			break;
+
+		case 'n':
+			setAdd(&esc, '\n');
+			break;
+
+		default:
+			setAdd(&esc, c);
+			break;
+	}
+	if (c == 'D' || c == 'W' || c == 'S') {
+
+		setNegateBytes(&esc);
+	}
+	for (int i = 0; i < SET_WORDS; i++) {
+
+		s -> bits[i] |= esc.bits[i];
+	}
+}
+
+/*
+* description: Checks if a regex escape is supported - a class escape (\d \w
+* \s \D \W \S), \t, \n, or an escaped punctuation character or byte that
+* is matched as itself. Other escapes of letters and digits, such as \b or
+* back references, and the word boundaries \< and \> are not.
+* param[in]: c - The byte after the backslash.
+* return: If it is supported; 1, else 0.
+*/
+static int escapeSupported (int c) {
+
+	if (isalnum(c)) {
+
+		return strchr("dwsDWStn", c) != NULL;
+	}
+	return c != '<' && c != '>';
+}
+
+/*
+* description: Parses a bracket expression. The parser must point just after
+* the opening [.
+* param[in]: ps - The parser.
+* param[in]: glob - If 1, ! also negates, and there are no [:class:].
+* return: The node, or NULL on error.
+*/
+static astNode *parseBracket (parser *ps, int glob) {
+
+	astNode *n = astNew(AST_SET, NULL, NULL);
+	int negate = 0;
+	if (*ps -> p == '^' || (glob && *ps -> p == '!')) {
+
+		negate = 1;
+		ps -> p++;
+	}
+	int first = 1;
+	while (*ps -> p != ']' || first) {
+
+		first = 0;
+		int c = *ps -> p;
+		if (c == '\0') {
+
+			ps -> err = "missing ]";
+			astKill(n);
+			return NULL;
+		}
+		if (!glob && c == '[' && ps -> p[1] == ':') {
+
+			const char *name = (const char *)ps -> p + 2;
+			const char *end = strstr(name, ":]");
+			if (end == NULL ||
+				!setAddPosixClass(&n -> set, name, end - name)) {
+
+				ps -> err = "invalid character class";
+				astKill(n);
+				return NULL;
+			}
+			ps -> p = (const unsigned char *)end + 2;
+			continue;
+		}
+		if (c == '\\' && ps -> p[1] != '\0') {
+
+			ps -> p++;
+			c = *ps -> p;
+			if (!glob && !escapeSupported(c)) {
+
+				ps -> err = "unsupported escape";
+				astKill(n);
+				return NULL;
+			}
+			if (!glob && strchr("dwsDWS", c) != NULL) {
+
+				setAddEscape(&n -> set, c);
+				ps -> p++;
+				continue;
+			}
+		}
+		ps -> p++;
+		if (*ps -> p == '-' && ps -> p[1] != ']' && ps -> p[1] != '\0') {
+
+			int to = ps -> p[1];
+			ps -> p += 2;
+			if (to == '\\' && *ps -> p != '\0') {
+
+				to = *ps -> p;
+				ps -> p++;
+			}
+			if (to < c) {
+
+				ps -> err = "invalid range";
+				astKill(n);
+				return NULL;
+			}
+			setAddRange(&n -> set, c, to);
+		} else {
+
+			setAdd(&n -> set, c);
+		}
+	}
+	ps -> p++;
+	if (negate) {
+
+		setNegateBytes(&n -> set);
+	}
+	return n;
+}
+
+static astNode *parseAlt (parser *ps);
+
+/*
+* description: Parses a regex atom - a group, bracket expression, anchor,
+* escape or byte.
+* param[in]: ps - The parser.
+* return: The node, or NULL on error.
+*/
+static astNode *parseAtom (parser *ps) {
+
+	int c = *ps -> p;
+	ps -> p++;
+	switch (c) {
+
+		case '(': {
+			astNode *n = parseAlt(ps);
+			if (ps -> err == NULL && *ps -> p != ')') {
+
+				ps -> err = "missing )";
+			}
+			if (ps -> err != NULL) {
+
+				astKill(n);
+				return NULL;
+			}
+			ps -> p++;
+			return n != NULL ? n : astNew(AST_EMPTY, NULL, NULL);
+		}
+
+		case '[':
+			return parseBracket(ps, 0);
+
+		case '.':
+			return astAnyByte();
+
+		case '^':
+			return astSymbol(SYM_BEGIN);
+
+		case '$':
+			return astSymbol(SYM_END);
+
+		case '\\': {
+			if (*ps -> p == '\0') {
+
+				ps -> err = "trailing \\";
+				return NULL;
+			} else if (!escapeSupported(*ps -> p)) {
+
+				ps -> err = "unsupported escape";
+				return NULL;
+			}
+			astNode *n = astNew(AST_SET, NULL, NULL);
+			setAddEscape(&n -> set, *ps -> p);
+			ps -> p++;
+			return n;
+		}
+
+		case '*':
+		case '+':
+		case '?':
+			ps -> err = "nothing to repeat";
+			return NULL;
+
+		default:
+			return astSymbol(c);
+	}
+}
+
+/*
+* description: Parses a bounded repetition {m}, {m,} or {m,n}. The parser
+* must point at the {. If it is not a valid bound, nothing is parsed.
+* param[in]: ps - The parser.
+* param[out]: min - The minimum.
+* param[out]: max - The maximum, or -1 for no maximum.
+* return: If a bound was parsed; 1, else 0.
+*/
+static int parseBound (parser *ps, int *min, int *max) {
+
+	const unsigned char *p = ps -> p + 1;
+	if (!isdigit(*p)) {
+
+		return 0;
+	}
+	*min = 0;
+	while (isdigit(*p) && *min <= MAX_REPEAT) {
+
+		*min = *min * 10 + *p++ - '0';
+	}
+	*max = *min;
+	if (*p == ',') {
+
+		p++;
+		*max = -1;
+		if (isdigit(*p)) {
+
+			*max = 0;
+			while (isdigit(*p) && *max <= MAX_REPEAT) {
+
+				*max = *max * 10 + *p++ - '0';
+			}
+		}
+	}
+	if (*p != '}') {
+
+		return 0;
+	}
+	if (*min > MAX_REPEAT || *max > MAX_REPEAT || (*max != -1 && *max < *min)) {
+
+		ps -> err = "invalid repetition bound";
+		return 0;
+	}
+	ps -> p = p + 1;
+	return 1;
+}
+
+/*
+* description: Parses an atom followed by any number of *, +, ? or {m,n}.
+* param[in]: ps - The parser.
+* return: The node, or NULL on error.
+*/
+static astNode *parseRepeat (parser *ps) {
+
+	astNode *n = parseAtom(ps);
+	int min, max;
+	while (n != NULL && ps -> err == NULL) {
+
+		if (*ps -> p == '*') {
+
+			n = astRepeat(n, 0, -1);
+		} else if (*ps -> p == '+') {
+
+			n = astRepeat(n, 1, -1);
+		} else if (*ps -> p == '?') {
+
+			n = astRepeat(n, 0, 1);
+		} else if (*ps -> p == '{' && parseBound(ps, &min, &max)) {
+
+			n = astRepeat(n, min, max);
+			continue;
+		} else {
+
+			break;
+		}
+		ps -> p++;
+	}
+	if (ps -> err != NULL) {
+
+		astKill(n);
+		return NULL;
+	}
+	return n;
+}
+
+/*
+* description: Parses a concatenation, up to the next | or ) or the end.
+* param[in]: ps - The parser.
+* return: The node (NULL if empty, or on error).
+*/
+static astNode *parseCat (parser *ps) {
+
+	astNode *n = NULL;
+	while (*ps -> p != '\0' && *ps -> p != '|' && *ps -> p != ')') {
+
+		astNode *next = parseRepeat(ps);
+		if (ps -> err != NULL) {
+
+			astKill(n);
+			return NULL;
+		}
+		n = astCat(n, next);
+	}
+	return n;
+}
+
+/*
+* description: Parses alternatives separated by |.
+* param[in]: ps - The parser.
+* return: The node (NULL if empty, or on error).
+*/
+static astNode *parseAlt (parser *ps) {
+
+	astNode *n = parseCat(ps);
+	while (ps -> err == NULL && *ps -> p == '|') {
+
+		ps -> p++;
+		astNode *right = parseCat(ps);
+		if (n == NULL) {
+
+			n = astNew(AST_EMPTY, NULL, NULL);
+		}
+		if (right == NULL) {
+
+			right = astNew(AST_EMPTY, NULL, NULL);
+		}
+		n = astNew(AST_ALT, n, right);
+	}
+	if (ps -> err != NULL) {
+
+		astKill(n);
+		return NULL;
+	}
+	return n;
+}
+
+/*
+* description: Parses a regex. Unless anchored, it may match anywhere, so it is
+* surrounded by repetitions of any symbol.
+* param[in]: ps - The parser.
+* return: The syntax tree, or NULL on error.
+*/
+static astNode *parseRegex (parser *ps) {
+
+	astNode *n = parseAlt(ps);
+	if (ps -> err == NULL && *ps -> p == ')') {
+
+		ps -> err = "unmatched )";
+	}
+	if (ps -> err != NULL) {
+
+		astKill(n);
+		return NULL;
+	}
+	astNode *any = astNew(AST_SET, NULL, NULL);
+	setAddRange(&any -> set, 0, NR_SYMS - 1);
+	astNode *any2 = astNew(AST_SET, NULL, NULL);
+	any2 -> set = any -> set;
+	return astCat(astRepeat(any, 0, -1), astCat(n, astRepeat(any2, 0, -1)));
+}
+
+/*
+* description: Parses a glob. It must match the whole name.
+* param[in]: ps - The parser.
+* return: The syntax tree, or NULL on error.
+*/
+static astNode *parseGlob (parser *ps) {
+
+	astNode *n = astSymbol(SYM_BEGIN);
+	while (*ps -> p != '\0') {
+
+		int c = *ps -> p;
+		ps -> p++;
+		if (c == '*') {
+
+			n = astCat(n, astRepeat(astAnyByte(), 0, -1));
+		} else if (c == '?') {
+
+			n = astCat(n, astAnyByte());
+		} else if (c == '[') {
+
+			astNode *set = parseBracket(ps, 1);
+			if (set == NULL) {
+
+				astKill(n);
+				return NULL;
+			}
+			n = astCat(n, set);
+		} else if (c == '\\' && *ps -> p != '\0') {
+
+			n = astCat(n, astSymbol(*ps -> p));
+			ps -> p++;
+		} else {
+
+			n = astCat(n, astSymbol(c));
+		}
+	}
+	return astCat(n, astSymbol(SYM_END));
+}
+
+/*
+* description: Adds a state to an NFA.
+* param[in]: a - The NFA.
+* param[in]: kind - Kind of state.
+* param[in]: out - First transition.
+* param[in]: out1 - Second transition (NFA_SPLIT only).
+* return: Index of the state.
+*/
+static int nfaAdd (nfa *a, int kind, int out, int out1) {
+
+	if (a -> nrStates == MAX_NFA_STATES) {
+
+		a -> overflow = 1;
+		return 0;
+	}
+	if (a -> nrStates == a -> capacity) {
+
+		a -> capacity *= 2;
+		a -> states = srealloc(a -> states,
+							   sizeof(*a -> states) * a -> capacity);
+	}
+	nfaState *s = &a -> states[a -> nrStates];
+	s -> kind = kind;
+	s -> set = -1;
+	s -> out = out;
+	s -> out1 = out1;
+	return a -> nrStates++;
+}
+
+/*
+* description: Compiles a syntax tree into NFA states, backwards from the
+* state that follows it.
+* param[in]: a - The NFA.
+* param[in]: n - The syntax tree.
+* param[in]: next - The state to go to after n has matched.
+* return: The entry state of n.
+*/
+static int nfaCompile (nfa *a, astNode *n, int next) {
+
+	int entry = next;
+	switch (n -> kind) {
+
+		case AST_EMPTY:
+			break;
+
+		case AST_SET:
+			if (a -> nrSets == a -> setCapacity) {
+
+				a -> setCapacity *= 2;
+				a -> sets = srealloc(a -> sets,
+									 sizeof(*a -> sets) * a -> setCapacity);
+			}
+			a -> sets[a -> nrSets] = n -> set;
+			entry = nfaAdd(a, NFA_SET, next, -1);
+			a -> states[entry].set = a -> nrSets++;
+			break;
+
+		case AST_CAT:
+			entry = nfaCompile(a, n -> left, nfaCompile(a, n -> right, next));
+			break;
+
+		case AST_ALT:
+			entry = nfaAdd(a, NFA_SPLIT, nfaCompile(a, n -> left, next),
+						   nfaCompile(a, n -> right, next));
+			break;
+
+		case AST_REPEAT:
+			if (n -> max == -1) {
+
+				int loop = nfaAdd(a, NFA_SPLIT, -1, next);
+				int body = nfaCompile(a, n -> left, loop);
+				a -> states[loop].out = body;
+				entry = loop;
+			} else {
+
+				for (int i = n -> min; i < n -> max && !a -> overflow; i++) {
+
+					entry = nfaAdd(a, NFA_SPLIT,
+								   nfaCompile(a, n -> left, entry), next);
+				}
+			}
+			for (int i = 0; i < n -> min && !a -> overflow; i++) {
+
+				entry = nfaCompile(a, n -> left, entry);
+			}
+			break;
+
+		default:
+			break;
+	}
+	return entry;
+}
+
+/*
+* description: Adds the epsilon closure of an NFA state to a list of states.
+* Only NFA_SET and NFA_MATCH states are added.
+* param[in]: a - The NFA.
+* param[in]: state - The state.
+* param[in]: mark - Marks of states already visited, for this closure.
+* param[in]: gen - Mark value of this closure.
+* param[in]: stack - Scratch stack of 2 * nrStates + 1 entries.
+* param[out]: list - The list, to be added to.
+* param[out]: len - Length of the list.
+*/
+static void nfaClosure (nfa *a, int state, int *mark, int gen, int *stack,
+						int *list, int *len) {
+
+	int top = 0;
+	stack[top++] = state;
+	while (top > 0) {
+
+		int s = stack[--top];
+		if (s < 0 || mark[s] == gen) {
+
+			continue;
+		}
+		mark[s] = gen;
+		if (a -> states[s].kind == NFA_SPLIT) {
+
+			stack[top++] = a -> states[s].out1;
+			stack[top++] = a -> states[s].out;
+		} else {
+
+			list[(*len)++] = s;
+		}
+	}
+}
+
+/*
+* description: Compare function for qsort of state indexes.
+* param[in]: a - First index.
+* param[in]: b - Second index.
+* return: Negative, 0 or positive.
+*/
+static int cmpInt (const void *a, const void *b) {
+
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+* description: Splits all symbols into classes, where the symbols of a class
+* are in exactly the same NFA sets, so the DFA only needs one column per class.
+* param[in]: a - The NFA.
+* param[out]: m - The matcher, whose classOf and nrClasses are set.
+* param[out]: rep - One symbol of each class.
+*/
+static void computeClasses (nfa *a, matcher *m, int rep[NR_SYMS]) {
+
+	int newClass[NR_SYMS * 2];
+	memset(m -> classOf, 0, sizeof(m -> classOf));
+	m -> nrClasses = 1;
+	for (int i = 0; i < a -> nrSets; i++) {
+
+		for (int j = 0; j < m -> nrClasses * 2; j++) {
+
+			newClass[j] = -1;
+		}
+		int nr = 0;
+		for (int sym = 0; sym < NR_SYMS; sym++) {
+
+			int key = m -> classOf[sym] * 2 + setHas(&a -> sets[i], sym);
+			if (newClass[key] == -1) {
+
+				newClass[key] = nr++;
+			}
+			m -> classOf[sym] = newClass[key];
+		}
+		m -> nrClasses = nr;
+	}
+	for (int sym = NR_SYMS - 1; sym >= 0; sym--) {
+
+		rep[m -> classOf[sym]] = sym;
+	}
+}
+
+/*
+* description: Gets the hash of a list of states.
+* param[in]: list - The list.
+* param[in]: len - Length of the list.
+* return: The hash.
+*/
+static unsigned int hashStates (const int *list, int len) {
+
+	unsigned int h = 2166136261u;
+	for (int i = 0; i < len; i++) {
+
+		h = (h ^ (unsigned int)list[i]) * 16777619u;
+	}
+	return h;
+}
+
+/*
+* description: Builds the DFA of a matcher from an NFA, by subset
+* construction. Each DFA state is a sorted list of NFA states.
+* param[in]: a - The NFA.
+* param[in]: start - The NFA's start state.
+* param[out]: m - The matcher.
+* return: If the DFA has at most MATCHER_MAX_STATES states; 1, else 0.
+*/
+static int buildDfa (nfa *a, int start, matcher *m) {
+
+	int rep[NR_SYMS];
+	computeClasses(a, m, rep);
+	int nc = m -> nrClasses;
+
+	int *mark = scalloc(a -> nrStates, sizeof(*mark));
+	int *stack = smalloc(sizeof(*stack) * (a -> nrStates * 2 + 1));
+	int *scratch = smalloc(sizeof(*scratch) * a -> nrStates);
+	int gen = 0;
+
+	/* DFA states' NFA state lists, and a hash table from list to DFA state	*/
+	int **lists = smalloc(sizeof(*lists) * MATCHER_MAX_STATES);
+	int *lens = smalloc(sizeof(*lens) * MATCHER_MAX_STATES);
+	int tableSize = MATCHER_MAX_STATES * 2;
+	int *table = smalloc(sizeof(*table) * tableSize);
+	for (int i = 0; i < tableSize; i++) {
+
+		table[i] = -1;
+	}
+	m -> trans = smalloc(sizeof(*m -> trans) * nc);
+	int nrDfa = 0;
+	int ok = 1;
+
+	/* Dead state first, then the start state. Both are added to the table	*/
+	int len = 0;
+	for (int pass = 0; pass < 2; pass++) {
+
+		if (pass == 1) {
+
+			gen++;
+			nfaClosure(a, start, mark, gen, stack, scratch, &len);
+			qsort(scratch, len, sizeof(*scratch), cmpInt);
+		}
+		unsigned int h = hashStates(scratch, len) % tableSize;
+		while (table[h] != -1) {
+
+			h = (h + 1) % tableSize;
+		}
+		table[h] = nrDfa;
+		lists[nrDfa] = smalloc(sizeof(int) * (len + 1));
+		memcpy(lists[nrDfa], scratch, sizeof(int) * len);
+		lens[nrDfa] = len;
+		nrDfa++;
+	}
+	m -> start = nc;
+
+	for (int d = 0; d < nrDfa && ok; d++) {
+
+		m -> trans = srealloc(m -> trans, sizeof(*m -> trans) * nc * nrDfa);
+		for (int c = 0; c < nc && ok; c++) {
+
+			gen++;
+			len = 0;
+			for (int i = 0; i < lens[d]; i++) {
+
+				nfaState *s = &a -> states[lists[d][i]];
+				if (s -> kind == NFA_SET &&
+					setHas(&a -> sets[s -> set], rep[c])) {
+
+					nfaClosure(a, s -> out, mark, gen, stack, scratch, &len);
+				}
+			}
+			qsort(scratch, len, sizeof(*scratch), cmpInt);
+
+			unsigned int h = hashStates(scratch, len) % tableSize;
+			while (table[h] != -1 && (lens[table[h]] != len ||
+				   memcmp(lists[table[h]], scratch, sizeof(int) * len) != 0)) {
+
+				h = (h + 1) % tableSize;
+			}
+			if (table[h] == -1) {
+
+				if (nrDfa == MATCHER_MAX_STATES) {
+
+					ok = 0;
+					break;
+				}
+				table[h] = nrDfa;
+				lists[nrDfa] = smalloc(sizeof(int) * (len + 1));
+				memcpy(lists[nrDfa], scratch, sizeof(int) * len);
+				lens[nrDfa] = len;
+				nrDfa++;
+				m -> trans = srealloc(m -> trans,
+									  sizeof(*m -> trans) * nc * nrDfa);
+			}
+			m -> trans[d * nc + c] = table[h] * nc;
+		}
+	}
+
+	/* Patterns accepted in each state, sorted. Each pattern has exactly one
+	NFA_MATCH state, so no pattern is listed twice							*/
+	if (ok) {
+
+		int nrIds = 0;
+		m -> acceptStart = smalloc(sizeof(*m -> acceptStart) * (nrDfa + 1));
+		m -> acceptIds = smalloc(sizeof(*m -> acceptIds));
+		for (int d = 0; d < nrDfa; d++) {
+
+			m -> acceptStart[d] = nrIds;
+			for (int i = 0; i < lens[d]; i++) {
+
+				nfaState *s = &a -> states[lists[d][i]];
+				if (s -> kind == NFA_MATCH) {
+
+					m -> acceptIds = srealloc(m -> acceptIds,
+									sizeof(*m -> acceptIds) * (nrIds + 1));
+					m -> acceptIds[nrIds++] = s -> set;
+				}
+			}
+			qsort(&m -> acceptIds[m -> acceptStart[d]],
+				  nrIds - m -> acceptStart[d], sizeof(int), cmpInt);
+		}
+		m -> acceptStart[nrDfa] = nrIds;
+	}
+
+	for (int d = 0; d < nrDfa; d++) {
+
+		sfree(lists[d]);
+	}
+	sfree(lists);
+	sfree(lens);
+	sfree(table);
+	sfree(mark);
+	sfree(stack);
+	sfree(scratch);
+	return ok;
+}
+
+/*
+* description: Compares bytes one at a time.
+* param[in]: a - First string.
+* param[in]: b - Second string.
+* param[in]: len - Number of bytes to compare.
+* return: If the bytes equal; 1, else 0.
+*/
+static int bytesEqualScalar (const unsigned char *a, const unsigned char *b,
+							 size_t len) {
+
+	for (size_t i = 0; i < len; i++) {
+
+		if (a[i] != b[i]) {
+
+			return 0;
+		}
+	}
+	return 1;
+}
+
+#if MATCHER_X86
+
+/*
+* description: Compares bytes 16 at a time with SSE2. The last block overlaps
+* the one before it, so no byte past len is read.
+* param[in]: a - First string.
+* param[in]: b - Second string.
+* param[in]: len - Number of bytes to compare.
+* return: If the bytes equal; 1, else 0.
+*/
+__attribute__((target("sse2")))
+static int bytesEqualSse2 (const unsigned char *a, const unsigned char *b,
+						   size_t len) {
+
+	if (len < 16) {
+
+		return bytesEqualScalar(a, b, len);
+	}
+	size_t i = 0;
+	for (; i + 16 <= len; i += 16) {
+
+		__m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+		__m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xffff) {
+
+			return 0;
+		}
+	}
+	if (i < len) {
+
+		__m128i x = _mm_loadu_si128((const __m128i *)(a + len - 16));
+		__m128i y = _mm_loadu_si128((const __m128i *)(b + len - 16));
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) == 0xffff;
+	}
+	return 1;
+}
+
+/*
+* description: Compares bytes 32 at a time with AVX2. The last block overlaps
+* the one before it, so no byte past len is read.
+* param[in]: a - First string.
+* param[in]: b - Second string.
+* param[in]: len - Number of bytes to compare.
+* return: If the bytes equal; 1, else 0.
+*/
+__attribute__((target("avx2")))
+static int bytesEqualAvx2 (const unsigned char *a, const unsigned char *b,
+						   size_t len) {
+
+	if (len < 32) {
+
+		return bytesEqualSse2(a, b, len);
+	}
+	size_t i = 0;
+	for (; i + 32 <= len; i += 32) {
+
+		__m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+		__m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+		if ((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) !=
+			0xffffffffu) {
+
+			return 0;
+		}
+	}
+	if (i < len) {
+
+		__m256i x = _mm256_loadu_si256((const __m256i *)(a + len - 32));
+		__m256i y = _mm256_loadu_si256((const __m256i *)(b + len - 32));
+		return (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) ==
+			   0xffffffffu;
+	}
+	return 1;
+}
+
+#endif
+
+/*
+* description: Compiles a literal name into a matcher - its signature, and
+* the fastest byte comparison this CPU supports.
+* param[in]: name - The name.
+* return: The matcher.
+*/
+static matcher *matcherCompileLiteral (const char *name) {
+
+	matcher *m = scalloc(1, sizeof(*m));
+	m -> mode = MATCH_LITERAL;
+	m -> len = strlen(name);
+	m -> literal = smalloc(m -> len + 1);
+	memcpy(m -> literal, name, m -> len + 1);
+	m -> first = (unsigned char)name[0];
+	m -> last = m -> len > 0 ? (unsigned char)name[m -> len - 1] : '\0';
+	m -> bytesEqual = bytesEqualScalar;
+#if MATCHER_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+
+		m -> bytesEqual = bytesEqualAvx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+
+		m -> bytesEqual = bytesEqualSse2;
+	}
+#endif
+	return m;
+}
+
+/*
+* description: Checks if a name equals a literal. The first byte rejects most
+* names before their length is known, and the length and last byte most of
+* the rest, before any other byte is compared.
+* param[in]: m - The literal's matcher.
+* param[in]: name - The name, NULL-terminated.
+* return: If the name equals the literal; 1, else 0.
+*/
+static int matcherMatchLiteral (matcher *m, const char *name) {
+
+	if ((unsigned char)name[0] != m -> first) {
+
+		return 0;
+	} else if (m -> len == 0) {
+
+		return 1;
+	}
+	size_t len = strlen(name);
+	if (len != m -> len || (unsigned char)name[len - 1] != m -> last) {
+
+		return 0;
+	}
+	return m -> bytesEqual((const unsigned char *)name + 1,
+						   (const unsigned char *)m -> literal + 1,
+						   len < 2 ? 0 : len - 2);
+}
+
+/*
+* description: Compiles glob or regex patterns into one DFA, which accepts a
+* name if any of the patterns matches it. Pattern i is accepted as id i.
+* param[in]: patterns - The patterns.
+* param[in]: nrPatterns - Number of patterns.
+* param[in]: mode - MATCH_GLOB or MATCH_REGEX.
+* param[out]: complex - Set to 1 if the DFA would be too large, else 0.
+* return: The matcher, or NULL if a pattern is invalid (a message is printed
+* to stderr), or if the DFA would be too large.
+*/
+static matcher *matcherCompilePatterns (char **patterns, int nrPatterns,
+										int mode, int *complex) {
+
+	nfa a;
+	a.capacity = 64;
+	a.states = smalloc(sizeof(*a.states) * a.capacity);
+	a.nrStates = 0;
+	a.setCapacity = 16;
+	a.sets = smalloc(sizeof(*a.sets) * a.setCapacity);
+	a.nrSets = 0;
+	a.overflow = 0;
+	*complex = 0;
+
+	/* Each pattern gets its own NFA_MATCH state. Start splits into all		*/
+	int start = -1;
+	for (int i = nrPatterns - 1; i >= 0; i--) {
+
+		parser ps;
+		ps.p = (const unsigned char *)patterns[i];
+		ps.err = NULL;
+		astNode *ast = mode == MATCH_GLOB ? parseGlob(&ps) : parseRegex(&ps);
+		if (ast == NULL) {
+
+			fprintf(stderr, "Invalid pattern %s: %s\n", patterns[i], ps.err);
+			sfree(a.states);
+			sfree(a.sets);
+			return NULL;
+		}
+		int match = nfaAdd(&a, NFA_MATCH, -1, -1);
+		a.states[match].set = i;
+		int entry = nfaCompile(&a, ast, match);
+		astKill(ast);
+		start = start == -1 ? entry : nfaAdd(&a, NFA_SPLIT, entry, start);
+	}
+
+	matcher *m = scalloc(1, sizeof(*m));
+	m -> mode = mode;
+	if (a.overflow || !buildDfa(&a, start, m)) {
+
+		*complex = 1;
+		matcherKill(m);
+		m = NULL;
+	}
+	sfree(a.states);
+	sfree(a.sets);
+	return m;
+}
+
+/*
+* description: Compiles a pattern into a matcher. If the pattern is invalid, or
+* too complex, a message is printed to stderr.
+* param[in]: pattern - The pattern.
+* param[in]: mode - MATCH_LITERAL, MATCH_GLOB or MATCH_REGEX.
+* return: The matcher, or NULL if the pattern could not be compiled.
+*/
+matcher *matcherCompile (const char *pattern, int mode) {
+
+	if (mode == MATCH_LITERAL) {
+
+		return matcherCompileLiteral(pattern);
+	}
+	char *patterns[] = {(char *)pattern};
+	int complex;
+	matcher *m = matcherCompilePatterns(patterns, 1, mode, &complex);
+	if (complex) {
+
+		fprintf(stderr, "Invalid pattern %s: too complex\n", pattern);
+	}
+	return m;
+}
+
+/*
+* description: Compiles glob or regex patterns into one combined matcher, so
+* that a name is matched against all of them in one pass. If a pattern is
+* invalid, a message is printed to stderr. If the patterns are valid but
+* together too complex, no message is printed, and complex is set - they can
+* then be compiled and matched one at a time.
+* param[in]: patterns - The patterns.
+* param[in]: nrPatterns - Number of patterns.
+* param[in]: mode - MATCH_GLOB or MATCH_REGEX.
+* param[out]: complex - Set to 1 if the patterns were too complex, else 0.
+* return: The matcher, or NULL if the patterns could not be compiled.
+*/
+matcher *matcherCompileSet (char **patterns, int nrPatterns, int mode,
+							int *complex) {
+
+	return matcherCompilePatterns(patterns, nrPatterns, mode, complex);
+}
+
+/*
+* description: Checks if a name matches the compiled pattern.
+* param[in]: m - The matcher.
+* param[in]: name - The name, NULL-terminated.
+* return: If the name matches; 1, else 0.
+*/
+int matcherMatch (matcher *m, const char *name) {
+
+	if (m -> mode == MATCH_LITERAL) {
+
+		return matcherMatchLiteral(m, name);
+	}
+	const int *trans = m -> trans;
+	const unsigned short *classOf = m -> classOf;
+	int s = trans[m -> start + classOf[SYM_BEGIN]];
+	for (const unsigned char *p = (const unsigned char *)name;
+		 *p != '\0' && s != 0; p++) {
+
+		s = trans[s + classOf[*p]];
+	}
+	if (s == 0) {
+
+		return 0;
+	}
+	s = trans[s + classOf[SYM_END]] / m -> nrClasses;
+	return m -> acceptStart[s + 1] > m -> acceptStart[s];
+}
+
+/*
+* description: Gets all patterns of a combined matcher that match a name.
+* param[in]: m - The matcher.
+* param[in]: name - The name, NULL-terminated.
+* param[out]: ids - Set to the sorted ids of the matching patterns. Points
+* into the matcher, and must not be free'd.
+* return: Number of matching patterns.
+*/
+int matcherMatchAll (matcher *m, const char *name, const int **ids) {
+
+	static const int literalId = 0;
+	if (m -> mode == MATCH_LITERAL) {
+
+		*ids = &literalId;
+		return matcherMatchLiteral(m, name);
+	}
+	const int *trans = m -> trans;
+	const unsigned short *classOf = m -> classOf;
+	int s = trans[m -> start + classOf[SYM_BEGIN]];
+	for (const unsigned char *p = (const unsigned char *)name;
+		 *p != '\0' && s != 0; p++) {
+
+		s = trans[s + classOf[*p]];
+	}
+	if (s == 0) {
+
+		return 0;
+	}
+	s = trans[s + classOf[SYM_END]] / m -> nrClasses;
+	*ids = &m -> acceptIds[m -> acceptStart[s]];
+	return m -> acceptStart[s + 1] - m -> acceptStart[s];
+}
+
+/*
+* description: Frees all memory allocated by the matcher, including the
+* matcher.
+* param[in]: m - The matcher.
+*/
+void matcherKill (matcher *m) {
+
+	if (m != NULL) {
+
+		sfree(m -> literal);
+		sfree(m -> trans);
+		sfree(m -> acceptStart);
+		sfree(m -> acceptIds);
+		sfree(m);
+	}
+}
@@ -0,0 +1,85 @@
+/*
+* Compiled name matcher. A glob or regex pattern is compiled once into a DFA,
+* which then matches a name in one pass over its bytes, without backtracking
+* and without allocating memory. A literal name is compiled into a signature
+* (length, first and last byte) that rejects almost all names without
+* comparing them, and the rest are compared with SSE2/AVX2 when available. A
+* compiled matcher is read only, so it can be shared by all threads.
+*
+* Globs match the whole name, and support *, ?, [...] (negated with ! or ^)
+* and \ escapes. An unclosed [ is an error; \[ matches a [. Regexes are
+* POSIX extended regexes, matching anywhere in the name unless anchored with
+* ^ or $. They support ., [...] (with [:class:]), *, +, ?, {m,n}, |, (...),
+* and, beyond POSIX, the escapes \d \w \s \D \W \S \t \n. Back references
+* and other escapes of letters and digits (such as \b, or \< and \>) are
+* rejected. Names are matched as bytes, so ?, . and [...] match one byte,
+* not one UTF-8 character.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#ifndef __MATCHER__
+#define __MATCHER__
+
+/* How a pattern is interpreted												*/
+#define MATCH_LITERAL 0
+#define MATCH_GLOB 1
+#define MATCH_REGEX 2
+
+/* Maximum number of DFA states a pattern may compile to					*/
+#define MATCHER_MAX_STATES 4096
+
+typedef struct matcher matcher;
+
+/*
+* description: Compiles a pattern into a matcher. If the pattern is invalid, or
+* too complex, a message is printed to stderr.
+* param[in]: pattern - The pattern.
+* param[in]: mode - MATCH_LITERAL, MATCH_GLOB or MATCH_REGEX.
+* return: The matcher, or NULL if the pattern could not be compiled.
+*/
+matcher *matcherCompile (const char *pattern, int mode);
+
+/*
+* description: Compiles glob or regex patterns into one combined matcher, so
+* that a name is matched against all of them in one pass. If a pattern is
+* invalid, a message is printed to stderr. If the patterns are valid but
+* together too complex, no message is printed, and complex is set - they can
+* then be compiled and matched one at a time.
+* param[in]: patterns - The patterns.
+* param[in]: nrPatterns - Number of patterns.
+* param[in]: mode - MATCH_GLOB or MATCH_REGEX.
+* param[out]: complex - Set to 1 if the patterns were too complex, else 0.
+* return: The matcher, or NULL if the patterns could not be compiled.
+*/
+matcher *matcherCompileSet (char **patterns, int nrPatterns, int mode,
+							int *complex);
+
+/*
+* description: Checks if a name matches the compiled pattern.
+* param[in]: m - The matcher.
+* param[in]: name - The name, NULL-terminated.
+* return: If the name matches; 1, else 0.
+*/
+int matcherMatch (matcher *m, const char *name);
+
+/*
+* description: Gets all patterns of a combined matcher that match a name.
+* param[in]: m - The matcher.
+* param[in]: name - The name, NULL-terminated.
+* param[out]: ids - Set to the sorted ids of the matching patterns. Points
+* into the matcher, and must not be free'd.
+* return: Number of matching patterns.
+*/
+int matcherMatchAll (matcher *m, const char *name, const int **ids);
+
+/*
+* description: Frees all memory allocated by the matcher, including the
+* matcher.
+* param[in]: m - The matcher.
+*/
+void matcherKill (matcher *m);
+
+#endif //__MATCHER__
@@ -2,19 +2,156 @@
 * mfind - Find a specific file, link or directory from a starting directory
 * tree.
 *
-* Synopsis: mfind [-t type] [-p nrthr] start1 [start2 ...] target
+* Synopsis: mfind [-t type] [-p nrthr] [-g | -r] [--fd-budget n]
+* [--dir-buffer size] [--io-uring[=depth]] start1 [start2 ...] target
+*
+* mfind [options] -e target [-e target ...] [-T file] start1 [start2 ...]
+*
+* mfind [options] --where expression start1 [start2 ...] [-e target]
+*
+* mfind [options] --build-index file start1 [start2 ...]
+*
+* mfind [options] --watch file [--rescan seconds] start1 [start2 ...]
+*
+* mfind [-t type] [-g | -r] --index file target (or -e/-T targets)
 *
 * -t		Type of target to find. f=file, d=directory, l=link. If empty,
 * mfind will search for any of these.
 *
 * -p		Number of threads that mfind will use to search for the target.
-* Default value is 1. Must be a positive integer.
+* Default value is 1. Must be a positive integer, or auto to let mfind tune
+* the number while searching: it starts with 2 threads, and keeps adding
+* threads while that makes it read directories faster, up to 4 per CPU (at
+* most 64), or n if given as auto:n.
+* The entries of a directory beyond the first 4096 are split among all
+* threads, so that a huge directory is not searched by one thread alone.
+*
+* -g		Target is a glob (*, ?, [...]) that must match the whole name.
+* An unclosed [ is an error; \[ matches a [.
+*
+* -r		Target is a POSIX extended regex, that matches anywhere in the
+* name unless anchored with ^ or $. \d, \w and \s (and \D, \W, \S) are also
+* supported, but back references and \b, \< and \> are not. Names are
+* matched as bytes, so . matches one byte of a UTF-8 character.
+*
+* -e		Adds a target. May be given many times. If -e, -T or --where is
+* given, all other arguments are starting directories.
+*
+* -T		Adds the targets in a file, one per line. If the file is -, they
+* are read from stdin.
+*
+* --build-index	Walks the starting directories and writes the name, type and
+* parent of every entry to an index file, instead of searching for a target.
+*
+* --index	Answers the search from an index file, without walking the tree.
+* The starting directories are those the index was built from. If one of them,
+* or of up to 4096 directories below them that the index samples, has been
+* modified since, the index is reported as stale on stderr. In a larger tree,
+* a change in a directory outside the sample goes unnoticed.
+*
+* --watch	Builds an index like --build-index, then keeps running and
+* rewrites it as entries are created, deleted and renamed, until interrupted.
+*
+* --rescan	Seconds between rescans of directories that --watch could not
+* watch, when the inotify watch limit is reached. Default is 60.
+*
+* --max-results	Stops the search once n matches are found. The threads are
+* cancelled, and the rest of the tree is not read. --first is the same as
+* --max-results 1.
+*
+* --count	Prints only the number of matches.
+*
+* --exists	Prints nothing, and stops at the first match. Exits with 0 if
+* there was one, else 1.
+*
+* --print0	Ends each found path with a NUL instead of a newline, for
+* xargs -0.
+*
+* --json	Writes each found entry as a JSON object on its own line, with
+* its path, type, depth, size, mtime, inode, mode and, with more than one
+* target, the targets it matched. The metadata is taken from the stat the
+* search made of the entry, if any, so no entry is stat'ed twice. Bytes of a
+* path that are not UTF-8 are written as \u00XX. With --index, only the path,
+* type and targets are known.
+*
+* With --print0 or --json, only the found paths are written, without the
+* threads' number of directories read.
+*
+* --where	Only reports entries that also match a find-style expression,
+* such as --where "-name '*.log' -size +10M -o -mtime -7". Without a target,
+* every entry is tested. The tests are -name glob, -type d|f|l,
+* -size [+-]n[cwbkMG], -mtime [+-]n, -mmin [+-]n, -perm [-/]mode,
+* -user name and -group name, as in find, combined with ( ), !, -a (or
+* nothing) and -o. The expression is compiled once, names and types are
+* tested first, and an entry is only stat'ed if the rest of the expression
+* decides if it matches. Cannot be combined with --index, --build-index
+* or --watch.
+*
+* --min-depth	Only reports entries at least n levels below a starting
+* directory (which is at level 0).
+*
+* --max-depth	Does not search more than n levels below a starting directory.
+*
+* -x		Does not enter directories on another filesystem than their
+* starting directory (like find -xdev).
+*
+* -L		Follows symbolic links (also --follow). A link is reported as the
+* type of what it points to, and only as a link if that does not exist. Each
+* directory is read once, by its device and inode number, so that links back
+* up the tree do not make the search loop.
+*
+* --exclude	Does not enter a directory. May be given many times.
+*
+* --pseudo-fs	Also enters pseudo filesystems (proc, sysfs and the like,
+* as found in /proc/self/mountinfo), which are skipped by default.
+*
+* Directories that are not entered are still reported if they match.
+*
+* --fd-budget	Number of directory file descriptors mfind may keep open, so
+* that subdirectories can be opened relative to their parent. Default is half
+* of RLIMIT_NOFILE. If 0, every directory is opened by its full path.
+*
+* --dir-buffer	Size in bytes of each thread's buffer for reading directory
+* entries. May end with k or m. Default is 256k.
+*
+* --order	Order directories are searched in. With hybrid (the default),
+* each thread goes depth-first through its own directories, so that it
+* holds no more than depth times fan-out of them, and an idle thread takes
+* the shallowest directory of another. dfs also takes the deepest, and bfs
+* goes breadth-first, holding a whole level of the tree at once.
+* 
+* --max-queued	Most directories that may be queued. A thread that finds a
+* directory while the queue is full waits until another takes one, unless
+* all others are waiting too. Default is no limit.
+* 
+* --inode-order	Reads all entries of a directory before handling any, and
+* handles them in order of their inode numbers, so that they are stat'ed and
+* their subdirectories queued in the order of the inode table. Can be much
+* faster on a cold cache, on ext4 or a spinning disk.
+* 
+* --io-uring	Stat and open directory entries in batches through io_uring,
+* with up to depth (default 64) requests in flight per thread. If io_uring is
+* not available, entries are read synchronously.
+*
+* --stats	Writes statistics of the search as JSON to stderr, or to a file
+* if given as --stats=file: the wall and CPU time of each phase, and per
+* thread and in total the directories opened, entries read, stat calls,
+* errors, matches, times parked waiting for work, waits for a contended queue
+* lock, directories stolen from other threads, the largest queue length and the
+* times waited for room in a full queue, the slices of huge directories
+* searched, and the directories not read again as they had been already.
+* With -p auto, also each number of threads chosen, and when, with the
+* directories read per second and mean time per directory that led to it.
 *
 * start		Starting directory to begin search from. Must be one or more
-* starting directories.
+* starting directories. If one is inside another, its directories are only
+* read once, or with --min-depth or --max-depth, read again only if that finds
+* entries at depths not searched before.
 *
 * target	The name of the target file/directory/link that mfind will search
-* for. There must be exactly one target.
+* for, or its pattern if -g or -r is given. With more than one target, all
+* are searched for in one traversal, and each found path is followed by the
+* targets it matched, separated by tabs.
 *
 * Author: Buster Hultgren Wärn <dv17bhn@cs.umu.se>
 *
@@ -28,336 +165,2302 @@
 * one argument - semValue.
 */
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <errno.h>
-#include <unistd.h>
-#include <dirent.h>
-#include <string.h>
-#include <pthread.h>
-#include <semaphore.h>
-#include <sys/types.h>
-#include <sys/stat.h>
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <pthread.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/vfs.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "libmfind.h"
+#include "stats.h"
+#include "mfind.h"
+#include "queue.h"
+#include "dirReader.h"
+#include "ioRing.h"
+#include "matcher.h"
+#include "targetSet.h"
+#include "nameIndex.h"
+#include "pathFilter.h"
+#include "visitedSet.h"
+#include "predicate.h"
+#include "parseMfind.h"
+#include "saferMemHandler.h"
+
+
+/*
+* description: Copies a string, with memory allocated by smalloc().
+* param[in]: str - The string.
+* return: The copy.
+*/
+static char *searchCopyString (const char *str) {
+
+	size_t len = strlen(str);
+	char *copy = smalloc(len + 1);
+	memcpy(copy, str, len + 1);
+	return copy;
+}
+
+/*
+* description: Creates a search. The targets are compiled, and each thread's
+* buffers allocated, but no directory is read until mfindSearchRun().
+* param[in]: a - The arguments of the search. Must stay valid, and not be
+* changed, until the search is killed.
+* param[in]: callback - Called for each match, or NULL to only count them.
+* param[in]: data - Passed to the callback.
+* return: The search, or NULL if a target or the --where expression is
+* invalid, or the search could not be set up (a message is printed to stderr).
+*/
+mfindSearch *mfindSearchNew (args *a, mfindCallback callback, void *data) {
+
+	statsRun run;
+	statsRunStart(&run);
+	matcher *m = NULL;
+	targetSet *targets = NULL;
+	if (a -> nrTargets > 1) {
+
+		targets = targetSetNew(a -> targets, a -> nrTargets, a -> matchMode);
+		if (targets == NULL) {
+
+			return NULL;
+		}
+	} else if (a -> nrTargets > 0 && a -> matchMode != MATCH_LITERAL) {
+
+		m = matcherCompile(a -> targets[0], a -> matchMode);
+		if (m == NULL) {
+
+			return NULL;
+		}
+	}
+	predicate *where = NULL;
+	if (a -> where != NULL) {
+
+		where = predicateCompile(a -> where);
+		if (where == NULL) {
+
+			matcherKill(m);
+			targetSetKill(targets);
+			return NULL;
+		}
+	}
+
+	mfindSearch *s = smalloc(sizeof(*s));
+	trdArgs *trdArg = &s -> shared;
+	if (!initTuner(&trdArg -> tuner)) {
+
+		matcherKill(m);
+		targetSetKill(targets);
+		predicateKill(where);
+		sfree(s);
+		return NULL;
+	}
+	s -> a = a;
+	s -> run = run;
+	s -> ran = 0;
+	trdArg -> nrWorkers = a -> nrthr + 1;
+	trdArg -> s = schedulerNew(trdArg -> nrWorkers, a -> order);
+	trdArg -> target = NULL;
+	if (a -> nrTargets > 0) {
+
+		trdArg -> target = objectNew(searchCopyString(a -> targets[0]),
+									 a -> type);
+
+		/* A plain literal name is matched by its signature, not objectCmp()*/
+		char *suffix = objectGetSuffixIndex(trdArg -> target);
+		if (m == NULL && targets == NULL && suffix[0] != '\0' &&
+			strchr(suffix, '/') == NULL) {
+
+			m = matcherCompile(suffix, MATCH_LITERAL);
+		}
+	}
+	trdArg -> m = m;
+	trdArg -> targets = targets;
+	trdArg -> where = where;
+	trdArg -> whereMask = where != NULL ? predicateStatMask(where) : 0;
+	trdArg -> index = a -> buildIndex != NULL ? indexBuilderNew() : NULL;
+	trdArg -> fdBudget = a -> fdBudget >= 0 ? a -> fdBudget :
+						 getDefaultFdBudget();
+	atomic_init(&trdArg -> fdsOpen, 0);
+	trdArg -> matchMask = a -> output == OUTPUT_JSON ? STATX_TYPE | STATX_MODE |
+						  STATX_INO | STATX_SIZE | STATX_MTIME : 0;
+
+	/* Without a callback, there are no paths to report, only a count		*/
+	trdArg -> report = callback == NULL && a -> report == REPORT_PATHS ?
+					   REPORT_COUNT : a -> report;
+	trdArg -> maxResults = a -> report == REPORT_EXISTS ? 1 : a -> maxResults;
+	atomic_init(&trdArg -> nrResults, 0);
+	trdArg -> minDepth = a -> minDepth;
+	trdArg -> maxDepth = a -> maxDepth;
+	trdArg -> xdev = a -> xdev;
+	trdArg -> filter = initFilter(a);
+	trdArg -> roots = NULL;
+	trdArg -> realRoots = NULL;
+	trdArg -> nrRoots = 0;
+	trdArg -> callback = callback;
+	trdArg -> data = data;
+	atomic_init(&trdArg -> pending, 0);
+	atomic_init(&trdArg -> workSeq, 0);
+	atomic_init(&trdArg -> thrsIdle, 0);
+	atomic_init(&trdArg -> stopped, SEARCH_RUNNING);
+	trdArg -> autoThreads = a -> autoThreads;
+	atomic_init(&trdArg -> active, trdArg -> autoThreads &&
+				trdArg -> nrWorkers > AUTO_START_THREADS ?
+				AUTO_START_THREADS : trdArg -> nrWorkers);
+	atomic_init(&trdArg -> activeSeq, 0);
+	trdArg -> run = &s -> run;
+	trdArg -> inodeOrder = a -> inodeOrder;
+	trdArg -> followLinks = a -> followLinks;
+
+	trdArg -> visited = a -> followLinks || a -> nrStart > 1 ?
+						visitedSetNew() : NULL;
+	trdArg -> maxQueued = a -> maxQueued;
+	atomic_init(&trdArg -> roomSeq, 0);
+	atomic_init(&trdArg -> thrsBlocked, 0);
+
+	/* Aligned, as each worker's stats are on a cache line of their own	*/
+	s -> workers = scallocAligned(64, trdArg -> nrWorkers,
+								  sizeof(*s -> workers));
+	s -> trd = smalloc(sizeof(*s -> trd) * trdArg -> nrWorkers);
+	s -> reads = scalloc(trdArg -> nrWorkers, sizeof(*s -> reads));
+	for (int i = 0; i < trdArg -> nrWorkers; i++) {
+
+		worker *w = &s -> workers[i];
+		w -> id = i;
+		w -> shared = trdArg;
+		w -> reader = dirReaderNew(a -> dirBufSize);
+		w -> ring = NULL;
+		w -> batch = NULL;
+		w -> matched = NULL;
+		w -> copied = NULL;
+		w -> byInode = NULL;
+		w -> byInodeSize = 0;
+		w -> index = NULL;
+		memset(&w -> stats, 0, sizeof(w -> stats));
+		if (trdArg -> index != NULL) {
+
+			w -> index = indexWriterNew(trdArg -> index);
+		}
+		if (targets != NULL) {
+
+			w -> matched = smalloc(sizeof(int) * a -> nrTargets);
+		}
+	}
+	if (a -> ioDepth > 0) {
+
+		initRings(s -> workers, trdArg -> nrWorkers, a -> ioDepth);
+	}
+	return s;
+}
+
+/*
+* description: Runs a search, with the calling thread and a -> nrthr more,
+* and returns once all of them are done. If a -> autoThreads is set, only as
+* many of them search at once as are found to be faster (see -p auto). May
+* only be called once per search.
+* param[in]: s - The search.
+* return: Number of matches reported, or -1 if the search had already been
+* run, its threads could not all be created, or an index could not be written
+* (a message is printed to stderr).
+*/
+long mfindSearchRun (mfindSearch *s) {
+
+	if (s -> ran) {
+
+		fprintf(stderr, "mfindSearchRun: the search has already been run\n");
+		return -1;
+	}
+	s -> ran = 1;
+	args *a = s -> a;
+	trdArgs *trdArg = &s -> shared;
+	worker *workers = s -> workers;
+
+	s -> trd[0] = pthread_self();
+	initQueue(a, &workers[0]);
+	statsRunPhase(&s -> run, "setup");
+	if (trdArg -> autoThreads) {
+
+		trdArg -> tuner.lastAt = statsClock(CLOCK_MONOTONIC);
+		atomic_store(&trdArg -> tuner.nextSample,
+					 trdArg -> tuner.lastAt + AUTO_SAMPLE_NS);
+		statsRunLevel(&s -> run, atomic_load(&trdArg -> active), 0, 0);
+	}
+	int nrCreated = threadsCreate(a -> nrthr, &workers[1], &s -> trd[1]);
+	/* Those created stop, and are joined									*/
+	if (nrCreated < a -> nrthr) {
+
+		atomic_store(&trdArg -> stopped, SEARCH_FAILED);
+		trdWakeWorkers(trdArg, INT_MAX);
+	}
+	/* Running main thread													*/
+	void *reads = mfind(&workers[0]);
+	threadsJoin(nrCreated, &s -> trd[1], &s -> reads[1]);
+	s -> reads[0] = *(int *)reads;
+	sfree(reads);
+	statsRunPhase(&s -> run, "search");
+
+	object *o;
+	/* If stopped early														*/
+	while ((o = schedulerPop(trdArg -> s, 0)) != NULL) {
+
+		trdDropDir(trdArg, o);
+	}
+	long nrResults = atomic_load(&trdArg -> nrResults);
+	if (trdArg -> maxResults > 0 && nrResults > trdArg -> maxResults) {
+
+		/* Counted, but not reported										*/
+		nrResults = trdArg -> maxResults;
+	}
+	if (atomic_load(&trdArg -> stopped) == SEARCH_FAILED) {
+
+		nrResults = -1;
+	} else if (trdArg -> index != NULL) {
+
+		if (atomic_load(&trdArg -> stopped) == SEARCH_INTERRUPTED) {
+
+			fprintf(stderr, "Interrupted, index %s not written\n",
+					a -> buildIndex);
+		} else if (!indexBuilderWrite(trdArg -> index, a -> buildIndex)) {
+
+			nrResults = -1;
+		}
+	}
+	statsRunPhase(&s -> run, "finish");
+
+	if (a -> stats) {
+
+		trdStats stats[trdArg -> nrWorkers];
+		for (int i = 0; i < trdArg -> nrWorkers; i++) {
+
+			const schedulerStats *ss = schedulerGetStats(trdArg -> s, i);
+			stats[i] = workers[i].stats;
+			stats[i].lockWaits = ss -> lockWaits;
+			stats[i].lockWaitNs = ss -> lockWaitNs;
+			stats[i].steals = ss -> steals;
+			stats[i].maxQueue = ss -> maxSize;
+		}
+		statsWriteJson(a -> statsFile, &s -> run, stats, trdArg -> nrWorkers);
+	}
+	return nrResults;
+}
+
+/*
+* description: Stops a running search. Its threads stop reading directories,
+* and mfindSearchRun() returns the matches found so far. No index is written.
+* May be called from any thread, and from a signal handler.
+* param[in]: s - The search.
+*/
+void mfindSearchStop (mfindSearch *s) {
+
+	atomic_store(&s -> shared.stopped, SEARCH_INTERRUPTED);
+	trdWakeWorkers(&s -> shared, INT_MAX);
+}
+
+/*
+* description: Gets the number of threads of a search, including the one that
+* runs it.
+* param[in]: s - The search.
+* return: The number of threads.
+*/
+int mfindSearchNrThreads (mfindSearch *s) {
+
+	return s -> shared.nrWorkers;
+}
+
+/*
+* description: Gets the id of one of a search's threads, once it has run.
+* param[in]: s - The search.
+* param[in]: thread - The thread, from 0 to mfindSearchNrThreads() - 1.
+* return: Its id.
+*/
+pthread_t mfindSearchThreadId (mfindSearch *s, int thread) {
+
+	return s -> trd[thread];
+}
+
+/*
+* description: Gets the number of directories one of a search's threads read,
+* once it has run.
+* param[in]: s - The search.
+* param[in]: thread - The thread, from 0 to mfindSearchNrThreads() - 1.
+* return: The number of directories.
+*/
+int mfindSearchThreadReads (mfindSearch *s, int thread) {
+
+	return s -> reads[thread];
+}
+
+/*
+* description: Gets the name of a target of a search, as it was given.
+* param[in]: s - The search.
+* param[in]: id - The target's index, as in mfindMatch.matched.
+* return: The name.
+*/
+const char *mfindSearchTargetName (mfindSearch *s, int id) {
+
+	if (s -> shared.targets != NULL) {
+
+		return targetSetName(s -> shared.targets, id);
+	}
+	return s -> a -> targets[id];
+}
+
+/*
+* description: Frees all memory allocated by a search, including the search.
+* param[in]: s - The search.
+*/
+void mfindSearchKill (mfindSearch *s) {
+
+	if (s == NULL) {
+
+		return;
+	}
+	trdArgs *trdArg = &s -> shared;
+	for (int i = 0; i < trdArg -> nrWorkers; i++) {
+
+		dirReaderKill(s -> workers[i].reader);
+		ioRingKill(s -> workers[i].ring);
+		entryBatchKill(s -> workers[i].batch);
+		sfree(s -> workers[i].matched);
+		sfree(s -> workers[i].copied);
+		sfree(s -> workers[i].byInode);
+	}
+	for (int i = 0; i < trdArg -> nrRoots; i++) {
+
+		free(trdArg -> realRoots[i]);				/* From realpath()		*/
+	}
+	sfree(trdArg -> roots);
+	sfree(trdArg -> realRoots);
+	pathFilterKill(trdArg -> filter);
+	objectKill(trdArg -> target);
+	matcherKill(trdArg -> m);
+	targetSetKill(trdArg -> targets);
+	predicateKill(trdArg -> where);
+	indexBuilderKill(trdArg -> index);
+	visitedSetKill(trdArg -> visited);
+	schedulerKill(trdArg -> s);
+	pthread_mutex_destroy(&trdArg -> tuner.mtx);
+	sfree(s -> workers);
+	sfree(s -> trd);
+	sfree(s -> reads);
+	sfree(s);
+}
+
+/*
+* description: Initiates the state of -p auto, before any sample is taken.
+* param[in]: t - The tuner.
+* return: 1 on success, else 0 (a message is printed to stderr).
+*/
+int initTuner (trdTuner *t) {
+
+	int rc = pthread_mutex_init(&t -> mtx, NULL);
+	if (rc != 0) {
+
+		fprintf(stderr, "pthread_mutex_init: %s\n", strerror(rc));
+		return 0;
+	}
+	atomic_init(&t -> nextSample, 0);
+	atomic_init(&t -> dirsDone, 0);
+	atomic_init(&t -> latencyNs, 0);
+	t -> lastAt = 0;
+	t -> lastDirs = 0;
+	t -> lastLatencyNs = 0;
+	t -> best = 0;
+	t -> bestRate = 0;
+	t -> growing = 1;
+	t -> steady = 0;
+	t -> probeUp = 0;
+	return 1;
+}
+
+/*
+* description: Creates an io_uring and an entry batch for each thread. If
+* io_uring is not available, no thread gets one, and all threads will read
+* directories synchronously.
+* param[in]: workers - Array of all threads' arguments.
+* param[in]: nrWorkers - Number of threads.
+* param[in]: depth - Number of requests each ring can have in flight.
+*/
+void initRings (worker workers[], int nrWorkers, int depth) {
+
+	for (int i = 0; i < nrWorkers; i++) {
+
+		workers[i].ring = ioRingNew(depth);
+		if (workers[i].ring == NULL) {
+
+			perror("io_uring not available, reading synchronously");
+			for (int j = 0; j < i; j++) {
+
+				ioRingKill(workers[j].ring);
+				entryBatchKill(workers[j].batch);
+				workers[j].ring = NULL;
+				workers[j].batch = NULL;
+			}
+			return;
+		}
+		workers[i].batch = entryBatchNew(ioRingSpace(workers[i].ring));
+	}
+}
+
+/*
+* description: Creates and allocates memory for an empty entry batch.
+* param[in]: capacity - Maximum number of entries in the batch.
+* return: The batch.
+*/
+entryBatch *entryBatchNew (int capacity) {
+
+	entryBatch *b = smalloc(sizeof(*b));
+	b -> size = 0;
+	b -> capacity = capacity;
+	b -> entries = smalloc(sizeof(*b -> entries) * capacity);
+	b -> types = smalloc(sizeof(*b -> types) * capacity);
+	b -> stx = smalloc(sizeof(*b -> stx) * capacity);
+	b -> children = smalloc(sizeof(*b -> children) * capacity);
+	return b;
+}
+
+/*
+* description: Frees all memory allocated by an entry batch, including the
+* batch.
+* param[in]: b - The batch.
+*/
+void entryBatchKill (entryBatch *b) {
+
+	if (b != NULL) {
+
+		sfree(b -> entries);
+		sfree(b -> types);
+		sfree(b -> stx);
+		sfree(b -> children);
+		sfree(b);
+	}
+}
+
+/*
+* description: Gets the default number of directory file descriptors that may
+* be kept open - half of the soft RLIMIT_NOFILE.
+* return: The default fd budget.
+*/
+int getDefaultFdBudget (void) {
+
+	struct rlimit rl;
+	if (getrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur == RLIM_INFINITY) {
+
+		return 512;
+	}
+	return rl.rlim_cur / 2;
+}
+
+/*
+* description: Creates additional (non-main) threads. Threads are created to
+* run with mfind.
+* param[in]: nrthr - Number of threads to be created.
+* param[in]: workers - Array of nrthr thread argument structs (worker).
+* param[in]: trd - Array containing uninitiated threads.
+* return: Number of threads created. If fewer than nrthr, the creation of the
+* next one failed (a message is printed to stderr).
+*/
+int threadsCreate (int nrthr, worker workers[], pthread_t trd[]) {
+
+	for (int i = 0; i < nrthr; i++) {
+
+		int rc = pthread_create(&trd[i], NULL, mfind, &workers[i]);
+		if (rc != 0) {
+
+			fprintf(stderr, "pthread_create: %s\n", strerror(rc));
+			return i;
+		}
+	}
+	return nrthr;
+}
+
+/*
+* description: Joins additional (non-main) threads, and stores the results
+* from mfind (directories searched through).
+* param[in]: nrthr - Number of threads to be joined.
+* param[in]: trd - Array containing initiated threads.
+* param[out]: reads - Filled with the number of directories each thread read.
+*/
+void threadsJoin (int nrthr, pthread_t trd[], int reads[]) {
+
+	void *res = NULL;
+	for (int i = 0; i < nrthr; i++) {
+
+		pthread_join(trd[i], &res);
+		reads[i] = *(int *)res;
+		sfree(res);
+	}
+}
+
+/*
+* description: Initiates the main thread's deque with the starting directories
+* of the search. Will also see if starting directories compares equal to the
+* target. If so, they are reported as matches of the main thread. If
+* directories are tracked in trdArg -> visited, a start that is the same
+* directory as an earlier one is skipped.
+* param[in]: a - Struct containing arguments from parser.
+* param[in]: w - The main thread (worker 0).
+* return:
+*/
+void initQueue (args *a, worker *w) {
+
+	trdArgs *trdArg = w -> shared;
+	if (trdArg -> filter != NULL) {
+
+		trdArg -> roots = smalloc(sizeof(*trdArg -> roots) * a -> nrStart);
+		trdArg -> realRoots = smalloc(sizeof(*trdArg -> realRoots) *
+									  a -> nrStart);
+	}
+
+	struct stat *starts = NULL;
+	if (trdArg -> visited != NULL) {
+
+		starts = smalloc(sizeof(*starts) * a -> nrStart);
+		for (int i = 0; i < a -> nrStart; i++) {
+
+			if (stat(a -> start[i], &starts[i]) != 0) {
+
+				starts[i].st_ino = 0;
+			}
+		}
+	}
+
+	/* Pushed in reverse, so that the first start is popped first			*/
+	for (int i = a -> nrStart - 1; i >= 0; i--) {
+
+		int repeated = 0;
+		for (int j = 0; starts != NULL && j < i && !repeated; j++) {
+
+			repeated = starts[i].st_ino != 0 &&
+					   starts[i].st_ino == starts[j].st_ino &&
+					   starts[i].st_dev == starts[j].st_dev;
+		}
+		if (repeated) {
+
+			continue;
+		}
+		object *o = objectNew(searchCopyString(a -> start[i]), 'd');
+		if (trdArg -> index != NULL) {
+
+			o -> indexId = indexBuilderAddRoot(trdArg -> index, o -> name);
+		}
+		struct stat st;
+		struct statx stx;
+		if (trdArg -> xdev && stat(o -> name, &st) == 0) {
+
+			o -> dev = st.st_dev;
+		}
+		if (trdArg -> filter != NULL) {
+
+			trdArg -> roots[trdArg -> nrRoots] = o;
+			trdArg -> realRoots[trdArg -> nrRoots] = realpath(o -> name, NULL);
+			trdArg -> nrRoots++;
+		}
+
+		/* Path without a trailing slash, and its last component			*/
+		int nameLen = strlen(o -> name);
+		char buffer[nameLen + 1];
+		strcpy(buffer, o -> name);
+		if (buffer[nameLen - 1] == '/') {
+
+			buffer[nameLen - 1] = '\0';
+		}
+		char *base = strrchr(buffer, '/');
+		base = base != NULL ? base + 1 : buffer;
+
+		int nrMatched = 0;
+		if (trdArg -> target == NULL || trdArg -> minDepth > 0) {
+
+			/* Only building an index, or above the minimum depth			*/
+		} else if (trdArg -> targets != NULL) {
+
+			if (trdArg -> target -> type == '\0' ||
+				trdArg -> target -> type == 'd') {
+
+				nrMatched = targetSetMatch(trdArg -> targets, base,
+										   w -> matched);
+			}
+		} else if (a -> matchMode != MATCH_LITERAL ?
+				   trdObjectCmp(trdArg, base, 'd') :
+				   objectCmp(trdArg -> target, o)) {
+
+			nrMatched = 1;
+		}
+		const struct statx *startStx = NULL;
+		if (nrMatched > 0) {
+
+			startStx = trdStartStat(buffer, trdArg -> matchMask |
+									trdArg -> whereMask, &stx);
+		}
+		if (nrMatched > 0 && trdArg -> where != NULL &&
+			predicateEval(trdArg -> where, base, 'd', startStx) !=
+			PREDICATE_TRUE) {
+
+			nrMatched = 0;
+		}
+		if (nrMatched > 0) {
+
+			w -> stats.matches++;
+		}
+		if (nrMatched > 0 && trdCountMatch(trdArg) &&
+			trdArg -> report == REPORT_PATHS) {
+
+			trdReportMatch(w, buffer, 'd', 0, nrMatched,
+						   trdArg -> matchMask != 0 ? startStx : NULL);
+		}
+		if (trdArg -> maxDepth != 0) {
+
+			atomic_fetch_add(&trdArg -> pending, 1);
+			schedulerPush(trdArg -> s, 0, (void *)o);
+		} else {
+
+			objectKill(o);
+		}
+	}
+	sfree(starts);
+}
+
+/*
+* description: Stats a starting directory that matched, if its metadata is
+* reported (trdArg -> matchMask) or tested (trdArg -> whereMask). Links are
+* followed, as they are when it is opened.
+* param[in]: path - Path of the directory.
+* param[in]: mask - The statx fields needed.
+* param[out]: stx - Filled with its metadata.
+* return: stx, or NULL if no metadata is needed, or it could not be stat'ed.
+*/
+const struct statx *trdStartStat (const char *path, unsigned int mask,
+								  struct statx *stx) {
+
+	if (mask == 0) {
+
+		return NULL;
+	}
+	if (statx(AT_FDCWD, path, AT_NO_AUTOMOUNT, mask, stx) < 0) {
+
+		perror(path);
+		return NULL;
+	}
+	return stx;
+}
+
+/*
+* description: Creates the filter of directories not to search - the mount
+* points of pseudo filesystems, unless --pseudo-fs is given, and all
+* directories given with --exclude.
+* param[in]: a - args struct filled with parsed arguments.
+* return: The filter, or NULL if it is empty.
+*/
+pathFilter *initFilter (args *a) {
+
+	pathFilter *f = pathFilterNew();
+	if (!a -> pseudoFs) {
+
+		pathFilterAddPseudoMounts(f);
+	}
+	for (int i = 0; i < a -> nrExcludes; i++) {
+
+		pathFilterAdd(f, a -> excludes[i]);
+	}
+	if (pathFilterSize(f) == 0) {
+
+		pathFilterKill(f);
+		return NULL;
+	}
+	return f;
+}
+
+/*
+* description: Runs a thread through trdSearchDir() IF there is an element in
+* its own deque, or one it can steal from another thread. IF there is not BUT
+* other threads are running trdSearchDir(), thread will park until work is
+* pushed. Else it will quit.
+* param[in]: arg - void pointer to Thread argument struct (worker).
+* return: Allocated memory storing an integer keeping track of how many
+* directories the thread have (succesfully) opened. Should be free'd.
+*/
+void *mfind (void *arg) {
+
+	int *reads = malloc(sizeof(*reads));
+	*reads = 0;
+	worker *w = (worker *)arg;
+	object *o = NULL;
+	int runLoop = 1;
+
+	while (runLoop && !trdIsStopped(w -> shared)) {
+
+		if (w -> id >= atomic_load_explicit(&w -> shared -> active,
+											memory_order_relaxed)) {
+
+			runLoop = trdWaitForTurn(w);		/* Not active with -p auto	*/
+			continue;
+		}
+		o = schedulerPop(w -> shared -> s, w -> id);
+		if (o != NULL) {
+
+			trdWakeBlocked(w -> shared);
+			if (w -> shared -> autoThreads) {
+
+				*reads += trdSearchDirTuned(w, o);
+			} else {
+
+				*reads += trdSearchDir(w, o);
+			}
+			trdFinishDir(w -> shared);
+			o = NULL;
+		} else {
+
+			runLoop = trdWaitForWork(w);
+		}
+	}
+	w -> stats.cpuNs = statsClock(CLOCK_THREAD_CPUTIME_ID);
+	arenaThreadExit();
+
+	return (void *)reads;
+}
+
+/*
+* description: Called by a thread that found no work in any deque. Parks the
+* thread on the futex workSeq until work is pushed, or the search is done or
+* stopped. A woken thread only checks the deques once, and parks again if
+* another thread took the work first.
+* param[in]: w - The thread.
+* return: If there might be work to do; 1, else (search is done) 0.
+*/
+int trdWaitForWork (worker *w) {
+
+	trdArgs *trdArg = w -> shared;
+	int runLoop = -1;
+
+	/* Pairs with the fence in trdPushDir(), so that either the push is seen
+	below, or the pusher sees this thread as idle and bumps workSeq			*/
+	atomic_fetch_add(&trdArg -> thrsIdle, 1);
+	while (runLoop < 0) {
+
+		unsigned int seq = atomic_load(&trdArg -> workSeq);
+		if (trdIsStopped(trdArg) || atomic_load(&trdArg -> pending) == 0) {
+
+			runLoop = 0;
+		} else if (!schedulerIsEmpty(trdArg -> s)) {
+
+			runLoop = 1;
+		} else {
+
+			/* Returns at once if workSeq was bumped since it was read		*/
+			int64_t parked = statsClock(CLOCK_MONOTONIC);
+			syscall(SYS_futex, &trdArg -> workSeq, FUTEX_WAIT_PRIVATE, seq,
+					NULL, NULL, 0);
+			w -> stats.parks++;
+			w -> stats.parkNs += statsClock(CLOCK_MONOTONIC) - parked;
+		}
+	}
+	atomic_fetch_sub(&trdArg -> thrsIdle, 1);
+	return runLoop;
+}
+
+/*
+* description: Wakes threads parked in trdWaitForWork(), by bumping workSeq.
+* Waking all also wakes the threads parked in trdWaitForTurn() and
+* trdWaitForRoom(), as it is done when the search ends, is stopped, or the
+* number of active threads changes. Safe to call from a signal handler.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: nrThreads - Most threads to wake, or INT_MAX for all.
+*/
+void trdWakeWorkers (trdArgs *trdArg, int nrThreads) {
+
+	atomic_fetch_add(&trdArg -> workSeq, 1);
+	syscall(SYS_futex, &trdArg -> workSeq, FUTEX_WAKE_PRIVATE, nrThreads,
+			NULL, NULL, 0);
+	if (nrThreads == INT_MAX && trdArg -> autoThreads) {
+
+		atomic_fetch_add(&trdArg -> activeSeq, 1);
+		syscall(SYS_futex, &trdArg -> activeSeq, FUTEX_WAKE_PRIVATE, INT_MAX,
+				NULL, NULL, 0);
+	}
+	if (nrThreads == INT_MAX && trdArg -> maxQueued > 0) {
+
+		atomic_fetch_add(&trdArg -> roomSeq, 1);
+		syscall(SYS_futex, &trdArg -> roomSeq, FUTEX_WAKE_PRIVATE, INT_MAX,
+				NULL, NULL, 0);
+	}
+}
+
+/*
+* description: Called by a thread that is not among the active threads of
+* -p auto. Parks it on the futex activeSeq until it is made active, or the
+* search is done or stopped.
+* param[in]: w - The thread.
+* return: If it is active; 1, else (search is done) 0.
+*/
+int trdWaitForTurn (worker *w) {
+
+	trdArgs *trdArg = w -> shared;
+
+	/* A wake meant for an active thread may have gone to this one, if it
+	was parked in trdWaitForWork() when it was made inactive. It is passed on
+	while there is work, so that no pushed directory is left unattended		*/
+	if (!schedulerIsEmpty(trdArg -> s)) {
+
+		trdWakeWorkers(trdArg, 1);
+	}
+	for (;;) {
+
+		unsigned int seq = atomic_load(&trdArg -> activeSeq);
+		if (trdIsStopped(trdArg) || atomic_load(&trdArg -> pending) == 0) {
+
+			return 0;
+		} else if (w -> id < atomic_load(&trdArg -> active)) {
+
+			return 1;
+		}
+		int64_t parked = statsClock(CLOCK_MONOTONIC);
+		syscall(SYS_futex, &trdArg -> activeSeq, FUTEX_WAIT_PRIVATE, seq,
+				NULL, NULL, 0);
+		w -> stats.parks++;
+		w -> stats.parkNs += statsClock(CLOCK_MONOTONIC) - parked;
+	}
+}
+
+/*
+* description: Searches a directory with -p auto. Its read is timed and
+* counted for the tuner, and once a sample is due, the thread that gets the
+* tuner's lock picks the number of active threads.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory to be searched.
+* return: If directory is succesfully opened; 1, else 0.
+*/
+int trdSearchDirTuned (worker *w, object *o) {
+
+	trdTuner *t = &w -> shared -> tuner;
+	int64_t start = statsClock(CLOCK_MONOTONIC);
+	int read = trdSearchDir(w, o);
+	int64_t now = statsClock(CLOCK_MONOTONIC);
+	atomic_fetch_add_explicit(&t -> dirsDone, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&t -> latencyNs, now - start,
+							  memory_order_relaxed);
+	if (now >= atomic_load_explicit(&t -> nextSample, memory_order_relaxed) &&
+		pthread_mutex_trylock(&t -> mtx) == 0) {
+
+		if (now >= atomic_load(&t -> nextSample)) {
+
+			trdTune(w -> shared, now);
+		}
+		pthread_mutex_unlock(&t -> mtx);
+	}
+	return read;
+}
+
+/*
+* description: Measures the throughput since the last sample, and picks the
+* number of active threads (see AUTO_GAIN in mfind.h). A level is only grown
+* while there are at least as many directories queued as active threads, as
+* more threads would have nothing to do. Must hold the tuner's lock.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: now - The time, from statsClock(CLOCK_MONOTONIC).
+*/
+void trdTune (trdArgs *trdArg, int64_t now) {
+
+	trdTuner *t = &trdArg -> tuner;
+	atomic_store(&t -> nextSample, now + AUTO_SAMPLE_NS);
+	long dirsDone = atomic_load(&t -> dirsDone);
+	long latencyNs = atomic_load(&t -> latencyNs);
+	long dirs = dirsDone - t -> lastDirs;
+	if (dirs < AUTO_MIN_DIRS) {
+
+		return;									/* Sample until there are	*/
+	}
+	double rate = dirs * 1e9 / (now - t -> lastAt);
+	double latency = (double)(latencyNs - t -> lastLatencyNs) / dirs;
+	t -> lastAt = now;
+	t -> lastDirs = dirsDone;
+	t -> lastLatencyNs = latencyNs;
+
+	int cur = atomic_load(&trdArg -> active);
+	int next = cur;
+	int canGrow = cur < trdArg -> nrWorkers &&
+				  schedulerGetSize(trdArg -> s) >= cur;
+	if (t -> growing) {
+
+		if (rate > t -> bestRate * AUTO_GAIN) {
+
+			t -> best = cur;
+			t -> bestRate = rate;
+			next = canGrow ? cur * 2 : cur;
+			t -> growing = canGrow;
+		} else {
+
+			t -> growing = 0;
+			next = t -> best;
+		}
+	} else if (cur != t -> best) {
+
+		/* The result of a probe											*/
+		if (rate > t -> bestRate * AUTO_GAIN ||
+			(cur < t -> best && rate >= t -> bestRate * AUTO_KEEP)) {
+
+			t -> best = cur;
+			t -> bestRate = rate;
+		}
+		next = t -> best;
+	} else {
+
+		/* The tree changes as it is searched, and so does its throughput	*/
+		t -> bestRate = rate;
+		if (++t -> steady >= AUTO_PROBE_EVERY) {
+
+			t -> steady = 0;
+			t -> probeUp = !t -> probeUp;
+			if (t -> probeUp && canGrow) {
+
+				next = cur + (cur + 1) / 2;
+			} else if (!t -> probeUp && cur > 1) {
+
+				next = cur * 2 / 3;
+			}
+		}
+	}
+	if (next > trdArg -> nrWorkers) {
+
+		next = trdArg -> nrWorkers;
+	}
+	if (next != cur) {
+
+		atomic_store(&trdArg -> active, next);
+		statsRunLevel(trdArg -> run, next, rate, latency);
+		trdWakeWorkers(trdArg, INT_MAX);
+	}
+}
+
+/*
+* description: Pushes a directory to a thread's own deque, counting it as
+* pending, once there is room for it (see trdWaitForRoom()). Only wakes a
+* parked thread if there is one.
+* param[in]: w - The pushing thread.
+* param[in]: o - The directory.
+*/
+void trdPushDir (worker *w, object *o) {
+
+	trdWaitForRoom(w);
+
+	/* Counted before it can be popped, so pending never drops to 0 early	*/
+	atomic_fetch_add(&w -> shared -> pending, 1);
+	schedulerPush(w -> shared -> s, w -> id, (void *)o);
+
+	/* Pairs with the thrsIdle increment before the emptiness check in
+	trdWaitForWork(), so that either the push or the parked thread is seen	*/
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load(&w -> shared -> thrsIdle) > 0) {
+
+		trdWakeWorkers(w -> shared, 1);
+	}
+}
+
+/*
+* description: Called by a thread about to push a directory. If --max-queued
+* directories are queued, parks the thread on the futex roomSeq until a pop
+* makes room, or the search is stopped. So that the search never stalls, a
+* thread does not wait if all other active threads are waiting already.
+* param[in]: w - The thread.
+*/
+void trdWaitForRoom (worker *w) {
+
+	trdArgs *trdArg = w -> shared;
+	if (trdArg -> maxQueued == 0 ||
+		schedulerGetSize(trdArg -> s) < trdArg -> maxQueued) {
+
+		return;
+	}
+
+	/* Pairs with the fence in trdWakeBlocked(), so that either the room is
+	seen below, or the popper sees this thread as blocked and wakes it		*/
+	atomic_fetch_add(&trdArg -> thrsBlocked, 1);
+	for (;;) {
+
+		unsigned int seq = atomic_load(&trdArg -> roomSeq);
+		if (trdIsStopped(trdArg) ||
+			schedulerGetSize(trdArg -> s) < trdArg -> maxQueued ||
+			atomic_load(&trdArg -> thrsBlocked) >=
+			atomic_load(&trdArg -> active)) {
+
+			break;
+		}
+		int64_t blocked = statsClock(CLOCK_MONOTONIC);
+		syscall(SYS_futex, &trdArg -> roomSeq, FUTEX_WAIT_PRIVATE, seq,
+				NULL, NULL, 0);
+		w -> stats.fullWaits++;
+		w -> stats.fullWaitNs += statsClock(CLOCK_MONOTONIC) - blocked;
+	}
+	atomic_fetch_sub(&trdArg -> thrsBlocked, 1);
+}
+
+/*
+* description: Called after a directory was popped. Wakes a thread parked in
+* trdWaitForRoom(), if there is one and there is now room for its push.
+* param[in]: trdArg - Shared thread arguments.
+*/
+void trdWakeBlocked (trdArgs *trdArg) {
+
+	if (trdArg -> maxQueued == 0) {
+
+		return;
+	}
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load(&trdArg -> thrsBlocked) > 0 &&
+		schedulerGetSize(trdArg -> s) < trdArg -> maxQueued) {
+
+		atomic_fetch_add(&trdArg -> roomSeq, 1);
+		syscall(SYS_futex, &trdArg -> roomSeq, FUTEX_WAKE_PRIVATE, 1, NULL,
+				NULL, 0);
+	}
+}
+
+/*
+* description: Counts a directory as searched. The last one wakes all parked
+* threads, since the search is then done.
+* param[in]: trdArg - Shared thread arguments.
+*/
+void trdFinishDir (trdArgs *trdArg) {
+
+	if (atomic_fetch_sub(&trdArg -> pending, 1) == 1) {
+
+		trdWakeWorkers(trdArg, INT_MAX);
+	}
+}
+
+/*
+* description: With one thread, searches through an entire directory. Each
+* entry in the directory will be compared to the target - if they equal, the
+* etnry's path will be printed. If the entry is a directory, it will be pushed
+* to the thread's own deque. A slice is handed to trdSearchSlice().
+* param[in]: w - The searching thread.
+* param[in]: o - The directory to be searched.
+* return: If directory is succesfully opened; 1, else 0.
+*/
+int trdSearchDir (worker *w, object *o) {
+
+	if (o -> type == 's') {
+
+		return trdSearchSlice(w, o);
+	}
+	trdArgs *trdArg = w -> shared;
+	int succesfullRead = 0;
+	int fd = trdOpenDir(trdArg, o);
+	if (fd < 0) {
+
+		char *path = objectGetPath(o, NULL);
+		perror(path);
+		w -> stats.errors++;
+	} else if (trdArg -> visited != NULL && !trdFirstVisit(w, o, fd)) {
+
+		close(fd);
+	} else {
+
+		w -> stats.dirsOpened++;
+		int shared = trdShareDirFd(trdArg, o, fd);
+		dirReaderOpen(w -> reader, fd);
+		if (trdArg -> inodeOrder) {
+
+			trdReadDirSorted(w, o, fd);
+		} else if (w -> ring != NULL) {
+
+			trdReadDirRing(w, o, fd);
+		} else {
+
+			trdReadDir(w, o, fd);
+		}
+		succesfullRead = 1;
+		if (dirReaderError(w -> reader) != 0) {
+
+			char *path = objectGetPath(o, NULL);
+			errno = dirReaderError(w -> reader);
+			perror(path);
+			w -> stats.errors++;
+			succesfullRead = 0;
+		}
+		if (!shared) {
+
+			close(fd);
+		}
+	}
+	trdReleaseDirFd(trdArg, o);
+
+	objectKill(o);
+	return succesfullRead;
+}
+
+/*
+* description: Called once a directory is opened, when directories are
+* tracked in trdArg -> visited. Adds the directory to the set, by the device
+* and inode number of its fd, and its depth. If it was reached before, it is
+* only read again if that reports entries the earlier reads did not (see
+* trdReadAgain()), and then o -> reported is set if its own entries were
+* reported already.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory.
+* param[in]: fd - Open fd of the directory.
+* return: If it should be read; 1, else 0.
+*/
+int trdFirstVisit (worker *w, object *o, int fd) {
+
+	struct stat st;
+	w -> stats.statCalls++;
+	if (fstat(fd, &st) != 0) {
+
+		char *path = objectGetPath(o, NULL);
+		perror(path);
+		w -> stats.errors++;
+		return 0;
+	}
+	uint64_t depths = visitedSetAdd(w -> shared -> visited, st.st_dev,
+									st.st_ino, o -> depth);
+	if (depths != 0 && !trdReadAgain(w -> shared, depths, o -> depth)) {
+
+		w -> stats.revisits++;
+		return 0;
+	}
+	o -> reported = trdDepthMask(w -> shared, depths, 1) != 0;
+	return 1;
+}
+
+/*
+* description: Gets the depths, of those a directory was reached at, from
+* which entries a number of levels below it were reported, as they were
+* within --min-depth and --max-depth. The depths are kept as by
+* visitedSetAdd().
+* param[in]: trdArg - The shared arguments.
+* param[in]: depths - The depths the directory was reached at, bit d set for
+* depth d.
+* param[in]: levels - Number of levels below the directory.
+* return: The depths of depths from which the entries were reported.
+*/
+uint64_t trdDepthMask (trdArgs *trdArg, uint64_t depths, int levels) {
+
+	int lo = trdArg -> minDepth - levels;
+	int hi = VISITEDSET_MAX_DEPTH;
+	if (trdArg -> maxDepth >= 0 &&
+		trdArg -> maxDepth - levels < VISITEDSET_MAX_DEPTH) {
+
+		hi = trdArg -> maxDepth - levels;
+	}
+	lo = lo < 0 ? 0 : lo > VISITEDSET_MAX_DEPTH ? VISITEDSET_MAX_DEPTH : lo;
+	if (hi < lo) {
+
+		return 0;
+	}
+	return depths & (~0ull >> (VISITEDSET_MAX_DEPTH - (hi - lo)) << lo);
+}
+
+/*
+* description: Tells if a directory reached again, at another depth, must be
+* read again - if that reports entries at some level below it, that none of
+* the reads from the depths it was reached at before reported. Without
+* --min-depth or --max-depth, it never must.
+* param[in]: trdArg - The shared arguments.
+* param[in]: depths - The depths it was reached at before, bit d set for
+* depth d.
+* param[in]: depth - The depth it is reached at now.
+* return: If it must be read again; 1, else 0.
+*/
+int trdReadAgain (trdArgs *trdArg, uint64_t depths, int depth) {
+
+	/* Levels first reported, and last searched, from this depth			*/
+	int first = trdArg -> minDepth - depth > 1 ? trdArg -> minDepth - depth : 1;
+	int last = trdArg -> maxDepth < 0 ? INT_MAX : trdArg -> maxDepth - depth;
+
+	/* As the depths are kept up to VISITEDSET_MAX_DEPTH, the levels that
+	far above --max-depth all report from the same depths as the first		*/
+	if (first <= last && trdDepthMask(trdArg, depths, first) == 0) {
+
+		return 1;
+	}
+	int from = trdArg -> maxDepth - VISITEDSET_MAX_DEPTH;
+	for (int level = from > first ? from : first + 1;
+		 trdArg -> maxDepth >= 0 && level <= last; level++) {
+
+		if (trdDepthMask(trdArg, depths, level) == 0) {
+
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+* description: Reads all entries of an opened directory, one at a time. Each
+* entry is handled by trdHandleEntry(), and found directories are pushed.
+* param[in]: w - The searching thread. Its reader must be opened on fd.
+* param[in]: o - The directory.
+* param[in]: fd - Open fd of the directory.
+*/
+void trdReadDir (worker *w, object *o, int fd) {
+
+	dirEntry *entry;
+	struct statx stx;
+	object *slice = NULL;
+	int nrEntries = 0;
+	while (!trdIsStopped(w -> shared) &&
+		   (entry = dirReaderNext(w -> reader)) != NULL) {
+
+		if (entry -> d_name[0] != '.' &&
+			!trdSplitEntry(w, o, &slice, ++nrEntries, entry)) {
+
+			char type = trdGetEntryType(w, o, fd, entry, &stx);
+			object *child = trdHandleEntry(w, o, fd, entry -> d_name, type,
+										   &stx);
+			if (child != NULL) {
+
+				trdPushDir(w, child);
+			}
+		}
+	}
+	if (slice != NULL) {
+
+		trdPushDir(w, slice);
+	}
+}
+
+/*
+* description: Reads all entries of an opened directory in batches. Entries
+* are collected until the batch is full, or until the reader's buffer must be
+* refilled, and then handed to trdFlushBatch().
+* param[in]: w - The searching thread. Its reader must be opened on fd.
+* param[in]: o - The directory.
+* param[in]: fd - Open fd of the directory.
+*/
+void trdReadDirRing (worker *w, object *o, int fd) {
+
+	entryBatch *b = w -> batch;
+	dirEntry *entry;
+	object *slice = NULL;
+	int nrEntries = 0;
+	while (!trdIsStopped(w -> shared) &&
+		   (entry = dirReaderNext(w -> reader)) != NULL) {
+
+		if (entry -> d_name[0] != '.' &&
+			!trdSplitEntry(w, o, &slice, ++nrEntries, entry)) {
+
+			b -> entries[b -> size] = entry;
+			b -> types[b -> size] = trdDirentToType(w -> shared, entry);
+			b -> stx[b -> size].stx_mask = 0;
+			b -> children[b -> size] = NULL;
+			b -> size++;
+		}
+		if (b -> size == b -> capacity || dirReaderIsDrained(w -> reader)) {
+
+			trdFlushBatch(w, o, fd);
+		}
+	}
+	trdFlushBatch(w, o, fd);
+	if (slice != NULL) {
+
+		trdPushDir(w, slice);
+	}
+}
+
+/*
+* description: Compare function for qsort of entries by inode number.
+* param[in]: a - First entry.
+* param[in]: b - Second entry.
+* return: Negative, 0 or positive as a is before, equal to or after b.
+*/
+static int cmpInode (const void *a, const void *b) {
+
+	unsigned long long inoA = (*(dirEntry * const *)a) -> d_ino;
+	unsigned long long inoB = (*(dirEntry * const *)b) -> d_ino;
+	return (inoA > inoB) - (inoA < inoB);
+}
+
+/*
+* description: Reads all entries of an opened directory before handling any,
+* copying them out of the reader's buffer. They are then sorted by inode
+* number, so that entries are stat'ed, and subdirectories pushed, in the
+* order of the inode table, and handled like in trdReadDir() or
+* trdReadDirRing(). Entries beyond SLICE_THRESHOLD are split off in that
+* order.
+* param[in]: w - The searching thread. Its reader must be opened on fd.
+* param[in]: o - The directory.
+* param[in]: fd - Open fd of the directory.
+*/
+void trdReadDirSorted (worker *w, object *o, int fd) {
+
+	if (w -> copied == NULL) {
+
+		w -> copied = smalloc(sizeof(*w -> copied) + SLICE_BYTES);
+		w -> copied -> capacity = SLICE_BYTES;
+	}
+	entrySlice *c = w -> copied;
+	c -> size = 0;
+	int nrEntries = 0;
+	dirEntry *entry;
+	while (!trdIsStopped(w -> shared) &&
+		   (entry = dirReaderNext(w -> reader)) != NULL) {
+
+		if (entry -> d_name[0] != '.') {
+
+			if (c -> size + entry -> d_reclen > c -> capacity) {
+
+				c = srealloc(c, sizeof(*c) + c -> capacity * 2);
+				c -> capacity *= 2;
+				w -> copied = c;
+			}
+			memcpy(c -> entries + c -> size, entry, entry -> d_reclen);
+			c -> size += entry -> d_reclen;
+			nrEntries++;
+		}
+	}
+	if (nrEntries > w -> byInodeSize) {
+
+		sfree(w -> byInode);
+		w -> byInode = smalloc(sizeof(*w -> byInode) * nrEntries);
+		w -> byInodeSize = nrEntries;
+	}
+	size_t pos = 0;
+	for (int i = 0; i < nrEntries; i++) {
+
+		w -> byInode[i] = (dirEntry *)(c -> entries + pos);
+		pos += w -> byInode[i] -> d_reclen;
+	}
+	qsort(w -> byInode, nrEntries, sizeof(*w -> byInode), cmpInode);
+
+	object *slice = NULL;
+	for (int i = 0; i < nrEntries && !trdIsStopped(w -> shared); i++) {
+
+		if (!trdSplitEntry(w, o, &slice, i + 1, w -> byInode[i])) {
+
+			trdHandleCopiedEntry(w, o, fd, w -> byInode[i]);
+		}
+	}
+	if (w -> ring != NULL) {
+
+		trdFlushBatch(w, o, fd);
+	}
+	if (slice != NULL) {
+
+		trdPushDir(w, slice);
+	}
+}
+
+/*
+* description: Handles an entry that stays valid while it is handled, unlike
+* one in the reader's buffer. With io_uring, it is added to the thread's
+* batch, which is flushed when full; the caller must flush the rest.
+* Otherwise it is handled at once, and pushed if it is a directory.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory the entry is in.
+* param[in]: fd - Open fd of the directory.
+* param[in]: entry - The entry.
+*/
+void trdHandleCopiedEntry (worker *w, object *o, int fd, dirEntry *entry) {
+
+	if (w -> ring != NULL) {
+
+		entryBatch *b = w -> batch;
+		b -> entries[b -> size] = entry;
+		b -> types[b -> size] = trdDirentToType(w -> shared, entry);
+		b -> stx[b -> size].stx_mask = 0;
+		b -> children[b -> size] = NULL;
+		b -> size++;
+		if (b -> size == b -> capacity) {
+
+			trdFlushBatch(w, o, fd);
+		}
+	} else {
+
+		struct statx stx;
+		char type = trdGetEntryType(w, o, fd, entry, &stx);
+		object *child = trdHandleEntry(w, o, fd, entry -> d_name, type, &stx);
+		if (child != NULL) {
+
+			trdPushDir(w, child);
+		}
+	}
+}
+
+/*
+* description: Searches a slice of a directory's entries, split off by
+* trdSplitEntry(), like trdReadDir() or trdReadDirRing() would have. Releases
+* the slice's hold on the directory's fd.
+* param[in]: w - The searching thread.
+* param[in]: o - The slice.
+* return: 0, as no directory is opened.
+*/
+int trdSearchSlice (worker *w, object *o) {
+
+	object *dir = o -> parent;
+	entrySlice *slice = o -> slice;
+	w -> stats.slices++;
+	for (size_t pos = 0; pos < slice -> size && !trdIsStopped(w -> shared);) {
+
+		dirEntry *entry = (dirEntry *)(slice -> entries + pos);
+		pos += entry -> d_reclen;
+		trdHandleCopiedEntry(w, dir, dir -> fd, entry);
+	}
+	if (w -> ring != NULL) {
+
+		trdFlushBatch(w, dir, dir -> fd);
+	}
+	trdReleaseDirFd(w -> shared, dir);
+	objectKill(o);
+	return 0;
+}
+
+/*
+* description: Called for each entry read from a directory. Once more than
+* SLICE_THRESHOLD have been read, entries are copied into slices instead of
+* being handled, and each full slice is pushed for any thread to search. Only
+* done if there is more than one thread, and the directory's fd is shared,
+* so that the slices can stat and open its entries.
+* param[in]: w - The reading thread.
+* param[in]: o - The directory.
+* param[in/out]: slice - The slice being filled, or NULL if there is none.
+* param[in]: nrEntries - Number of entries read so far, including this one.
+* param[in]: entry - The entry.
+* return: If the entry was put in a slice; 1, else 0 (it should be handled).
+*/
+int trdSplitEntry (worker *w, object *o, object **slice, int nrEntries,
+				   dirEntry *entry) {
+
+	if (nrEntries <= SLICE_THRESHOLD || o -> fd < 0 ||
+		w -> shared -> nrWorkers == 1) {
+
+		return 0;
+	}
+	if (*slice != NULL &&
+		(*slice) -> slice -> size + entry -> d_reclen >
+		(*slice) -> slice -> capacity) {
+
+		trdPushDir(w, *slice);
+		*slice = NULL;
+	}
+	if (*slice == NULL) {
+
+		*slice = objectNewSlice(o);
+	}
+	entrySlice *s = (*slice) -> slice;
+	memcpy(s -> entries + s -> size, entry, entry -> d_reclen);
+	s -> size += entry -> d_reclen;
+	return 1;
+}
+
+/*
+* description: Handles a batch of entries through the thread's io_uring. First
+* all entries whose type is unknown are stat'ed, then every entry is handled by
+* trdHandleEntry(). Found directories are opened ahead of time, if the fd
+* budget allows it, and then pushed. Requests that io_uring fails to run are
+* retried synchronously, and the fd budget taken by an openat that did not
+* complete is given back. The batch is emptied.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory.
+* param[in]: fd - Open fd of the directory.
+*/
+void trdFlushBatch (worker *w, object *o, int fd) {
+
+	trdArgs *trdArg = w -> shared;
+	entryBatch *b = w -> batch;
+	unsigned long long i;
+	int res;
 
-#include "mfind.h"
-#include "queue.h"
-#include "parseMfind.h"
-#include "saferMemHandler.h"
+	for (i = 0; i < (unsigned long long)b -> size && w -> ring != NULL; i++) {
 
+		if (b -> types[i] == '\0') {
+
+			w -> stats.statCalls++;
+			ioRingPrepStatx(w -> ring, fd, b -> entries[i] -> d_name,
+							trdGetStatxFlags(trdArg, o),
+							trdGetStatxMask(trdArg), &b -> stx[i], i);
+		}
+	}
+	int submitted = trdSubmitRing(w);
+	while (w -> ring != NULL && ioRingReap(w -> ring, &i, &res)) {
 
-int main (int argc, char *argv[]) {
+		if (res >= 0) {
 
-	args a;
-	argsInit(&a);
-	parseArgs(&a, argc, argv);
-	if (a.nrStart > 0) {
+			b -> types[i] = trdModeToType(b -> stx[i].stx_mode);
+		} else if (res != -EINVAL && res != -EOPNOTSUPP &&
+				   !(trdArg -> followLinks &&
+					 (res == -ENOENT || res == -ELOOP))) {
 
-		runThreads(&a);
+			char *path = objectGetPath(o, b -> entries[i] -> d_name);
+			errno = -res;
+			perror(path);
+			w -> stats.errors++;
+			b -> types[i] = 'x';				/* Failed, skip the entry	*/
+		}
 	}
-	argsKill(&a);
-	return 0;
+	if (!submitted) {
+
+		trdDropRing(w);
+	}
+
+	int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC |
+				(trdArg -> followLinks ? 0 : O_NOFOLLOW);
+	for (i = 0; i < (unsigned long long)b -> size; i++) {
+
+		char type = b -> types[i];
+		if (type == '\0') {					/* Not run by io_uring		*/
+
+			type = trdGetEntryType(w, o, fd, b -> entries[i],
+								   &b -> stx[i]);
+		} else if (type == 'x') {
+
+			type = '\0';
+		}
+		b -> children[i] = trdHandleEntry(w, o, fd, b -> entries[i] -> d_name,
+										  type, &b -> stx[i]);
+		if (b -> children[i] != NULL && w -> ring != NULL &&
+			atomic_fetch_add(&trdArg -> fdsOpen, 1) < trdArg -> fdBudget &&
+			ioRingPrepOpenat(w -> ring, fd, b -> entries[i] -> d_name, flags,
+							 i)) {
+
+			b -> children[i] -> openedFd = OPEN_PENDING;
+		} else if (b -> children[i] != NULL && w -> ring != NULL) {
+
+			atomic_fetch_sub(&trdArg -> fdsOpen, 1);
+		}
+	}
+	submitted = trdSubmitRing(w);
+	while (w -> ring != NULL && ioRingReap(w -> ring, &i, &res)) {
+
+		if (res >= 0) {
+
+			b -> children[i] -> openedFd = res;
+		}
+	}
+	if (!submitted) {
+
+		trdDropRing(w);
+	}
+
+	for (i = 0; i < (unsigned long long)b -> size; i++) {
+
+		if (b -> children[i] != NULL) {
+
+			/* If the openat failed or never completed, it is opened again,
+			and any error reported, when it is searched						*/
+			if (b -> children[i] -> openedFd == OPEN_PENDING) {
+
+				b -> children[i] -> openedFd = -1;
+				atomic_fetch_sub(&trdArg -> fdsOpen, 1);
+			}
+			trdPushDir(w, b -> children[i]);
+		}
+	}
+	b -> size = 0;
 }
 
 /*
-* description: Runs all threads (including main) through mfind() and the joins
-* them.
-* param[in]: a - args struct filled with parsed arguments.
+* description: Submits a thread's prepared io_uring requests and waits for
+* them. If that fails, those that completed can still be reaped, and the ring
+* must then be dropped with trdDropRing().
+* param[in]: w - The thread.
+* return: If the requests completed; 1, else 0 (also if there is no ring).
 */
-void runThreads (args *a) {
+int trdSubmitRing (worker *w) {
 
-	initMutexAndSem(a -> nrStart);
+	if (w -> ring == NULL) {
 
-	pthread_t trd[a -> nrthr];
-	trdArgs trdArg;
-	trdArg.q = queueEmpty();
-	trdArg.target = objectNew(a -> target, a -> type);
-	a -> target = NULL;
-
-	printf("\n");
-	initQueue(a, trdArg.q, trdArg.target);
-	threadsCreate(a -> nrthr, &trdArg, trd);		/* Running threads		*/
-	void *reads = mfind(&trdArg);					/* Running main thread 	*/
-	printf("\n");
-	threadsJoin(a -> nrthr, trd);
-	printf("Thread: %ld Reads: %d\n", pthread_self(), *(int *)reads);
+		return 0;
+	}
+	if (ioRingSubmit(w -> ring) < 0) {
 
-	sfree(reads);
-	objectKill(trdArg.target);
-	queueKill(trdArg.q);
+		perror("io_uring failed, reading synchronously");
+		return 0;
+	}
+	return 1;
 }
 
+/*
+* description: Drops a thread's io_uring after it failed, since requests
+* might still be in it. The thread reads synchronously from then on.
+* param[in]: w - The thread.
+*/
+void trdDropRing (worker *w) {
+
+	ioRingKill(w -> ring);
+	w -> ring = NULL;
+}
 
 /*
-* description: Initiates global mutexes mtxQueue, mtxThrCounter and also
-* global semaphore semTrdSearch.
-* param[in]: semValue - The value to be set on semaphore.
+* description: Compares an entry in a directory to the target. If they equal,
+* the entry's path will be written to the thread's output buffer.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory the entry is in.
+* param[in]: fd - Open fd of the directory.
+* param[in]: entryName - Name of the entry.
+* param[in]: type - Type of the entry, or '\0' if it could not be stat'ed.
+* param[in/out]: stx - The entry's stat from trdGetEntryType(), if its
+* stx_mask is not 0, and where it is stat'ed if a match needs it.
+* return: If the entry is a directory to be searched, a new object for it,
+* else NULL.
 */
-void initMutexAndSem (int semValue) {
+object *trdHandleEntry (worker *w, object *o, int fd, char *entryName,
+						char type, struct statx *stx) {
+
+	w -> stats.entries++;
+	if (type == '\0') {
+
+		return NULL;
+	}
+	unsigned int indexId = 0;
+	if (w -> index != NULL) {
 
-	int rc = 0;
+		indexId = indexWriterAdd(w -> index, o -> indexId, entryName, type);
+	}
+	int nrMatched = 0;
+	if (o -> depth + 1 >= w -> shared -> minDepth && !o -> reported) {
+
+		nrMatched = trdMatchTargets(w, entryName, type);
+	}
+	if (nrMatched > 0 && w -> shared -> where != NULL &&
+		!trdMatchWhere(w, o, fd, entryName, type, stx)) {
 
-	if ((rc = pthread_mutex_init(&mtxQueue, NULL) != 0)) {
+		nrMatched = 0;
+	}
+	if (nrMatched > 0) {
 
-		fprintf(stderr, "phtread_mutex_init failed with error code %d\n", rc);
-		exit(1);
+		w -> stats.matches++;
 	}
-	if ((rc = pthread_mutex_init(&mtxThrCounter, NULL) != 0)) {
+	if (nrMatched > 0 && trdCountMatch(w -> shared) &&
+		w -> shared -> report == REPORT_PATHS) {
 
-		fprintf(stderr, "phtread_mutex_init failed with error code %d\n", rc);
-		exit(1);
+		const struct statx *matchStx = NULL;
+		if (w -> shared -> matchMask != 0) {
+
+			matchStx = trdMatchStat(w, o, fd, entryName,
+									w -> shared -> matchMask, stx);
+		}
+		trdReportMatch(w, objectGetPath(o, entryName), type, o -> depth + 1,
+					   nrMatched, matchStx);
 	}
-	if ((rc = sem_init(&semTrdSearch, 0, semValue)) != 0) {
+	if (type == 'd' && !trdPruneDir(w, o, fd, entryName)) {
 
-		fprintf(stderr, "sem_init failed with error code %d\n", rc);
-		exit(1);
+		object *child = objectNewChild(o, entryName);
+		child -> indexId = indexId;
+		return child;
 	}
+	return NULL;
 }
 
 /*
-* description: Creates additional (non-main) threads. Threads are created to
-* run with mfind.
-* param[in]: nrthr - Number of threads to be created.
-* param[in]: trdArg - Pointer to thread argument struct (trdArgs).
-* param[in]: trd - Array containing uninitiated threads.
+* description: Checks if a directory found in another should be left out of
+* the search - if it is at the depth limit, on another device than its
+* starting directory (with -x), or excluded by the filter. Its entries are
+* then never read, but it is matched like any other entry.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory it is in.
+* param[in]: fd - Open fd of that directory.
+* param[in]: entryName - Name of the directory.
+* return: If it should be left out; 1, else 0.
 */
-void threadsCreate (int nrthr, trdArgs *trdArg, pthread_t trd[]) {
+int trdPruneDir (worker *w, object *o, int fd, char *entryName) {
 
-	int rc = 0;
-	for (int i = 0; i < nrthr; i++) {
+	trdArgs *trdArg = w -> shared;
+	if (trdArg -> maxDepth >= 0 && o -> depth + 1 >= trdArg -> maxDepth) {
 
-		rc = pthread_create(&trd[i], NULL, mfind, trdArg);
-		if (rc != 0) {
-			fprintf(stderr, "pthread_create failed with error code %d\n", rc);
-			exit(1);
+		return 1;
+	}
+	if (trdArg -> xdev) {
+
+		/* The device is always filled in, whatever the mask				*/
+		struct statx stx;
+		w -> stats.statCalls++;
+		if (statx(fd, entryName, trdGetStatxFlags(trdArg, o), 0, &stx) == 0 &&
+			makedev(stx.stx_dev_major, stx.stx_dev_minor) != o -> dev) {
+
+			return 1;
 		}
 	}
+	return trdArg -> filter != NULL &&
+		   pathFilterMayMatch(trdArg -> filter, entryName) &&
+		   trdIsFiltered(trdArg, o, entryName);
 }
 
 /*
-* description: Joins additional (non-main) threads. Will print out results from
-* mfind (directories searched through) to stdout.
-* param[in]: nrthr - Number of threads to be joined.
-* param[in]: trd - Array containing initiated threads.
+* description: Checks if a directory is excluded by the filter, by its
+* resolved path - its starting directory's resolved path, followed by the
+* rest of its path.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: o - The directory it is in.
+* param[in]: entryName - Name of the directory.
+* return: If it is excluded; 1, else 0.
 */
-void threadsJoin (int nrthr, pthread_t trd[]) {
+int trdIsFiltered (trdArgs *trdArg, object *o, char *entryName) {
 
-	void *reads = NULL;
-	for (int i = 0; i < nrthr; i++) {
+	object *root = o;
+	while (root -> parent != NULL) {
+
+		root = root -> parent;
+	}
+	const char *real = NULL;
+	for (int i = 0; i < trdArg -> nrRoots && real == NULL; i++) {
 
-		pthread_join(trd[i], &reads);
-		printf("Thread: %ld Reads: %d\n", trd[i], *(int *)reads);
-		sfree(reads);
+		if (trdArg -> roots[i] == root) {
+
+			real = trdArg -> realRoots[i];
+		}
+	}
+	if (real == NULL) {
+
+		return 0;
 	}
+
+	/* The rest starts with a slash, unless the start's name ends with one	*/
+	const char *rest = objectGetPath(o, entryName) + strlen(root -> name);
+	int realLen = strlen(real);
+	if (realLen > 0 && real[realLen - 1] == '/') {
+
+		realLen--;
+	}
+	int restLen = strlen(rest);
+	char path[realLen + restLen + 2];
+	memcpy(path, real, realLen);
+	path[realLen] = '/';
+	int sep = rest[0] != '/';
+	memcpy(&path[realLen + sep], rest, restLen + 1);
+	return pathFilterMatch(trdArg -> filter, path);
 }
 
 /*
-* description: Initiates queue with the starting directories given as argument
-* to main. Will also see if starting directories compares equal to the target.
-* If so, its complete path will be printed to stdout.
-* param[in]: a - Struct containing arguments from parser.
-* param[in]: q - The queue.
-* param[in]: target - The target.
-* return:
+* description: Matches an entry against the target, or all targets. The
+* indexes of the targets it matched are stored in w -> matched, if there is
+* more than one target.
+* param[in]: w - The searching thread.
+* param[in]: entryName - Name of the entry.
+* param[in]: type - Type of the entry (see trdModeToType()).
+* return: Number of targets the entry matched.
 */
-void initQueue (args *a, queue *q, object *target) {
+int trdMatchTargets (worker *w, char *entryName, char type) {
 
-	for (int i = 0; i < a -> nrStart; i++) {
+	trdArgs *trdArg = w -> shared;
+	if (trdArg -> target == NULL) {
 
-		object *o = objectNew(a -> start[i], 'd');
-		a -> start[i] = NULL;
-		if (objectCmp(target, o)) {
+		return 0;
+	} else if (trdArg -> targets == NULL) {
 
-			int nameLen = strlen(o -> name);
-			if (o -> name[nameLen - 1] == '/') {
+		return trdObjectCmp(trdArg, entryName, type);
+	} else if (trdArg -> target -> type != '\0' &&
+			   trdArg -> target -> type != type) {
 
-				char buffer[nameLen];
-				buffer[nameLen - 1] = '\0';
-				strncpy(buffer, o -> name, nameLen - 1);
-				printf("%s\n", buffer);
-			} else {
+		return 0;
+	}
+	return targetSetMatch(trdArg -> targets, entryName, w -> matched);
+}
 
-				printf("%s\n", o -> name);
-			}
-		}
-		queueEnqueue(q, (void *)o);
+/*
+* description: Counts a match against --max-results. The match that reaches
+* the limit cancels the search, and any after it are not reported.
+* param[in]: trdArg - Shared thread arguments.
+* return: If the match should be reported; 1, else 0.
+*/
+int trdCountMatch (trdArgs *trdArg) {
+
+	long nrResults = atomic_fetch_add(&trdArg -> nrResults, 1) + 1;
+	if (trdArg -> maxResults == 0 || nrResults < trdArg -> maxResults) {
+
+		return 1;
+	} else if (nrResults == trdArg -> maxResults) {
+
+		int running = SEARCH_RUNNING;
+		atomic_compare_exchange_strong(&trdArg -> stopped, &running,
+									   SEARCH_CANCELLED);
+		trdWakeWorkers(trdArg, INT_MAX);
+		return 1;
 	}
+	return 0;
 }
 
 /*
-* description: Runs a thread through trdSearchDir() IF there is an element in
-* queue containing directories to look through. IF there is not BUT other
-* threads are running trdSearchDir(), thread will wait for signal. Else it will
-* quit.
-* param[in]: arg - void pointer to Thread argument struct (trdArgs).
-* return: Allocated memory storing an integer keeping track of how many
-* directories the thread have (succesfully) opened. Should be free'd.
+* description: Checks if the threads should stop searching, because they were
+* stopped or enough matches were found.
+* param[in]: trdArg - Shared thread arguments.
+* return: If they should stop; 1, else 0.
 */
-void *mfind (void *arg) {
+int trdIsStopped (trdArgs *trdArg) {
 
-	int *reads = malloc(sizeof(*reads));
-	*reads = 0;
-	trdArgs *trdArg = (trdArgs *)arg;
-	object *o = NULL;
-	int runLoop = 1;
+	return atomic_load_explicit(&trdArg -> stopped, memory_order_relaxed) !=
+		   SEARCH_RUNNING;
+}
 
-	while (runLoop) {
+/*
+* description: Passes a found path to the search's callback. With more than
+* one target, the targets it matched are in w -> matched.
+* param[in]: w - The searching thread.
+* param[in]: path - The path.
+* param[in]: type - Type of the entry (see trdModeToType()).
+* param[in]: depth - Depth of the entry; 0 for a starting directory.
+* param[in]: nrMatched - Number of targets in w -> matched.
+* param[in]: stx - Metadata of the entry, with trdArg -> matchMask filled,
+* or NULL.
+*/
+void trdReportMatch (worker *w, const char *path, char type, int depth,
+					 int nrMatched, const struct statx *stx) {
+
+	mfindMatch match;
+	mfindStat st;
+	match.stat = NULL;
+	if (stx != NULL) {
+
+		st.ino = stx -> stx_ino;
+		st.size = stx -> stx_size;
+		st.mode = stx -> stx_mode;
+		st.mtimeSec = stx -> stx_mtime.tv_sec;
+		st.mtimeNsec = stx -> stx_mtime.tv_nsec;
+		match.stat = &st;
+	}
+	match.path = path;
+	match.pathLen = strlen(path);
+	match.type = type;
+	match.depth = depth;
+	match.matched = w -> shared -> targets != NULL &&
+					targetSetSize(w -> shared -> targets) > 1 ?
+					w -> matched : NULL;
+	match.nrMatched = nrMatched;
+	match.thread = w -> id;
+	w -> shared -> callback(&match, w -> shared -> data);
+}
 
-		sem_wait(&semTrdSearch);
+/*
+* description: Gets the metadata of a match - the fields of mask, which are
+* some of those of trdGetStatxMask(). If the entry was stat'ed for its type
+* with all of them, that is used, else it is stat'ed now, for all fields of
+* trdGetStatxMask(), so that it is only stat'ed once.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory the entry is in.
+* param[in]: fd - Open fd of the directory.
+* param[in]: entryName - Name of the entry.
+* param[in]: mask - The statx fields needed.
+* param[in/out]: stx - The entry's stat, if stx -> stx_mask is not 0. Filled
+* if the entry is stat'ed now.
+* return: stx, or NULL if the entry could not be stat'ed.
+*/
+const struct statx *trdMatchStat (worker *w, object *o, int fd,
+								  char *entryName, unsigned int mask,
+								  struct statx *stx) {
 
-		pthread_mutex_lock(&mtxQueue);
-		if (!queueIsEmpty(trdArg -> q)) {
+	trdArgs *trdArg = w -> shared;
+	if ((stx -> stx_mask & mask) == mask) {
 
-			o = queueFront(trdArg -> q);
-			queueDequeue(trdArg -> q);
-		}
-		pthread_mutex_unlock(&mtxQueue);
+		return stx;
+	}
+	w -> stats.statCalls++;
+	int flags = trdGetStatxFlags(trdArg, o);
+	int res = statx(fd, entryName, flags, trdGetStatxMask(trdArg), stx);
+	if (res < 0 && trdArg -> followLinks && (errno == ENOENT ||
+		errno == ELOOP)) {
+
+		w -> stats.statCalls++;
+		res = statx(fd, entryName, flags | AT_SYMLINK_NOFOLLOW,
+					trdGetStatxMask(trdArg), stx);
+	}
+	if (res < 0) {
 
-		if (o != NULL) {
+		char *path = objectGetPath(o, entryName);
+		perror(path);
+		w -> stats.errors++;
+		return NULL;
+	}
+	return stx;
+}
 
-			*reads += trdSearchDir(trdArg -> q, o, trdArg -> target);
-			o = NULL;
-		} else {
+/*
+* description: Tests an entry that matched the targets against the --where
+* expression. It is first tested with the stat from trdGetEntryType(), if
+* that has the fields of trdArg -> whereMask, else without one, and only
+* stat'ed if the result then depends on it.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory the entry is in.
+* param[in]: fd - Open fd of the directory.
+* param[in]: entryName - Name of the entry.
+* param[in]: type - Type of the entry (see trdModeToType()).
+* param[in/out]: stx - The entry's stat, if stx -> stx_mask is not 0. Filled
+* if the entry is stat'ed now.
+* return: If the expression is true for the entry; 1, else 0.
+*/
+int trdMatchWhere (worker *w, object *o, int fd, char *entryName, char type,
+				   struct statx *stx) {
 
-			pthread_mutex_lock(&mtxThrCounter);
-			if (THRSRUNNING == 0) {
+	trdArgs *trdArg = w -> shared;
+	const struct statx *st = NULL;
+	if ((stx -> stx_mask & trdArg -> whereMask) == trdArg -> whereMask) {
 
-				runLoop = 0;
-				sem_post(&semTrdSearch);
-			}
-			pthread_mutex_unlock(&mtxThrCounter);
-		}
+		st = stx;
 	}
+	int res = predicateEval(trdArg -> where, entryName, type, st);
+	if (res == PREDICATE_UNKNOWN && st == NULL) {
 
-	return (void *)reads;
+		st = trdMatchStat(w, o, fd, entryName, trdArg -> whereMask, stx);
+		res = st != NULL ? predicateEval(trdArg -> where, entryName, type, st) :
+			  PREDICATE_FALSE;
+	}
+	return res == PREDICATE_TRUE;
 }
 
 /*
-* description: With one thread, searches through an entire directory. Each
-* entry in the directory will be compared to the target - if they equal, the
-* etnry's path will be printed. If the entry is a directory, it will be added
-* as an element to the queue.
-* param[in]: q - The queue.
-* param[in]: o - The directory to be searched.
-* param[in]: target - The target.
-* return: If directory is succesfully opened; 1, else 0.
+* description: Opens a directory object. If its parent's fd is still open, the
+* directory is opened relative to it, else by its full path. Links are only
+* followed with -L, or if it is a starting directory.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: o - The directory.
+* return: The opened fd, or -1 on error (errno is set).
 */
-int trdSearchDir (queue *q, object *o, object *target) {
+int trdOpenDir (trdArgs *trdArg, object *o) {
 
-	pthread_mutex_lock(&mtxThrCounter);
-	THRSRUNNING++;
-	pthread_mutex_unlock(&mtxThrCounter);
+	int fd = -1;
+	int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+	int noFollow = trdArg -> followLinks ? 0 : O_NOFOLLOW;
+	if (o -> openedFd >= 0) {					/* Opened by io_uring		*/
 
-	int succesfullRead = 0;
-	DIR *dir = opendir(o -> name);
-	if (dir == NULL) {
+		fd = o -> openedFd;
+		o -> openedFd = -1;
+		atomic_fetch_sub(&trdArg -> fdsOpen, 1);
+		if (o -> parent != NULL) {
+
+			trdReleaseDirFd(trdArg, o -> parent);
+		}
+	} else if (o -> parent == NULL) {
+
+		fd = open(o -> name, flags);
+		if (fd >= 0) {
 
-		perror(o -> name);
+			o -> remote = trdIsRemoteFs(fd);
+		}
+	} else if (o -> parent -> fd >= 0) {
+
+		fd = openat(o -> parent -> fd, o -> name, flags | noFollow);
+		int err = errno;
+		trdReleaseDirFd(trdArg, o -> parent);
+		errno = err;
 	} else {
 
-		struct dirent *entry;
-		struct stat buf;
-		while ((entry = readdir(dir)) != NULL) {
+		char *path = objectGetPath(o, NULL);
+		fd = open(path, flags | noFollow);
+	}
+	return fd;
+}
 
-			if (entry -> d_name[0] != '.') {
+/*
+* description: Drops a directory that will not be searched, releasing its hold
+* on its parent's fd.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: o - The directory.
+*/
+void trdDropDir (trdArgs *trdArg, object *o) {
 
-				char *newPath = objectAddSuffix(o, entry -> d_name);
+	if (o -> openedFd >= 0) {
 
-				if (lstat(newPath, &buf) < 0) {
+		atomic_fetch_sub(&trdArg -> fdsOpen, 1);
+	}
+	if (o -> parent != NULL) {
 
-					perror(newPath);
-					sfree(newPath);
-				} else {
+		trdReleaseDirFd(trdArg, o -> parent);
+	}
+	objectKill(o);
+}
 
-					if (trdObjectCmp(target, entry -> d_name, &buf)) {
+/*
+* description: Keeps an opened directory's fd in the object, so that its
+* children can be opened relative to it. Only done if the fd budget allows it.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: o - The directory.
+* param[in]: fd - The directory's opened fd.
+* return: If fd is kept by the object; 1, else 0.
+*/
+int trdShareDirFd (trdArgs *trdArg, object *o, int fd) {
 
-						printf("%s\n", newPath);
-					}
+	if (atomic_fetch_add(&trdArg -> fdsOpen, 1) >= trdArg -> fdBudget) {
 
-					if ((buf.st_mode & S_IFMT) == S_IFDIR) {
+		atomic_fetch_sub(&trdArg -> fdsOpen, 1);
+		return 0;
+	}
+	atomic_store(&o -> pending, 1);					/* The reader's hold	*/
+	o -> fd = fd;
+	return 1;
+}
 
-						stringAddForwardslashSuffix(newPath);
-						if (newPath != NULL) {
+/*
+* description: Releases one hold (the reader's, or a child's) on a directory's
+* shared fd. The last release closes it.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: o - The directory.
+*/
+void trdReleaseDirFd (trdArgs *trdArg, object *o) {
 
-							object *newObj = objectNew(newPath, 'd');
-							pthread_mutex_lock(&mtxQueue);
-							queueEnqueue(q, (void *)newObj);
-							pthread_mutex_unlock(&mtxQueue);
-							sem_post(&semTrdSearch);
-						}
-					} else {				/* If entry is not a directory	*/
+	if (o -> fd >= 0 && atomic_fetch_sub(&o -> pending, 1) == 1) {
 
-						sfree(newPath);
-					}
+		close(o -> fd);
+		o -> fd = -1;
+		atomic_fetch_sub(&trdArg -> fdsOpen, 1);
+	}
+}
 
-				}
-			}
-		}
-		succesfullRead = 1;
-		closedir(dir);
+/*
+* description: Gets the type of a directory entry. The type from the dirent is
+* trusted - the entry is only stat'ed (with statx) if the type is unknown.
+* With -L, a link is stat'ed for the type of what it points to, and is only a
+* link ('l') if that does not exist, or the link is part of a loop.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory the entry is in.
+* param[in]: fd - Open fd of the directory.
+* param[in]: entry - The directory entry.
+* param[out]: stx - Filled if the entry was stat'ed, else its stx_mask is 0.
+* return: Type of the entry (see trdModeToType()), or '\0' if stat failed.
+*/
+char trdGetEntryType (worker *w, object *o, int fd, dirEntry *entry,
+					  struct statx *stx) {
+
+	trdArgs *trdArg = w -> shared;
+	char type = trdDirentToType(trdArg, entry);
+	if (type != '\0') {
+
+		stx -> stx_mask = 0;
+		return type;
 	}
-	pthread_mutex_lock(&mtxThrCounter);
-	THRSRUNNING--;
-	pthread_mutex_lock(&mtxQueue);
-	if (queueIsEmpty(q) && THRSRUNNING == 0) {
+	w -> stats.statCalls++;
+	int flags = trdGetStatxFlags(trdArg, o);
+	int res = statx(fd, entry -> d_name, flags,
+					trdGetStatxMask(trdArg), stx);
+	if (res < 0 && trdArg -> followLinks && (errno == ENOENT ||
+		errno == ELOOP)) {
+
+		/* A dangling link, or a loop of links, is a link					*/
+		w -> stats.statCalls++;
+		res = statx(fd, entry -> d_name, flags | AT_SYMLINK_NOFOLLOW,
+					trdGetStatxMask(trdArg), stx);
+	}
+	if (res < 0) {
 
-		sem_post(&semTrdSearch);
+		char *path = objectGetPath(o, entry -> d_name);
+		perror(path);
+		w -> stats.errors++;
+		stx -> stx_mask = 0;
+		return '\0';
 	}
-	pthread_mutex_unlock(&mtxQueue);
-	pthread_mutex_unlock(&mtxThrCounter);
+	return trdModeToType(stx -> stx_mode);
+}
 
-	objectKill(o);
-	return succesfullRead;
+/*
+* description: Gets the type of a directory entry from its dirent, if that is
+* enough - that is, if the type is known, and it is not a link to be followed
+* (-L).
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: entry - The directory entry.
+* return: Type of the entry (see trdModeToType()), or '\0' if it must be
+* stat'ed.
+*/
+char trdDirentToType (trdArgs *trdArg, dirEntry *entry) {
+
+	switch (entry -> d_type) {
+
+		case DT_UNKNOWN:
+			return '\0';
+
+		case DT_DIR:
+			return 'd';
+
+		case DT_REG:
+			return 'f';
+
+		case DT_LNK:
+			return trdArg -> followLinks ? '\0' : 'l';
+
+		default:
+			return 'o';
+	}
 }
 
 /*
-* description: From a thread running trdSearchDir(), compares to see if target
-* equals one of the entries in directory it's searching.
-* param[in]: target - the Target.
-* param[in]: entryName - Name of the entry.
-* param[in]: buf - Buffer to stat struct containing information about the
-* entry. Should be initiated with lstat().
-* return: If entry compares equal to target; 1, else 0.
+* description: Gets the flags to stat entries of a directory with. Symbolic
+* links are only followed with -L.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: o - The directory.
+* return: The statx flags.
 */
-int trdObjectCmp (object *target, char *entryName, struct stat *buf) {
+int trdGetStatxFlags (trdArgs *trdArg, object *o) {
 
-	object entryObj;
-	entryObj.name = entryName;
-	if ((buf -> st_mode & S_IFMT) == S_IFDIR) {
+	int flags = AT_NO_AUTOMOUNT;
+	if (!trdArg -> followLinks) {
+
+		flags |= AT_SYMLINK_NOFOLLOW;
+	}
+	if (o -> remote) {
+
+		flags |= AT_STATX_DONT_SYNC;
+	}
+	return flags;
+}
+
+/*
+* description: Gets the fields to ask for when an entry is stat'ed for its
+* type - those a match is reported with or tested for by --where, so that it
+* need not be stat'ed again (see trdMatchStat()).
+* param[in]: trdArg - Shared thread arguments.
+* return: The statx mask.
+*/
+unsigned int trdGetStatxMask (trdArgs *trdArg) {
+
+	return STATX_TYPE | trdArg -> matchMask | trdArg -> whereMask;
+}
+
+/*
+* description: Converts the file type bits of a mode to an object type.
+* param[in]: mode - The mode.
+* return: 'd' for directory, 'f' for regular file, 'l' for link, else 'o'.
+*/
+char trdModeToType (mode_t mode) {
 
-		entryObj.type = 'd';
-	} else if ((buf -> st_mode & S_IFMT) == S_IFREG) {
+	if ((mode & S_IFMT) == S_IFDIR) {
 
-		entryObj.type = 'f';
-	} else if ((buf -> st_mode & S_IFMT) == S_IFLNK) {
+		return 'd';
+	} else if ((mode & S_IFMT) == S_IFREG) {
 
-		entryObj.type = 'l';
+		return 'f';
+	} else if ((mode & S_IFMT) == S_IFLNK) {
+
+		return 'l';
 	}
-	return objectCmp(target, &entryObj);
+	return 'o';
 }
 
 /*
-* description: To a string, adds a forward slash ( '/' ) to it's last position.
-* string MUST contain two NULL-bytes ( '\0' ) at it's last two positions.
-* param[in]: str - The string.
+* description: Checks if a directory is on a network filesystem, where statx
+* should not force a sync with the server (AT_STATX_DONT_SYNC).
+* param[in]: fd - Open fd of the directory.
+* return: If it is on a network filesystem; 1, else 0.
+*/
+int trdIsRemoteFs (int fd) {
+
+	/* Magic numbers from linux/magic.h, and for CIFS/SMB2 from the kernel	*/
+	static const unsigned long remoteMagics[] = {
+		0x6969,			/* NFS			*/
+		0x517B,			/* SMB			*/
+		0xFF534D42,		/* CIFS			*/
+		0xFE534D42,		/* SMB2			*/
+		0x00C36400,		/* Ceph			*/
+		0x5346414F,		/* AFS			*/
+		0x01021997,		/* 9P			*/
+		0x0BD00BD0,		/* Lustre		*/
+		0x65735546		/* FUSE			*/
+	};
+
+	struct statfs sfs;
+	if (fstatfs(fd, &sfs) == 0) {
+
+		for (size_t i = 0; i < sizeof(remoteMagics) / sizeof(*remoteMagics);
+			 i++) {
+
+			if ((unsigned long)sfs.f_type == remoteMagics[i]) {
+
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+/*
+* description: From a thread running trdSearchDir(), compares to see if target
+* equals one of the entries in directory it's searching.
+* If the target has a matcher, the entry's name is matched with it.
+* param[in]: trdArg - Shared thread arguments (target and pattern).
+* param[in]: entryName - Name of the entry.
+* param[in]: type - Type of the entry (see trdModeToType()).
+* return: If entry compares equal to target; 1, else 0.
 */
-void stringAddForwardslashSuffix (char *str) {
+int trdObjectCmp (trdArgs *trdArg, char *entryName, char type) {
 
-	int len = strlen(str);
-	str[len] = '/';
+	if (trdArg -> m != NULL) {
+
+		return (trdArg -> target -> type == '\0' ||
+				trdArg -> target -> type == type) &&
+				matcherMatch(trdArg -> m, entryName);
+	}
+	object entryObj;
+	entryObj.name = entryName;
+	entryObj.type = type;
+	return objectCmp(trdArg -> target, &entryObj);
 }
 
 /*
 * description: Creates and initiates an object. Allocates memory for it the
-* object.
+* object from the thread's arena.
 * param[in]: name - Name of the object (no memory will be allocated).
 * param[in]: type - The type of object (no memory will be allocated).
 * return: Pointer to the object.
 */
 object *objectNew (char *name, char type) {
 
-	object *o = smalloc(sizeof(*o));
+	object *o = arenaAlloc(sizeof(*o));
 	o -> name = name;
 	o -> type = type;
+	o -> remote = 0;
+	o -> reported = 0;
+	o -> parent = NULL;
+	o -> fd = -1;
+	o -> openedFd = -1;
+	o -> indexId = 0;
+	o -> depth = 0;
+	o -> dev = 0;
+	atomic_init(&o -> refs, 1);
+	atomic_init(&o -> pending, 0);
+	o -> slice = NULL;
+	return o;
+}
+
+/*
+* description: Creates a directory object found in a parent directory. The
+* child holds a reference to its parent, and, if the parent's fd is shared, a
+* hold on that fd until the child has been opened.
+* param[in]: parent - The parent directory.
+* param[in]: name - Entry name of the directory (memory will be allocated from
+* the thread's arena).
+* return: Pointer to the object.
+*/
+object *objectNewChild (object *parent, char *name) {
+
+	int nameLen = strlen(name);
+	char *newName = arenaAlloc(sizeof(char) * (nameLen + 1));
+	memcpy(newName, name, nameLen + 1);
+
+	object *o = objectNew(newName, 'd');
+	o -> remote = parent -> remote;
+	o -> parent = parent;
+	o -> depth = parent -> depth + 1;
+	o -> dev = parent -> dev;
+	atomic_fetch_add(&parent -> refs, 1);
+	if (parent -> fd >= 0) {
+
+		atomic_fetch_add(&parent -> pending, 1);
+	}
+	return o;
+}
+
+/*
+* description: Creates an empty slice of a directory's entries. Like a
+* child, it holds a reference to the directory, and a hold on its fd.
+* param[in]: dir - The directory. Its fd must be shared.
+* return: Pointer to the slice object.
+*/
+object *objectNewSlice (object *dir) {
+
+	object *o = objectNewChild(dir, "");
+	o -> type = 's';
+	o -> depth = dir -> depth;
+	o -> slice = smalloc(sizeof(*o -> slice) + SLICE_BYTES);
+	o -> slice -> size = 0;
+	o -> slice -> capacity = SLICE_BYTES;
 	return o;
 }
 
@@ -397,35 +2500,64 @@ int objectCmp (object *targetO, object *o) {
 }
 
 /*
-* description: Adds a suffix (part between forward slashes ( / )) to an object.
-* New memory will be allocated for the new and longer name, but the objects
-* name will not be altered. At least one forward slash will separete the object
-* name from the suffix. The new name will contain two NULL-bytes ( '\0' ) at
-* its end.
+* description: Checks if a forward slash ( / ) is needed after an object's name
+* when building a path. Only a starting directory can end with one already.
 * param[in]: o - The object.
-* param[in]: suffix - The suffix.
-* return: Pointer to the new object name.
+* return: If a forward slash is needed; 1, else 0.
 */
-char *objectAddSuffix (object *o, char *suffix) {
+static int objectNeedsSeparator (object *o) {
+
+	return o -> parent != NULL || o -> name[strlen(o -> name) - 1] != '/';
+}
+
+/*
+* description: Builds the full path of an object, by walking its parents up to
+* its starting directory. At least one forward slash will separate each name.
+* The path is built in the thread's scratch buffer (see arenaScratch()).
+* param[in]: o - The object.
+* param[in]: entryName - If not NULL, an entry in o to build the path to.
+* return: Pointer to the path. Valid until the thread builds another path.
+*/
+char *objectGetPath (object *o, char *entryName) {
+
+	int length = 0;
+	if (entryName != NULL) {
+
+		length += strlen(entryName) + objectNeedsSeparator(o);
+	}
+	for (object *p = o; p != NULL; p = p -> parent) {
 
-	int oldLength = strlen(o -> name);
-	if (o -> name[oldLength - 1] != '/') {
+		length += strlen(p -> name);
+		if (p != o) {
 
-		oldLength++;
+			length += objectNeedsSeparator(p);
+		}
 	}
-	int newLength =  oldLength + strlen(suffix);
 
+	/* Filled from the end, since the names are found from the end			*/
+	char *path = arenaScratch(sizeof(char) * (length + 1));
+	path[length] = '\0';
+	if (entryName != NULL) {
+
+		int nameLen = strlen(entryName);
+		length -= nameLen;
+		memcpy(&path[length], entryName, nameLen);
+		if (objectNeedsSeparator(o)) {
+
+			path[--length] = '/';
+		}
+	}
+	for (object *p = o; p != NULL; p = p -> parent) {
 
-	char *newPath = smalloc(sizeof(char) * (newLength + 2));
-	newPath[0] = '\0';
-	strcat(newPath, o -> name);
-	newPath[oldLength - 1] = '/';
-	newPath[oldLength] = '\0';
-	strcat(newPath, suffix);
-	newPath[newLength] = '\0';
-	newPath[newLength + 1] = '\0';
+		if (p != o && objectNeedsSeparator(p)) {
 
-	return newPath;
+			path[--length] = '/';
+		}
+		int nameLen = strlen(p -> name);
+		length -= nameLen;
+		memcpy(&path[length], p -> name, nameLen);
+	}
+	return path;
 }
 
 /*
@@ -449,11 +2581,29 @@ char *objectGetSuffixIndex (object *o) {
 }
 
 /*
-* description: Free's an object and the memory allocated for it's name.
+* description: Releases a reference to an object. When the last reference is
+* released, free's the object and the memory allocated for it's name, and
+* releases its parent. May be called from any thread.
 * param[in]: o - The object.
 */
 void objectKill (object *o) {
 
-	sfree(o -> name);
-	sfree(o);
+	while (o != NULL && atomic_fetch_sub(&o -> refs, 1) == 1) {
+
+		object *parent = o -> parent;
+		if (o -> openedFd >= 0) {
+
+			close(o -> openedFd);
+		}
+		sfree(o -> slice);
+		if (parent != NULL) {
+
+			arenaFree(o -> name);
+		} else {
+
+			sfree(o -> name);
+		}
+		arenaFree(o);
+		o = parent;
+	}
 }
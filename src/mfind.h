@@ -2,19 +2,156 @@
 * mfind - Find a specific file, link or directory from a starting directory
 * tree.
 *
-* Synopsis: mfind [-t type] [-p nrthr] start1 [start2 ...] target
+* Synopsis: mfind [-t type] [-p nrthr] [-g | -r] [--fd-budget n]
+* [--dir-buffer size] [--io-uring[=depth]] start1 [start2 ...] target
+*
+* mfind [options] -e target [-e target ...] [-T file] start1 [start2 ...]
+*
+* mfind [options] --where expression start1 [start2 ...] [-e target]
+*
+* mfind [options] --build-index file start1 [start2 ...]
+*
+* mfind [options] --watch file [--rescan seconds] start1 [start2 ...]
+*
+* mfind [-t type] [-g | -r] --index file target (or -e/-T targets)
 *
 * -t		Type of target to find. f=file, d=directory, l=link. If empty,
 * mfind will search for any of these.
 *
 * -p		Number of threads that mfind will use to search for the target.
-* Default value is 1. Must be a positive integer.
+* Default value is 1. Must be a positive integer, or auto to let mfind tune
+* the number while searching: it starts with 2 threads, and keeps adding
+* threads while that makes it read directories faster, up to 4 per CPU (at
+* most 64), or n if given as auto:n.
+* The entries of a directory beyond the first 4096 are split among all
+* threads, so that a huge directory is not searched by one thread alone.
+*
+* -g		Target is a glob (*, ?, [...]) that must match the whole name.
+* An unclosed [ is an error; \[ matches a [.
+*
+* -r		Target is a POSIX extended regex, that matches anywhere in the
+* name unless anchored with ^ or $. \d, \w and \s (and \D, \W, \S) are also
+* supported, but back references and \b, \< and \> are not. Names are
+* matched as bytes, so . matches one byte of a UTF-8 character.
+*
+* -e		Adds a target. May be given many times. If -e, -T or --where is
+* given, all other arguments are starting directories.
+*
+* -T		Adds the targets in a file, one per line. If the file is -, they
+* are read from stdin.
+*
+* --build-index	Walks the starting directories and writes the name, type and
+* parent of every entry to an index file, instead of searching for a target.
+*
+* --index	Answers the search from an index file, without walking the tree.
+* The starting directories are those the index was built from. If one of them,
+* or of up to 4096 directories below them that the index samples, has been
+* modified since, the index is reported as stale on stderr. In a larger tree,
+* a change in a directory outside the sample goes unnoticed.
+*
+* --watch	Builds an index like --build-index, then keeps running and
+* rewrites it as entries are created, deleted and renamed, until interrupted.
+*
+* --rescan	Seconds between rescans of directories that --watch could not
+* watch, when the inotify watch limit is reached. Default is 60.
+*
+* --max-results	Stops the search once n matches are found. The threads are
+* cancelled, and the rest of the tree is not read. --first is the same as
+* --max-results 1.
+*
+* --count	Prints only the number of matches.
+*
+* --exists	Prints nothing, and stops at the first match. Exits with 0 if
+* there was one, else 1.
+*
+* --print0	Ends each found path with a NUL instead of a newline, for
+* xargs -0.
+*
+* --json	Writes each found entry as a JSON object on its own line, with
+* its path, type, depth, size, mtime, inode, mode and, with more than one
+* target, the targets it matched. The metadata is taken from the stat the
+* search made of the entry, if any, so no entry is stat'ed twice. Bytes of a
+* path that are not UTF-8 are written as \u00XX. With --index, only the path,
+* type and targets are known.
+*
+* With --print0 or --json, only the found paths are written, without the
+* threads' number of directories read.
+*
+* --where	Only reports entries that also match a find-style expression,
+* such as --where "-name '*.log' -size +10M -o -mtime -7". Without a target,
+* every entry is tested. The tests are -name glob, -type d|f|l,
+* -size [+-]n[cwbkMG], -mtime [+-]n, -mmin [+-]n, -perm [-/]mode,
+* -user name and -group name, as in find, combined with ( ), !, -a (or
+* nothing) and -o. The expression is compiled once, names and types are
+* tested first, and an entry is only stat'ed if the rest of the expression
+* decides if it matches. Cannot be combined with --index, --build-index
+* or --watch.
+*
+* --min-depth	Only reports entries at least n levels below a starting
+* directory (which is at level 0).
+*
+* --max-depth	Does not search more than n levels below a starting directory.
+*
+* -x		Does not enter directories on another filesystem than their
+* starting directory (like find -xdev).
+*
+* -L		Follows symbolic links (also --follow). A link is reported as the
+* type of what it points to, and only as a link if that does not exist. Each
+* directory is read once, by its device and inode number, so that links back
+* up the tree do not make the search loop.
+*
+* --exclude	Does not enter a directory. May be given many times.
+*
+* --pseudo-fs	Also enters pseudo filesystems (proc, sysfs and the like,
+* as found in /proc/self/mountinfo), which are skipped by default.
+*
+* Directories that are not entered are still reported if they match.
+*
+* --fd-budget	Number of directory file descriptors mfind may keep open, so
+* that subdirectories can be opened relative to their parent. Default is half
+* of RLIMIT_NOFILE. If 0, every directory is opened by its full path.
+*
+* --dir-buffer	Size in bytes of each thread's buffer for reading directory
+* entries. May end with k or m. Default is 256k.
+*
+* --order	Order directories are searched in. With hybrid (the default),
+* each thread goes depth-first through its own directories, so that it
+* holds no more than depth times fan-out of them, and an idle thread takes
+* the shallowest directory of another. dfs also takes the deepest, and bfs
+* goes breadth-first, holding a whole level of the tree at once.
+* 
+* --max-queued	Most directories that may be queued. A thread that finds a
+* directory while the queue is full waits until another takes one, unless
+* all others are waiting too. Default is no limit.
+* 
+* --inode-order	Reads all entries of a directory before handling any, and
+* handles them in order of their inode numbers, so that they are stat'ed and
+* their subdirectories queued in the order of the inode table. Can be much
+* faster on a cold cache, on ext4 or a spinning disk.
+* 
+* --io-uring	Stat and open directory entries in batches through io_uring,
+* with up to depth (default 64) requests in flight per thread. If io_uring is
+* not available, entries are read synchronously.
+*
+* --stats	Writes statistics of the search as JSON to stderr, or to a file
+* if given as --stats=file: the wall and CPU time of each phase, and per
+* thread and in total the directories opened, entries read, stat calls,
+* errors, matches, times parked waiting for work, waits for a contended queue
+* lock, directories stolen from other threads, the largest queue length and the
+* times waited for room in a full queue, the slices of huge directories
+* searched, and the directories not read again as they had been already.
+* With -p auto, also each number of threads chosen, and when, with the
+* directories read per second and mean time per directory that led to it.
 *
 * start		Starting directory to begin search from. Must be one or more
-* starting directories.
+* starting directories. If one is inside another, its directories are only
+* read once, or with --min-depth or --max-depth, read again only if that finds
+* entries at depths not searched before.
 *
 * target	The name of the target file/directory/link that mfind will search
-* for. There must be exactly one target.
+* for, or its pattern if -g or -r is given. With more than one target, all
+* are searched for in one traversal, and each found path is followed by the
+* targets it matched, separated by tabs.
 *
 * Author: Buster Hultgren Wärn <dv17bhn@cs.umu.se>
 *
@@ -33,126 +170,810 @@
 
 // #include "queue.h"
 
-/* Number of threads currently looking through a directory 					*/
-static int THRSRUNNING;
+/* Values of trdArgs.stopped: why the threads stopped before searching all
+directories, if they did												*/
+#define SEARCH_RUNNING 0
+#define SEARCH_CANCELLED 1
+#define SEARCH_INTERRUPTED 2
+#define SEARCH_FAILED 3
 
-/* Mutex variables for locking shared queue or global THRSRUNNING variable 	*/
-pthread_mutex_t mtxQueue;
-pthread_mutex_t mtxThrCounter;
+/* Tuning of -p auto. The search starts with AUTO_START_THREADS active
+threads. Every AUTO_SAMPLE_NS, once at least AUTO_MIN_DIRS directories were
+read since the last sample, the throughput is measured. While it grows by
+more than AUTO_GAIN, the active threads are doubled; when it does not, the
+best level is kept. Every AUTO_PROBE_EVERY samples after that, one more or
+one less level is tried, and kept if it is faster, or no more than AUTO_KEEP
+slower with fewer threads													*/
+#define AUTO_START_THREADS 2
+#define AUTO_SAMPLE_NS 50000000
+#define AUTO_MIN_DIRS 32
+#define AUTO_GAIN 1.10
+#define AUTO_KEEP 0.95
+#define AUTO_PROBE_EVERY 10
 
-/* Semanphore for searching threads. Should be same as objects in queue		*/
-sem_t semTrdSearch;
+/* Once SLICE_THRESHOLD entries of a directory have been read, the rest are
+copied into slices of at most SLICE_BYTES, that any thread can take, so that
+a huge directory is not handled by one thread alone (see trdSplitEntry())	*/
+#define SLICE_THRESHOLD 4096
+#define SLICE_BYTES (64 * 1024)
+
+/* object.openedFd of a directory whose openat is in a thread's io_uring	*/
+#define OPEN_PENDING -2
 
 /* Typedefs for structs declared other files								*/
 typedef struct args args;
-typedef struct queue queue;
+typedef struct scheduler scheduler;
+typedef struct dirReader dirReader;
+typedef struct dirEntry dirEntry;
+typedef struct ioRing ioRing;
+typedef struct matcher matcher;
+typedef struct targetSet targetSet;
+typedef struct indexBuilder indexBuilder;
+typedef struct indexWriter indexWriter;
+typedef struct nameIndex nameIndex;
+typedef struct pathFilter pathFilter;
+typedef struct visitedSet visitedSet;
+typedef struct predicate predicate;
+
+/* Entries of a directory copied out of a reader's buffer, laid out as by
+getdents64. size is the bytes used. entries follows two size_t, so that
+every entry is as aligned as in the reader's buffer							*/
+typedef struct entrySlice {
+
+	size_t size;
+	size_t capacity;
+	char entries[];
+} entrySlice;
 
-/* Object file/directory/link - contains name and type 						*/
+/* Object file/directory/link - contains name and type. A directory found
+while searching only holds its entry name and a reference to its parent. Its
+fd stays open while there are children (pending) still to be opened from it.
+openedFd is the directory's own fd, if io_uring opened it ahead of time.
+indexId is the directory's entry in the index being built, if any. depth
+is 0 for a starting directory, and dev is the device of its starting
+directory, set only with -x. reported is set if the directory's own entries
+were reported by an earlier read of it (see trdFirstVisit()). An object of
+type 's' is a slice of the entries of its parent, held in slice, and NULL for
+any other object.															*/
 typedef struct object {
 
 	char *name;
 	char type;
+	char remote;
+	char reported;
+	struct object *parent;
+	int fd;
+	int openedFd;
+	unsigned int indexId;
+	int depth;
+	dev_t dev;
+	atomic_int refs;
+	atomic_int pending;
+	entrySlice *slice;
 } object;
 
-/* Arguments for each thread - contains a queue and the target 				*/
+/* State of -p auto. Each thread adds the directories it reads, and the time
+each took, to dirsDone and latencyNs. Once nextSample has passed, the thread
+that takes mtx measures the throughput since lastAt, and picks a level.
+best is the fastest level found, at bestRate directories per second.
+growing is set until doubling stops paying off, steady counts samples since
+the last probe, and probeUp is the direction of the next probe				*/
+typedef struct trdTuner {
+
+	pthread_mutex_t mtx;
+	atomic_llong nextSample;
+	atomic_long dirsDone;
+	atomic_long latencyNs;
+	int64_t lastAt;
+	long lastDirs;
+	long lastLatencyNs;
+	int best;
+	double bestRate;
+	int growing;
+	int steady;
+	int probeUp;
+} trdTuner;
+
+/* Arguments shared by all threads - contains the scheduler and the target.
+m is the target compiled into a matcher, or NULL if it must be compared with
+objectCmp() (a literal name containing a slash). If there is more than one
+target, they are all in targets, and target only holds their type. When only
+building an index, target is NULL. index is NULL unless building one.
+Matches are counted in nrResults, and only passed to the callback if report
+is REPORT_PATHS (see parseMfind.h) and within maxResults. Directories are
+not entered below maxDepth (-1 for no limit), on another device than their
+starting directory if xdev is set, or if they are in filter. realRoots holds
+the resolved path of each starting directory in roots, for the filter.
+matchMask is the statx fields reported with each match (see mfindMatch),
+or 0. Matches of the targets must also match where, the --where expression,
+if it is not NULL; whereMask is the statx fields it tests. Matches are passed
+to callback, with data. pending is the number of directories pushed and not
+yet searched to the end; the search is done when it reaches 0. Threads
+without work park on the futex workSeq, which is bumped whenever there is a
+reason to wake one - work pushed while thrsIdle threads are parked (or about
+to park), the search being done, or stopped.
+If inodeOrder is set, the entries of each directory are handled in inode
+order (see trdReadDirSorted()). With followLinks (-L), links are followed.
+visited holds each directory read, and the depths it was reached at, if
+links are followed or starts may overlap, so that none is read twice unless
+that finds entries at new depths (else NULL). stopped is set when enough
+matches are found (see --max-results), or the search is stopped by
+mfindSearchStop(); the threads then stop searching.
+With -p auto (autoThreads), only threads with an id below active search;
+the others park on the futex activeSeq, which is bumped when active changes
+or the search ends. The levels chosen are recorded in run. If maxQueued is
+set, a thread about to push a directory while that many are queued parks on
+the futex roomSeq, counted in thrsBlocked, until a pop makes room - unless
+all active threads are blocked, when the last one goes on					*/
 typedef struct trdArgs {
 
-	queue *q;
+	scheduler *s;
 	object *target;
+	matcher *m;
+	targetSet *targets;
+	predicate *where;
+	unsigned int whereMask;
+	indexBuilder *index;
+	int nrWorkers;
+	int fdBudget;
+	atomic_int fdsOpen;
+	unsigned int matchMask;
+	int maxResults;
+	int report;
+	atomic_long nrResults;
+	int minDepth;
+	int maxDepth;
+	int xdev;
+	pathFilter *filter;
+	object **roots;
+	char **realRoots;
+	int nrRoots;
+	mfindCallback callback;
+	void *data;
+	atomic_long pending;
+	atomic_uint workSeq;
+	atomic_int thrsIdle;
+	atomic_int stopped;
+	int autoThreads;
+	atomic_int active;
+	atomic_uint activeSeq;
+	trdTuner tuner;
+	statsRun *run;
+	int inodeOrder;
+	int followLinks;
+	visitedSet *visited;
+	int maxQueued;
+	atomic_uint roomSeq;
+	atomic_int thrsBlocked;
 } trdArgs;
 
+/* Entries of a directory waiting for their io_uring requests to complete	*/
+typedef struct entryBatch {
+
+	int size;
+	int capacity;
+	dirEntry **entries;
+	char *types;
+	struct statx *stx;
+	object **children;
+} entryBatch;
+
+/* Arguments for each thread - which deque it owns, the shared arguments and
+its own buffer for reading directories. ring and batch are NULL, unless
+io_uring is used. matched is only used with more than one target, for the
+targets an entry matched. index is the thread's writer to the index being
+built, if any. stats are the thread's counters, merged when the threads are
+joined (see stats.h). With --inode-order, a directory's entries are copied
+to copied, and sorted by inode in byInode, both grown to fit the largest
+directory the thread has read												*/
+typedef struct worker {
+
+	int id;
+	trdArgs *shared;
+	dirReader *reader;
+	ioRing *ring;
+	entryBatch *batch;
+	int *matched;
+	indexWriter *index;
+	entrySlice *copied;
+	dirEntry **byInode;
+	int byInodeSize;
+	trdStats stats;
+} worker;
+
+/* A search (see libmfind.h) - its arguments, what its threads share, and
+each thread's own arguments, id and number of directories read. run holds
+the time of each phase, for --stats. ran is set once it has been run		*/
+struct mfindSearch {
+
+	args *a;
+	trdArgs shared;
+	worker *workers;
+	pthread_t *trd;
+	int *reads;
+	statsRun run;
+	int ran;
+};
+
 /*
-* description: Runs all threads (including main) through mfind() and the joins
-* them.
-* param[in]: a - args struct filled with parsed arguments.
+* description: Initiates the state of -p auto, before any sample is taken.
+* param[in]: t - The tuner.
+* return: 1 on success, else 0 (a message is printed to stderr).
+*/
+int initTuner (trdTuner *t);
+
+/*
+* description: Creates an io_uring and an entry batch for each thread. If
+* io_uring is not available, no thread gets one, and all threads will read
+* directories synchronously.
+* param[in]: workers - Array of all threads' arguments.
+* param[in]: nrWorkers - Number of threads.
+* param[in]: depth - Number of requests each ring can have in flight.
+*/
+void initRings (worker workers[], int nrWorkers, int depth);
+
+/*
+* description: Creates and allocates memory for an empty entry batch.
+* param[in]: capacity - Maximum number of entries in the batch.
+* return: The batch.
 */
-void runThreads (args *a);
+entryBatch *entryBatchNew (int capacity);
 
 /*
-* description: Initiates global mutexes mtxQueue, mtxThrCounter and also
-* global semaphore semTrdSearch.
-* param[in]: semValue - The value to be set on semaphore.
+* description: Frees all memory allocated by an entry batch, including the
+* batch.
+* param[in]: b - The batch.
 */
-void initMutexAndSem (int semValue);
+void entryBatchKill (entryBatch *b);
+
+/*
+* description: Gets the default number of directory file descriptors that may
+* be kept open - half of the soft RLIMIT_NOFILE.
+* return: The default fd budget.
+*/
+int getDefaultFdBudget (void);
 
 /*
 * description: Creates additional (non-main) threads. Threads are created to
 * run with mfind.
 * param[in]: nrthr - Number of threads to be created.
-* param[in]: trdArg - Pointer to thread argument struct (trdArgs).
+* param[in]: workers - Array of nrthr thread argument structs (worker).
 * param[in]: trd - Array containing uninitiated threads.
+* return: Number of threads created. If fewer than nrthr, the creation of the
+* next one failed (a message is printed to stderr).
 */
-void threadsCreate (int nrthr, trdArgs *trdArg, pthread_t trd[]);
+int threadsCreate (int nrthr, worker workers[], pthread_t trd[]);
 
 /*
-* description: Joins additional (non-main) threads. Will print out results from
-* mfind (directories searched through) to stdout.
+* description: Joins additional (non-main) threads, and stores the results
+* from mfind (directories searched through).
 * param[in]: nrthr - Number of threads to be joined.
 * param[in]: trd - Array containing initiated threads.
+* param[out]: reads - Filled with the number of directories each thread read.
 */
-void threadsJoin (int nrthr, pthread_t trd[]);
+void threadsJoin (int nrthr, pthread_t trd[], int reads[]);
 
 /*
-* description: Initiates queue with the starting directories given as argument
-* to main. Will also see if starting directories compares equal to the target.
-* If so, its complete path will be printed to stdout.
+* description: Initiates the main thread's deque with the starting directories
+* of the search. Will also see if starting directories compares equal to the
+* target. If so, they are reported as matches of the main thread.
 * param[in]: a - Struct containing arguments from parser.
-* param[in]: q - The queue.
-* param[in]: target - The target.
+* param[in]: w - The main thread (worker 0).
 * return:
 */
-void initQueue (args *a, queue *q, object *target);
+void initQueue (args *a, worker *w);
+
+/*
+* description: Stats a starting directory that matched, if its metadata is
+* reported (trdArg -> matchMask) or tested (trdArg -> whereMask). Links are
+* followed, as they are when it is opened.
+* param[in]: path - Path of the directory.
+* param[in]: mask - The statx fields needed.
+* param[out]: stx - Filled with its metadata.
+* return: stx, or NULL if no metadata is needed, or it could not be stat'ed.
+*/
+const struct statx *trdStartStat (const char *path, unsigned int mask,
+								  struct statx *stx);
+
+/*
+* description: Creates the filter of directories not to search - the mount
+* points of pseudo filesystems, unless --pseudo-fs is given, and all
+* directories given with --exclude.
+* param[in]: a - args struct filled with parsed arguments.
+* return: The filter, or NULL if it is empty.
+*/
+pathFilter *initFilter (args *a);
 
 /*
 * description: Runs a thread through trdSearchDir() IF there is an element in
-* queue containing directories to look through. IF there is not BUT other
-* threads are running trdSearchDir(), thread will wait for signal. Else it will
-* quit.
-* param[in]: arg - void pointer to Thread argument struct (trdArgs).
+* its own deque, or one it can steal from another thread. IF there is not BUT
+* other threads are running trdSearchDir(), thread will park until work is
+* pushed. Else it will quit.
+* param[in]: arg - void pointer to Thread argument struct (worker).
 * return: Allocated memory storing an integer keeping track of how many
 * directories the thread have (succesfully) opened. Should be free'd.
 */
 void *mfind (void *arg);
 
+/*
+* description: Called by a thread that found no work in any deque. Parks the
+* thread on the futex workSeq until work is pushed, or the search is done or
+* stopped. A woken thread only checks the deques once, and parks again if
+* another thread took the work first.
+* param[in]: w - The thread.
+* return: If there might be work to do; 1, else (search is done) 0.
+*/
+int trdWaitForWork (worker *w);
+
+/*
+* description: Wakes threads parked in trdWaitForWork(), by bumping workSeq.
+* Waking all also wakes the threads parked in trdWaitForTurn() and
+* trdWaitForRoom(), as it is done when the search ends, is stopped, or the
+* number of active threads changes. Safe to call from a signal handler.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: nrThreads - Most threads to wake, or INT_MAX for all.
+*/
+void trdWakeWorkers (trdArgs *trdArg, int nrThreads);
+
+/*
+* description: Called by a thread that is not among the active threads of
+* -p auto. Parks it on the futex activeSeq until it is made active, or the
+* search is done or stopped.
+* param[in]: w - The thread.
+* return: If it is active; 1, else (search is done) 0.
+*/
+int trdWaitForTurn (worker *w);
+
+/*
+* description: Searches a directory with -p auto. Its read is timed and
+* counted for the tuner, and once a sample is due, the thread that gets the
+* tuner's lock picks the number of active threads.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory to be searched.
+* return: If directory is succesfully opened; 1, else 0.
+*/
+int trdSearchDirTuned (worker *w, object *o);
+
+/*
+* description: Measures the throughput since the last sample, and picks the
+* number of active threads (see AUTO_GAIN in mfind.h). A level is only grown
+* while there are at least as many directories queued as active threads, as
+* more threads would have nothing to do. Must hold the tuner's lock.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: now - The time, from statsClock(CLOCK_MONOTONIC).
+*/
+void trdTune (trdArgs *trdArg, int64_t now);
+
+/*
+* description: Pushes a directory to a thread's own deque, counting it as
+* pending, once there is room for it (see trdWaitForRoom()). Only wakes a
+* parked thread if there is one.
+* param[in]: w - The pushing thread.
+* param[in]: o - The directory.
+*/
+void trdPushDir (worker *w, object *o);
+
+/*
+* description: Called by a thread about to push a directory. If --max-queued
+* directories are queued, parks the thread on the futex roomSeq until a pop
+* makes room, or the search is stopped. So that the search never stalls, a
+* thread does not wait if all other active threads are waiting already.
+* param[in]: w - The thread.
+*/
+void trdWaitForRoom (worker *w);
+
+/*
+* description: Called after a directory was popped. Wakes a thread parked in
+* trdWaitForRoom(), if there is one and there is now room for its push.
+* param[in]: trdArg - Shared thread arguments.
+*/
+void trdWakeBlocked (trdArgs *trdArg);
+
+/*
+* description: Counts a directory as searched. The last one wakes all parked
+* threads, since the search is then done.
+* param[in]: trdArg - Shared thread arguments.
+*/
+void trdFinishDir (trdArgs *trdArg);
+
 /*
 * description: With one thread, searches through an entire directory. Each
 * entry in the directory will be compared to the target - if they equal, the
-* etnry's path will be printed. If the entry is a directory, it will be added
-* as an element to the queue.
-* param[in]: q - The queue.
+* etnry's path will be printed. If the entry is a directory, it will be pushed
+* to the thread's own deque. A slice is handed to trdSearchSlice().
+* param[in]: w - The searching thread.
 * param[in]: o - The directory to be searched.
-* param[in]: target - The target.
 * return: If directory is succesfully opened; 1, else 0.
 */
-int trdSearchDir (queue *q, object *o, object *target);
+int trdSearchDir (worker *w, object *o);
 
 /*
-* description: From a thread running trdSearchDir(), compares to see if target
-* equals one of the entries in directory it's searching.
-* param[in]: target - the Target.
+* description: Reads all entries of an opened directory before handling any,
+* copying them out of the reader's buffer. They are then sorted by inode
+* number, so that entries are stat'ed, and subdirectories pushed, in the
+* order of the inode table, and handled like in trdReadDir() or
+* trdReadDirRing(). Entries beyond SLICE_THRESHOLD are split off in that
+* order.
+* param[in]: w - The searching thread. Its reader must be opened on fd.
+* param[in]: o - The directory.
+* param[in]: fd - Open fd of the directory.
+*/
+void trdReadDirSorted (worker *w, object *o, int fd);
+
+/*
+* description: Handles an entry that stays valid while it is handled, unlike
+* one in the reader's buffer. With io_uring, it is added to the thread's
+* batch, which is flushed when full; the caller must flush the rest.
+* Otherwise it is handled at once, and pushed if it is a directory.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory the entry is in.
+* param[in]: fd - Open fd of the directory.
+* param[in]: entry - The entry.
+*/
+void trdHandleCopiedEntry (worker *w, object *o, int fd, dirEntry *entry);
+
+/*
+* description: Called once a directory is opened, when directories are
+* tracked in trdArg -> visited. Adds the directory to the set, by the device
+* and inode number of its fd, and its depth. If it was reached before, it is
+* only read again if that reports entries the earlier reads did not (see
+* trdReadAgain()), and then o -> reported is set if its own entries were
+* reported already.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory.
+* param[in]: fd - Open fd of the directory.
+* return: If it should be read; 1, else 0.
+*/
+int trdFirstVisit (worker *w, object *o, int fd);
+
+/*
+* description: Gets the depths, of those a directory was reached at, from
+* which entries a number of levels below it were reported, as they were
+* within --min-depth and --max-depth. The depths are kept as by
+* visitedSetAdd().
+* param[in]: trdArg - The shared arguments.
+* param[in]: depths - The depths the directory was reached at, bit d set for
+* depth d.
+* param[in]: levels - Number of levels below the directory.
+* return: The depths of depths from which the entries were reported.
+*/
+uint64_t trdDepthMask (trdArgs *trdArg, uint64_t depths, int levels);
+
+/*
+* description: Tells if a directory reached again, at another depth, must be
+* read again - if that reports entries at some level below it, that none of
+* the reads from the depths it was reached at before reported. Without
+* --min-depth or --max-depth, it never must.
+* param[in]: trdArg - The shared arguments.
+* param[in]: depths - The depths it was reached at before, bit d set for
+* depth d.
+* param[in]: depth - The depth it is reached at now.
+* return: If it must be read again; 1, else 0.
+*/
+int trdReadAgain (trdArgs *trdArg, uint64_t depths, int depth);
+
+/*
+* description: Searches a slice of a directory's entries, split off by
+* trdSplitEntry(), like trdReadDir() or trdReadDirRing() would have. Releases
+* the slice's hold on the directory's fd.
+* param[in]: w - The searching thread.
+* param[in]: o - The slice.
+* return: 0, as no directory is opened.
+*/
+int trdSearchSlice (worker *w, object *o);
+
+/*
+* description: Called for each entry read from a directory. Once more than
+* SLICE_THRESHOLD have been read, entries are copied into slices instead of
+* being handled, and each full slice is pushed for any thread to search. Only
+* done if there is more than one thread, and the directory's fd is shared,
+* so that the slices can stat and open its entries.
+* param[in]: w - The reading thread.
+* param[in]: o - The directory.
+* param[in/out]: slice - The slice being filled, or NULL if there is none.
+* param[in]: nrEntries - Number of entries read so far, including this one.
+* param[in]: entry - The entry.
+* return: If the entry was put in a slice; 1, else 0 (it should be handled).
+*/
+int trdSplitEntry (worker *w, object *o, object **slice, int nrEntries,
+				   dirEntry *entry);
+
+/*
+* description: Reads all entries of an opened directory, one at a time. Each
+* entry is handled by trdHandleEntry(), and found directories are pushed.
+* param[in]: w - The searching thread. Its reader must be opened on fd.
+* param[in]: o - The directory.
+* param[in]: fd - Open fd of the directory.
+*/
+void trdReadDir (worker *w, object *o, int fd);
+
+/*
+* description: Reads all entries of an opened directory in batches. Entries
+* are collected until the batch is full, or until the reader's buffer must be
+* refilled, and then handed to trdFlushBatch().
+* param[in]: w - The searching thread. Its reader must be opened on fd.
+* param[in]: o - The directory.
+* param[in]: fd - Open fd of the directory.
+*/
+void trdReadDirRing (worker *w, object *o, int fd);
+
+/*
+* description: Handles a batch of entries through the thread's io_uring. First
+* all entries whose type is unknown are stat'ed, then every entry is handled by
+* trdHandleEntry(). Found directories are opened ahead of time, if the fd
+* budget allows it, and then pushed. Requests that io_uring fails to run are
+* retried synchronously, and the fd budget taken by an openat that did not
+* complete is given back. The batch is emptied.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory.
+* param[in]: fd - Open fd of the directory.
+*/
+void trdFlushBatch (worker *w, object *o, int fd);
+
+/*
+* description: Submits a thread's prepared io_uring requests and waits for
+* them. If that fails, those that completed can still be reaped, and the ring
+* must then be dropped with trdDropRing().
+* param[in]: w - The thread.
+* return: If the requests completed; 1, else 0 (also if there is no ring).
+*/
+int trdSubmitRing (worker *w);
+
+/*
+* description: Drops a thread's io_uring after it failed, since requests
+* might still be in it. The thread reads synchronously from then on.
+* param[in]: w - The thread.
+*/
+void trdDropRing (worker *w);
+
+/*
+* description: Matches an entry against the target, or all targets. The
+* indexes of the targets it matched are stored in w -> matched, if there is
+* more than one target.
+* param[in]: w - The searching thread.
 * param[in]: entryName - Name of the entry.
-* param[in]: buf - Buffer to stat struct containing information about the
-* entry. Should be initiated with lstat().
-* return: If entry compares equal to target; 1, else 0.
+* param[in]: type - Type of the entry (see trdModeToType()).
+* return: Number of targets the entry matched.
+*/
+int trdMatchTargets (worker *w, char *entryName, char type);
+
+/*
+* description: Counts a match against --max-results. The match that reaches
+* the limit cancels the search, and any after it are not reported.
+* param[in]: trdArg - Shared thread arguments.
+* return: If the match should be reported; 1, else 0.
+*/
+int trdCountMatch (trdArgs *trdArg);
+
+/*
+* description: Checks if the threads should stop searching, because they were
+* stopped or enough matches were found.
+* param[in]: trdArg - Shared thread arguments.
+* return: If they should stop; 1, else 0.
+*/
+int trdIsStopped (trdArgs *trdArg);
+
+/*
+* description: Passes a found path to the search's callback. With more than
+* one target, the targets it matched are in w -> matched.
+* param[in]: w - The searching thread.
+* param[in]: path - The path.
+* param[in]: type - Type of the entry (see trdModeToType()).
+* param[in]: depth - Depth of the entry; 0 for a starting directory.
+* param[in]: nrMatched - Number of targets in w -> matched.
+* param[in]: stx - Metadata of the entry, with trdArg -> matchMask filled,
+* or NULL.
+*/
+void trdReportMatch (worker *w, const char *path, char type, int depth,
+					 int nrMatched, const struct statx *stx);
+
+/*
+* description: Gets the metadata of a match - the fields of mask, which are
+* some of those of trdGetStatxMask(). If the entry was stat'ed for its type
+* with all of them, that is used, else it is stat'ed now, for all fields of
+* trdGetStatxMask(), so that it is only stat'ed once.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory the entry is in.
+* param[in]: fd - Open fd of the directory.
+* param[in]: entryName - Name of the entry.
+* param[in]: mask - The statx fields needed.
+* param[in/out]: stx - The entry's stat, if stx -> stx_mask is not 0. Filled
+* if the entry is stat'ed now.
+* return: stx, or NULL if the entry could not be stat'ed.
+*/
+const struct statx *trdMatchStat (worker *w, object *o, int fd,
+								  char *entryName, unsigned int mask,
+								  struct statx *stx);
+
+/*
+* description: Tests an entry that matched the targets against the --where
+* expression. It is first tested with the stat from trdGetEntryType(), if
+* that has the fields of trdArg -> whereMask, else without one, and only
+* stat'ed if the result then depends on it.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory the entry is in.
+* param[in]: fd - Open fd of the directory.
+* param[in]: entryName - Name of the entry.
+* param[in]: type - Type of the entry (see trdModeToType()).
+* param[in/out]: stx - The entry's stat, if stx -> stx_mask is not 0. Filled
+* if the entry is stat'ed now.
+* return: If the expression is true for the entry; 1, else 0.
+*/
+int trdMatchWhere (worker *w, object *o, int fd, char *entryName, char type,
+				   struct statx *stx);
+
+/*
+* description: Compares an entry in a directory to the target. If they equal,
+* the entry's path will be written to the thread's output buffer.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory the entry is in.
+* param[in]: fd - Open fd of the directory.
+* param[in]: entryName - Name of the entry.
+* param[in]: type - Type of the entry, or '\0' if it could not be stat'ed.
+* param[in/out]: stx - The entry's stat from trdGetEntryType(), if its
+* stx_mask is not 0, and where it is stat'ed if a match needs it.
+* return: If the entry is a directory to be searched, a new object for it,
+* else NULL.
+*/
+object *trdHandleEntry (worker *w, object *o, int fd, char *entryName,
+						char type, struct statx *stx);
+
+/*
+* description: Checks if a directory found in another should be left out of
+* the search - if it is at the depth limit, on another device than its
+* starting directory (with -x), or excluded by the filter.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory it is in.
+* param[in]: fd - Open fd of that directory.
+* param[in]: entryName - Name of the directory.
+* return: If it should be left out; 1, else 0.
+*/
+int trdPruneDir (worker *w, object *o, int fd, char *entryName);
+
+/*
+* description: Checks if a directory is excluded by the filter, by its
+* resolved path - its starting directory's resolved path, followed by the
+* rest of its path.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: o - The directory it is in.
+* param[in]: entryName - Name of the directory.
+* return: If it is excluded; 1, else 0.
+*/
+int trdIsFiltered (trdArgs *trdArg, object *o, char *entryName);
+
+/*
+* description: Opens a directory object. If its parent's fd is still open, the
+* directory is opened relative to it, else by its full path.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: o - The directory.
+* return: The opened fd, or -1 on error (errno is set).
+*/
+int trdOpenDir (trdArgs *trdArg, object *o);
+
+/*
+* description: Drops a directory that will not be searched, releasing its hold
+* on its parent's fd.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: o - The directory.
+*/
+void trdDropDir (trdArgs *trdArg, object *o);
+
+/*
+* description: Keeps an opened directory's fd in the object, so that its
+* children can be opened relative to it. Only done if the fd budget allows it.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: o - The directory.
+* param[in]: fd - The directory's opened fd.
+* return: If fd is kept by the object; 1, else 0.
+*/
+int trdShareDirFd (trdArgs *trdArg, object *o, int fd);
+
+/*
+* description: Releases one hold (the reader's, or a child's) on a directory's
+* shared fd. The last release closes it.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: o - The directory.
+*/
+void trdReleaseDirFd (trdArgs *trdArg, object *o);
+
+/*
+* description: Gets the type of a directory entry. The type from the dirent is
+* trusted - the entry is only stat'ed (with statx) if the type is unknown.
+* With -L, a link is stat'ed for the type of what it points to, and is only a
+* link ('l') if that does not exist, or the link is part of a loop.
+* param[in]: w - The searching thread.
+* param[in]: o - The directory the entry is in.
+* param[in]: fd - Open fd of the directory.
+* param[in]: entry - The directory entry.
+* param[out]: stx - Filled if the entry was stat'ed, else its stx_mask is 0.
+* return: Type of the entry (see trdModeToType()), or '\0' if stat failed.
+*/
+char trdGetEntryType (worker *w, object *o, int fd, dirEntry *entry,
+					  struct statx *stx);
+
+/*
+* description: Gets the type of a directory entry from its dirent, if that is
+* enough - that is, if the type is known, and it is not a link to be followed
+* (-L).
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: entry - The directory entry.
+* return: Type of the entry (see trdModeToType()), or '\0' if it must be
+* stat'ed.
 */
-int trdObjectCmp (object *target, char *entryName, struct stat *buf);
+char trdDirentToType (trdArgs *trdArg, dirEntry *entry);
 
 /*
-* description: To a string, adds a forward slash ( '/' ) to it's last position.
-* string MUST contain two NULL-bytes ( '\0' ) at it's last two positions.
-* param[in]: str - The string.
+* description: Gets the flags to stat entries of a directory with. Symbolic
+* links are only followed with -L.
+* param[in]: trdArg - Shared thread arguments.
+* param[in]: o - The directory.
+* return: The statx flags.
 */
-void stringAddForwardslashSuffix (char *str);
+int trdGetStatxFlags (trdArgs *trdArg, object *o);
+
+/*
+* description: Gets the fields to ask for when an entry is stat'ed for its
+* type - those a match is reported with or tested for by --where, so that it
+* need not be stat'ed again (see trdMatchStat()).
+* param[in]: trdArg - Shared thread arguments.
+* return: The statx mask.
+*/
+unsigned int trdGetStatxMask (trdArgs *trdArg);
+
+/*
+* description: Converts the file type bits of a mode to an object type.
+* param[in]: mode - The mode.
+* return: 'd' for directory, 'f' for regular file, 'l' for link, else 'o'.
+*/
+char trdModeToType (mode_t mode);
+
+/*
+* description: Checks if a directory is on a network filesystem, where statx
+* should not force a sync with the server (AT_STATX_DONT_SYNC).
+* param[in]: fd - Open fd of the directory.
+* return: If it is on a network filesystem; 1, else 0.
+*/
+int trdIsRemoteFs (int fd);
+
+/*
+* description: From a thread running trdSearchDir(), compares to see if target
+* equals one of the entries in directory it's searching.
+* If the target has a matcher, the entry's name is matched with it.
+* param[in]: trdArg - Shared thread arguments (target and pattern).
+* param[in]: entryName - Name of the entry.
+* param[in]: type - Type of the entry (see trdModeToType()).
+* return: If entry compares equal to target; 1, else 0.
+*/
+int trdObjectCmp (trdArgs *trdArg, char *entryName, char type);
 
 /*
 * description: Creates and initiates an object. Allocates memory for it the
-* object.
+* object from the thread's arena.
 * param[in]: name - Name of the object (no memory will be allocated).
 * param[in]: type - The type of object (no memory will be allocated).
 * return: Pointer to the object.
 */
 object *objectNew (char *name, char type);
 
+/*
+* description: Creates a directory object found in a parent directory. The
+* child holds a reference to its parent, and, if the parent's fd is shared, a
+* hold on that fd until the child has been opened.
+* param[in]: parent - The parent directory.
+* param[in]: name - Entry name of the directory (memory will be allocated from
+* the thread's arena).
+* return: Pointer to the object.
+*/
+object *objectNewChild (object *parent, char *name);
+
+/*
+* description: Creates an empty slice of a directory's entries. Like a
+* child, it holds a reference to the directory, and a hold on its fd.
+* param[in]: dir - The directory. Its fd must be shared.
+* return: Pointer to the slice object.
+*/
+object *objectNewSlice (object *dir);
+
 /*
 * description: Compares two objects to see if they equal. If their suffixes
 * match (part between forward slashes ( / )), they equal. If target object's
@@ -166,16 +987,14 @@ object *objectNew (char *name, char type);
 int objectCmp (object *targetObj, object *cmpObj);
 
 /*
-* description: Adds a suffix (part between forward slashes ( / )) to an object.
-* New memory will be allocated for the new and longer name, but the objects
-* name will not be altered. At least one forward slash will separete the object
-* name from the suffix. The new name will contain two NULL-bytes ( '\0' ) at
-* its end.
+* description: Builds the full path of an object, by walking its parents up to
+* its starting directory. At least one forward slash will separate each name.
+* The path is built in the thread's scratch buffer (see arenaScratch()).
 * param[in]: o - The object.
-* param[in]: suffix - The suffix.
-* return: Pointer to the new object name.
+* param[in]: entryName - If not NULL, an entry in o to build the path to.
+* return: Pointer to the path. Valid until the thread builds another path.
 */
-char *objectAddSuffix (object *o, char *suffix);
+char *objectGetPath (object *o, char *entryName);
 
 /*
 * description: Gets the suffix (part between forward slashes ( / )) of an
@@ -187,7 +1006,9 @@ char *objectAddSuffix (object *o, char *suffix);
 char *objectGetSuffixIndex (object *o);
 
 /*
-* description: Free's an object and the memory allocated for it's name.
+* description: Releases a reference to an object. When the last reference is
+* released, free's the object and the memory allocated for it's name, and
+* releases its parent. May be called from any thread.
 * param[in]: o - The object.
 */
 void objectKill (object *o);
@@ -0,0 +1,1014 @@
+/*
+* Persistent name index. A search can record every entry it finds - name, type
+* and parent - and write them to a file, which later searches map into memory
+* and answer from, without walking the tree.
+*
+* The file holds no pointers, only offsets and indexes, so it is used as
+* mapped. Names are stored once each, sorted, so a literal target is found by
+* binary search, and a pattern is matched once per distinct name. Each entry
+* links to its parent, so paths are rebuilt from the entries.
+*
+* The header holds the time the index was built and the modification time of
+* each starting directory, and of up to NAMEINDEX_SAMPLE_DIRS directories below
+* them, spread evenly over the tree. When an index is opened, one of them that
+* has been modified since, or while the index was built, is reported as stale.
+* In a tree with more directories than that, a change in one that is not in
+* the sample is not detected.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "nameIndex.h"
+#include "saferMemHandler.h"
+
+#define NAMEINDEX_MAGIC "MFINDIDX"
+#define NAMEINDEX_VERSION 2
+
+/* Layout of an index file: the header, then each table at its offset,
+aligned to 8 bytes. The blob holds the sorted names, then the starting
+directories' paths, all NULL-terminated.									*/
+typedef struct indexHeader {
+
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+	int64_t buildTime;				/* Seconds since the epoch				*/
+	int64_t startSec;				/* When the build started				*/
+	int64_t startNsec;
+	uint64_t fileSize;
+	uint32_t nrEntries;
+	uint32_t nrNames;
+	uint32_t nrRoots;
+	uint32_t nrDirTimes;
+	uint64_t entriesOff;			/* indexEntry[nrEntries]				*/
+	uint64_t nameOffsOff;			/* uint32_t[nrNames], offsets in blob	*/
+	uint64_t nameFirstOff;			/* uint32_t[nrNames + 1], in byName		*/
+	uint64_t byNameOff;				/* uint32_t[nrEntries], sorted by name	*/
+	uint64_t rootsOff;				/* indexRoot[nrRoots]					*/
+	uint64_t dirTimesOff;			/* indexDirTime[nrDirTimes]				*/
+	uint64_t blobOff;
+	uint64_t blobSize;
+} indexHeader;
+
+typedef struct indexEntry {
+
+	uint32_t parent;
+	uint32_t name;
+	char type;
+	char reserved[3];
+} indexEntry;
+
+typedef struct indexRoot {
+
+	uint32_t entry;
+	uint32_t path;					/* Offset in blob						*/
+	int64_t mtimeSec;
+	int64_t mtimeNsec;
+} indexRoot;
+
+/* A sampled directory below the starting directories. A directory that was
+gone when the index was written has a time of -1, so it is always stale		*/
+typedef struct indexDirTime {
+
+	uint32_t entry;
+	uint32_t reserved;
+	int64_t mtimeSec;
+	int64_t mtimeNsec;
+} indexDirTime;
+
+/* Entries added by one thread. names holds their names, NULL-terminated,
+at nameOffs																	*/
+struct indexWriter {
+
+	indexBuilder *b;
+	struct indexWriter *next;
+	int size;
+	int capacity;
+	uint32_t *ids;
+	uint32_t *parents;
+	char *types;
+	size_t *nameOffs;
+	char *names;
+	size_t namesSize;
+	size_t namesCapacity;
+};
+
+/* A starting directory, as recorded when it was added						*/
+typedef struct rootRecord {
+
+	uint32_t entry;
+	char *path;
+	int64_t mtimeSec;
+	int64_t mtimeNsec;
+} rootRecord;
+
+struct indexBuilder {
+
+	pthread_mutex_t mtx;
+	atomic_uint nextId;
+	indexWriter *writers;
+	indexWriter *rootWriter;
+	rootRecord *roots;
+	int nrRoots;
+	struct timespec start;
+};
+
+struct nameIndex {
+
+	void *map;
+	size_t size;
+	const indexHeader *h;
+	const indexEntry *entries;
+	const uint32_t *nameOffs;
+	const uint32_t *nameFirst;
+	const uint32_t *byName;
+	const indexRoot *roots;
+	const indexDirTime *dirTimes;
+	const char *blob;
+};
+
+/* An entry's name and id, for sorting entries by name						*/
+typedef struct nameRef {
+
+	const char *name;
+	uint32_t id;
+} nameRef;
+
+/*
+* description: Creates and allocates memory for an empty index builder.
+* return: The builder.
+*/
+indexBuilder *indexBuilderNew (void) {
+
+	indexBuilder *b = smalloc(sizeof(*b));
+	pthread_mutex_init(&b -> mtx, NULL);
+	atomic_init(&b -> nextId, 0);
+	b -> writers = NULL;
+	b -> roots = NULL;
+	b -> nrRoots = 0;
+	b -> rootWriter = indexWriterNew(b);
+	clock_gettime(CLOCK_REALTIME, &b -> start);
+	return b;
+}
+
+/*
+* description: Adds a starting directory to the index, and records its
+* modification time. Must not be called while threads are adding entries.
+* param[in]: b - The builder.
+* param[in]: path - Path of the directory, as given.
+* return: Id of the directory's entry.
+*/
+uint32_t indexBuilderAddRoot (indexBuilder *b, const char *path) {
+
+	/* The entry is named by the last component, like any other directory	*/
+	int end = strlen(path);
+	while (end > 1 && path[end - 1] == '/') {
+
+		end--;
+	}
+	int begin = end;
+	while (begin > 0 && path[begin - 1] != '/') {
+
+		begin--;
+	}
+	char name[end - begin + 1];
+	memcpy(name, &path[begin], end - begin);
+	name[end - begin] = '\0';
+
+	b -> roots = srealloc(b -> roots, sizeof(*b -> roots) * (b -> nrRoots + 1));
+	rootRecord *r = &b -> roots[b -> nrRoots++];
+	r -> entry = indexWriterAdd(b -> rootWriter, NAMEINDEX_NO_PARENT, name,
+								'd');
+	r -> path = smalloc(strlen(path) + 1);
+	strcpy(r -> path, path);
+	r -> mtimeSec = 0;
+	r -> mtimeNsec = 0;
+	struct stat st;
+	if (stat(path, &st) == 0) {
+
+		r -> mtimeSec = st.st_mtim.tv_sec;
+		r -> mtimeNsec = st.st_mtim.tv_nsec;
+	}
+	return r -> entry;
+}
+
+/*
+* description: Compare function for qsort of entries by name.
+* param[in]: a - First entry.
+* param[in]: b - Second entry.
+* return: Negative, 0 or positive.
+*/
+static int cmpNameRef (const void *a, const void *b) {
+
+	const nameRef *x = a;
+	const nameRef *y = b;
+	int cmp = strcmp(x -> name, y -> name);
+	if (cmp == 0) {
+
+		return x -> id < y -> id ? -1 : x -> id > y -> id;
+	}
+	return cmp;
+}
+
+/*
+* description: Rounds a size up to a multiple of 8.
+* param[in]: size - The size.
+* return: The rounded size.
+*/
+static uint64_t align8 (uint64_t size) {
+
+	return (size + 7) & ~(uint64_t)7;
+}
+
+/*
+* description: Writes all of a memory block to a file descriptor, retrying
+* partial writes.
+* param[in]: fd - The file descriptor.
+* param[in]: data - The memory block.
+* param[in]: len - Length of the block.
+* return: If everything was written; 1, else 0.
+*/
+static int writeAll (int fd, const char *data, size_t len) {
+
+	while (len > 0) {
+
+		ssize_t written = write(fd, data, len);
+		if (written < 0) {
+
+			if (errno == EINTR) {
+
+				continue;
+			}
+			return 0;
+		}
+		data += written;
+		len -= written;
+	}
+	return 1;
+}
+
+/*
+* description: Builds the path of an entry added to a builder, from its
+* starting directory down, the same way a search does.
+* param[in]: b - The builder.
+* param[in]: entries - The entries, by id, with their parents set.
+* param[in]: refs - The entries' names, by id.
+* param[in]: entry - Id of the entry.
+* param[out]: path - Buffer of PATH_MAX bytes.
+* return: If the path fit; 1, else 0.
+*/
+static int indexBuilderPath (indexBuilder *b, const indexEntry *entries,
+							 const nameRef *refs, uint32_t entry, char *path) {
+
+	/* Filled from the end, then moved to the start							*/
+	size_t pos = PATH_MAX - 1;
+	path[pos] = '\0';
+	uint32_t e = entry;
+	while (entries[e].parent < e) {
+
+		size_t len = strlen(refs[e].name);
+		if (len + 1 > pos) {
+
+			return 0;
+		}
+		pos -= len;
+		memcpy(&path[pos], refs[e].name, len);
+		path[--pos] = '/';
+		e = entries[e].parent;
+	}
+	const char *root = NULL;
+	for (int i = 0; i < b -> nrRoots && root == NULL; i++) {
+
+		if (b -> roots[i].entry == e) {
+
+			root = b -> roots[i].path;
+		}
+	}
+	size_t len = root != NULL ? strlen(root) : 0;
+	if (len == 0 || len > pos) {
+
+		return 0;
+	}
+	if (e != entry && root[len - 1] == '/') {
+
+		pos++;						/* The root has a separator already		*/
+	}
+	pos -= len;
+	memcpy(&path[pos], root, len);
+	memmove(path, &path[pos], PATH_MAX - pos);
+	return 1;
+}
+
+/*
+* description: Records the modification times of a sample of the directories
+* below the starting directories - all of them, or up to
+* NAMEINDEX_SAMPLE_DIRS spread evenly by id, so over the whole tree.
+* param[in]: b - The builder.
+* param[in]: entries - The entries, by id, with their parents and types set.
+* param[in]: refs - The entries' names, by id.
+* param[in]: nrEntries - Number of entries.
+* param[out]: nrDirTimes - Set to the number of directories sampled.
+* return: The sampled directories, to be free'd with sfree().
+*/
+static indexDirTime *indexBuilderSampleDirs (indexBuilder *b,
+											 const indexEntry *entries,
+											 const nameRef *refs,
+											 uint32_t nrEntries,
+											 uint32_t *nrDirTimes) {
+
+	uint32_t nrDirs = 0;
+	for (uint32_t i = 0; i < nrEntries; i++) {
+
+		nrDirs += entries[i].type == 'd' && entries[i].parent < i;
+	}
+	uint32_t every = nrDirs / NAMEINDEX_SAMPLE_DIRS + 1;
+	indexDirTime *times = scalloc(nrDirs / every + 1, sizeof(*times));
+	char *path = smalloc(PATH_MAX);
+	uint32_t nrSampled = 0;
+	uint32_t seen = 0;
+	for (uint32_t i = 0; i < nrEntries; i++) {
+
+		if (entries[i].type != 'd' || entries[i].parent >= i ||
+			seen++ % every != 0 || !indexBuilderPath(b, entries, refs, i,
+													 path)) {
+
+			continue;
+		}
+		indexDirTime *t = &times[nrSampled++];
+		t -> entry = i;
+		t -> mtimeSec = -1;
+		t -> mtimeNsec = -1;
+		struct stat st;
+		if (stat(path, &st) == 0) {
+
+			t -> mtimeSec = st.st_mtim.tv_sec;
+			t -> mtimeNsec = st.st_mtim.tv_nsec;
+		}
+	}
+	sfree(path);
+	*nrDirTimes = nrSampled;
+	return times;
+}
+
+/*
+* description: Writes all entries added to the builder to a file, replacing it
+* atomically. Must not be called while threads are adding entries.
+* param[in]: b - The builder.
+* param[in]: file - Path of the file.
+* return: If the index was written; 1, else 0 (a message is printed to stderr).
+*/
+int indexBuilderWrite (indexBuilder *b, const char *file) {
+
+	uint32_t nrEntries = atomic_load(&b -> nextId);
+	indexEntry *entries = scalloc(nrEntries > 0 ? nrEntries : 1,
+								  sizeof(*entries));
+	nameRef *refs = smalloc(sizeof(*refs) * (nrEntries > 0 ? nrEntries : 1));
+	for (indexWriter *w = b -> writers; w != NULL; w = w -> next) {
+
+		for (int i = 0; i < w -> size; i++) {
+
+			uint32_t id = w -> ids[i];
+			entries[id].parent = w -> parents[i];
+			entries[id].type = w -> types[i];
+			refs[id].name = &w -> names[w -> nameOffs[i]];
+			refs[id].id = id;
+		}
+	}
+	uint32_t nrDirTimes;
+	indexDirTime *dirTimes = indexBuilderSampleDirs(b, entries, refs,
+													nrEntries, &nrDirTimes);
+	qsort(refs, nrEntries, sizeof(*refs), cmpNameRef);
+
+	/* Distinct names, and the entries of each, in name order				*/
+	uint32_t *nameOffs = smalloc(sizeof(*nameOffs) * (nrEntries + 1));
+	uint32_t *nameFirst = smalloc(sizeof(*nameFirst) * (nrEntries + 1));
+	uint32_t *byName = smalloc(sizeof(*byName) * (nrEntries + 1));
+	size_t blobSize = 0;
+	for (int i = 0; i < b -> nrRoots; i++) {
+
+		blobSize += strlen(b -> roots[i].path) + 1;
+	}
+	for (uint32_t i = 0; i < nrEntries; i++) {
+
+		if (i == 0 || strcmp(refs[i].name, refs[i - 1].name) != 0) {
+
+			blobSize += strlen(refs[i].name) + 1;
+		}
+	}
+	char *blob = smalloc(blobSize + 1);
+	uint32_t nrNames = 0;
+	size_t blobLen = 0;
+	for (uint32_t i = 0; i < nrEntries; i++) {
+
+		if (i == 0 || strcmp(refs[i].name, refs[i - 1].name) != 0) {
+
+			size_t len = strlen(refs[i].name) + 1;
+			nameOffs[nrNames] = blobLen;
+			nameFirst[nrNames] = i;
+			memcpy(&blob[blobLen], refs[i].name, len);
+			blobLen += len;
+			nrNames++;
+		}
+		entries[refs[i].id].name = nrNames - 1;
+		byName[i] = refs[i].id;
+	}
+	nameFirst[nrNames] = nrEntries;
+
+	indexRoot *roots = scalloc(b -> nrRoots + 1, sizeof(*roots));
+	for (int i = 0; i < b -> nrRoots; i++) {
+
+		size_t len = strlen(b -> roots[i].path) + 1;
+		roots[i].entry = b -> roots[i].entry;
+		roots[i].path = blobLen;
+		roots[i].mtimeSec = b -> roots[i].mtimeSec;
+		roots[i].mtimeNsec = b -> roots[i].mtimeNsec;
+		memcpy(&blob[blobLen], b -> roots[i].path, len);
+		blobLen += len;
+	}
+
+	indexHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, NAMEINDEX_MAGIC, sizeof(h.magic));
+	h.version = NAMEINDEX_VERSION;
+	h.headerSize = sizeof(h);
+	h.buildTime = time(NULL);
+	h.startSec = b -> start.tv_sec;
+	h.startNsec = b -> start.tv_nsec;
+	h.nrEntries = nrEntries;
+	h.nrNames = nrNames;
+	h.nrRoots = b -> nrRoots;
+	h.nrDirTimes = nrDirTimes;
+	h.entriesOff = align8(sizeof(h));
+	h.nameOffsOff = align8(h.entriesOff + sizeof(*entries) * nrEntries);
+	h.nameFirstOff = align8(h.nameOffsOff + sizeof(*nameOffs) * nrNames);
+	h.byNameOff = align8(h.nameFirstOff + sizeof(*nameFirst) * (nrNames + 1));
+	h.rootsOff = align8(h.byNameOff + sizeof(*byName) * nrEntries);
+	h.dirTimesOff = align8(h.rootsOff + sizeof(*roots) * b -> nrRoots);
+	h.blobOff = align8(h.dirTimesOff + sizeof(*dirTimes) * nrDirTimes);
+	h.blobSize = blobLen;
+	h.fileSize = h.blobOff + blobLen;
+
+	/* Written next to the file, then renamed over it						*/
+	char tmp[strlen(file) + 8];
+	snprintf(tmp, sizeof(tmp), "%s.XXXXXX", file);
+	int fd = mkstemp(tmp);
+	int ok = fd >= 0;
+	if (ok) {
+
+		struct {
+			const void *data;
+			uint64_t off;
+			size_t len;
+		} parts[] = {
+			{&h, 0, sizeof(h)},
+			{entries, h.entriesOff, sizeof(*entries) * nrEntries},
+			{nameOffs, h.nameOffsOff, sizeof(*nameOffs) * nrNames},
+			{nameFirst, h.nameFirstOff, sizeof(*nameFirst) * (nrNames + 1)},
+			{byName, h.byNameOff, sizeof(*byName) * nrEntries},
+			{roots, h.rootsOff, sizeof(*roots) * b -> nrRoots},
+			{dirTimes, h.dirTimesOff, sizeof(*dirTimes) * nrDirTimes},
+			{blob, h.blobOff, blobLen}
+		};
+		static const char zeros[8] = {0};
+		uint64_t pos = 0;
+		for (size_t i = 0; i < sizeof(parts) / sizeof(*parts) && ok; i++) {
+
+			ok = writeAll(fd, zeros, parts[i].off - pos) &&
+				 writeAll(fd, parts[i].data, parts[i].len);
+			pos = parts[i].off + parts[i].len;
+		}
+		ok = ok && fchmod(fd, 0644) == 0;
+		ok = close(fd) == 0 && ok;
+		ok = ok && rename(tmp, file) == 0;
+		if (!ok) {
+
+			int err = errno;
+			unlink(tmp);
+			errno = err;
+		}
+	}
+	if (!ok) {
+
+		fprintf(stderr, "Cannot write index %s: %s\n", file, strerror(errno));
+	}
+
+	sfree(entries);
+	sfree(refs);
+	sfree(nameOffs);
+	sfree(nameFirst);
+	sfree(byName);
+	sfree(roots);
+	sfree(dirTimes);
+	sfree(blob);
+	return ok;
+}
+
+/*
+* description: Frees all memory allocated by the builder and its writers,
+* including the builder.
+* param[in]: b - The builder.
+*/
+void indexBuilderKill (indexBuilder *b) {
+
+	if (b != NULL) {
+
+		indexWriter *w = b -> writers;
+		while (w != NULL) {
+
+			indexWriter *next = w -> next;
+			sfree(w -> ids);
+			sfree(w -> parents);
+			sfree(w -> types);
+			sfree(w -> nameOffs);
+			sfree(w -> names);
+			sfree(w);
+			w = next;
+		}
+		for (int i = 0; i < b -> nrRoots; i++) {
+
+			sfree(b -> roots[i].path);
+		}
+		sfree(b -> roots);
+		pthread_mutex_destroy(&b -> mtx);
+		sfree(b);
+	}
+}
+
+/*
+* description: Creates a writer, through which one thread adds entries to a
+* builder. The writer is free'd with its builder.
+* param[in]: b - The builder.
+* return: The writer.
+*/
+indexWriter *indexWriterNew (indexBuilder *b) {
+
+	indexWriter *w = scalloc(1, sizeof(*w));
+	w -> b = b;
+	pthread_mutex_lock(&b -> mtx);
+	w -> next = b -> writers;
+	b -> writers = w;
+	pthread_mutex_unlock(&b -> mtx);
+	return w;
+}
+
+/*
+* description: Adds an entry to the index.
+* param[in]: w - The calling thread's writer.
+* param[in]: parent - Id of the entry's directory.
+* param[in]: name - Name of the entry.
+* param[in]: type - Type of the entry (d, f or l).
+* return: Id of the entry.
+*/
+uint32_t indexWriterAdd (indexWriter *w, uint32_t parent, const char *name,
+						 char type) {
+
+	if (w -> size == w -> capacity) {
+
+		w -> capacity = w -> capacity == 0 ? 1024 : w -> capacity * 2;
+		w -> ids = srealloc(w -> ids, sizeof(*w -> ids) * w -> capacity);
+		w -> parents = srealloc(w -> parents,
+								sizeof(*w -> parents) * w -> capacity);
+		w -> types = srealloc(w -> types, sizeof(*w -> types) * w -> capacity);
+		w -> nameOffs = srealloc(w -> nameOffs,
+								 sizeof(*w -> nameOffs) * w -> capacity);
+	}
+	size_t len = strlen(name) + 1;
+	if (w -> namesSize + len > w -> namesCapacity) {
+
+		w -> namesCapacity = (w -> namesSize + len) * 2 + 16 * 1024;
+		w -> names = srealloc(w -> names, w -> namesCapacity);
+	}
+	uint32_t id = atomic_fetch_add_explicit(&w -> b -> nextId, 1,
+											memory_order_relaxed);
+	w -> ids[w -> size] = id;
+	w -> parents[w -> size] = parent;
+	w -> types[w -> size] = type;
+	w -> nameOffs[w -> size] = w -> namesSize;
+	memcpy(&w -> names[w -> namesSize], name, len);
+	w -> namesSize += len;
+	w -> size++;
+	return id;
+}
+
+/*
+* description: Checks that a table lies within the mapped file.
+* param[in]: ix - The index.
+* param[in]: off - Offset of the table.
+* param[in]: len - Length of the table in bytes.
+* return: If it does; 1, else 0.
+*/
+static int nameIndexHasRange (nameIndex *ix, uint64_t off, uint64_t len) {
+
+	return off % 8 == 0 && off <= ix -> size && len <= ix -> size - off;
+}
+
+/*
+* description: Opens an index file and maps it into memory.
+* param[in]: file - Path of the file.
+* return: The index, or NULL if it could not be opened or is not a valid
+* index (a message is printed to stderr).
+*/
+nameIndex *nameIndexOpen (const char *file) {
+
+	int fd = open(file, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+
+		fprintf(stderr, "Cannot open index %s: %s\n", file, strerror(errno));
+		return NULL;
+	}
+	struct stat st;
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(indexHeader)) {
+
+		fprintf(stderr, "Invalid index %s\n", file);
+		close(fd);
+		return NULL;
+	}
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+
+		fprintf(stderr, "Cannot map index %s: %s\n", file, strerror(errno));
+		return NULL;
+	}
+
+	nameIndex *ix = smalloc(sizeof(*ix));
+	ix -> map = map;
+	ix -> size = st.st_size;
+	ix -> h = map;
+	const indexHeader *h = ix -> h;
+	int valid = memcmp(h -> magic, NAMEINDEX_MAGIC, sizeof(h -> magic)) == 0 &&
+		h -> version == NAMEINDEX_VERSION && h -> headerSize == sizeof(*h) &&
+		h -> fileSize == ix -> size &&
+		nameIndexHasRange(ix, h -> entriesOff,
+						  sizeof(indexEntry) * (uint64_t)h -> nrEntries) &&
+		nameIndexHasRange(ix, h -> nameOffsOff,
+						  sizeof(uint32_t) * (uint64_t)h -> nrNames) &&
+		nameIndexHasRange(ix, h -> nameFirstOff,
+						  sizeof(uint32_t) * ((uint64_t)h -> nrNames + 1)) &&
+		nameIndexHasRange(ix, h -> byNameOff,
+						  sizeof(uint32_t) * (uint64_t)h -> nrEntries) &&
+		nameIndexHasRange(ix, h -> rootsOff,
+						  sizeof(indexRoot) * (uint64_t)h -> nrRoots) &&
+		nameIndexHasRange(ix, h -> dirTimesOff,
+						  sizeof(indexDirTime) * (uint64_t)h -> nrDirTimes) &&
+		nameIndexHasRange(ix, h -> blobOff, h -> blobSize) &&
+		h -> blobSize > 0 &&
+		((const char *)map)[h -> blobOff + h -> blobSize - 1] == '\0';
+	if (!valid) {
+
+		fprintf(stderr, "Invalid index %s\n", file);
+		nameIndexClose(ix);
+		return NULL;
+	}
+	ix -> entries = (const indexEntry *)((const char *)map + h -> entriesOff);
+	ix -> nameOffs = (const uint32_t *)((const char *)map + h -> nameOffsOff);
+	ix -> nameFirst = (const uint32_t *)((const char *)map + h -> nameFirstOff);
+	ix -> byName = (const uint32_t *)((const char *)map + h -> byNameOff);
+	ix -> roots = (const indexRoot *)((const char *)map + h -> rootsOff);
+	ix -> dirTimes = (const indexDirTime *)((const char *)map +
+											h -> dirTimesOff);
+	ix -> blob = (const char *)map + h -> blobOff;
+	return ix;
+}
+
+/*
+* description: Gets a string in the blob. An offset outside the blob gives an
+* empty string.
+* param[in]: ix - The index.
+* param[in]: off - Offset of the string.
+* return: The string.
+*/
+static const char *nameIndexString (nameIndex *ix, uint32_t off) {
+
+	return off < ix -> h -> blobSize ? &ix -> blob[off] : "";
+}
+
+/*
+* description: Checks if a directory's modification time differs from the one
+* recorded, or if it is gone.
+* param[in]: path - Path of the directory.
+* param[in]: sec - The recorded time, in seconds.
+* param[in]: nsec - The nanoseconds of the recorded time.
+* return: If it has changed; 1, else 0.
+*/
+static int nameIndexChanged (const char *path, int64_t sec, int64_t nsec) {
+
+	struct stat st;
+	return stat(path, &st) < 0 || st.st_mtim.tv_sec != sec ||
+		   st.st_mtim.tv_nsec != nsec;
+}
+
+/*
+* description: Reports on stderr that a directory has changed since the index
+* was built.
+* param[in]: ix - The index.
+* param[in]: path - Path of the directory.
+*/
+static void nameIndexReportStale (nameIndex *ix, const char *path) {
+
+	fprintf(stderr, "Index is stale: %s has changed since it was built, %ld "
+					"seconds ago\n", path,
+					(long)(time(NULL) - ix -> h -> buildTime));
+}
+
+/*
+* description: Checks if any starting directory, or sampled directory below
+* them, has been modified since the index was built. Each starting directory
+* that has is reported on stderr, or else the first other directory that has.
+* param[in]: ix - The index.
+* return: Number of stale directories reported.
+*/
+int nameIndexCheckStale (nameIndex *ix) {
+
+	const indexHeader *h = ix -> h;
+	int stale = 0;
+	for (uint32_t i = 0; i < h -> nrRoots; i++) {
+
+		const indexRoot *r = &ix -> roots[i];
+		const char *path = nameIndexString(ix, r -> path);
+		if (nameIndexChanged(path, r -> mtimeSec, r -> mtimeNsec)) {
+
+			nameIndexReportStale(ix, path);
+			stale++;
+		}
+	}
+
+	/* One stale directory below them is enough to tell					*/
+	for (uint32_t i = 0; i < h -> nrDirTimes && stale == 0; i++) {
+
+		const indexDirTime *d = &ix -> dirTimes[i];
+		if (d -> entry >= h -> nrEntries) {
+
+			continue;
+		}
+		int changedDuring = d -> mtimeSec > h -> startSec ||
+							(d -> mtimeSec == h -> startSec &&
+							 d -> mtimeNsec >= h -> startNsec);
+		char *path = nameIndexPath(ix, d -> entry);
+		if (changedDuring ||
+			nameIndexChanged(path, d -> mtimeSec, d -> mtimeNsec)) {
+
+			nameIndexReportStale(ix, path);
+			stale++;
+		}
+	}
+	return stale;
+}
+
+/*
+* description: Gets the number of distinct names in the index.
+* param[in]: ix - The index.
+* return: The number of names.
+*/
+uint32_t nameIndexNrNames (nameIndex *ix) {
+
+	return ix -> h -> nrNames;
+}
+
+/*
+* description: Gets a distinct name. Names are sorted by strcmp().
+* param[in]: ix - The index.
+* param[in]: nameId - Index of the name.
+* return: The name.
+*/
+const char *nameIndexName (nameIndex *ix, uint32_t nameId) {
+
+	if (nameId >= ix -> h -> nrNames) {
+
+		return "";
+	}
+	return nameIndexString(ix, ix -> nameOffs[nameId]);
+}
+
+/*
+* description: Finds a name by binary search.
+* param[in]: ix - The index.
+* param[in]: name - The name.
+* return: Index of the name, or -1 if no entry has it.
+*/
+int64_t nameIndexFind (nameIndex *ix, const char *name) {
+
+	int64_t low = 0;
+	int64_t high = (int64_t)ix -> h -> nrNames - 1;
+	while (low <= high) {
+
+		int64_t mid = low + (high - low) / 2;
+		int cmp = strcmp(nameIndexName(ix, mid), name);
+		if (cmp == 0) {
+
+			return mid;
+		} else if (cmp < 0) {
+
+			low = mid + 1;
+		} else {
+
+			high = mid - 1;
+		}
+	}
+	return -1;
+}
+
+/*
+* description: Gets all entries with a name.
+* param[in]: ix - The index.
+* param[in]: nameId - Index of the name.
+* param[out]: entries - Set to the ids of the entries. Points into the index.
+* return: Number of entries.
+*/
+uint32_t nameIndexEntries (nameIndex *ix, uint32_t nameId,
+						   const uint32_t **entries) {
+
+	uint32_t first = ix -> nameFirst[nameId];
+	uint32_t last = ix -> nameFirst[nameId + 1];
+	if (first > last || last > ix -> h -> nrEntries) {
+
+		return 0;
+	}
+	*entries = &ix -> byName[first];
+	return last - first;
+}
+
+/*
+* description: Gets the type of an entry.
+* param[in]: ix - The index.
+* param[in]: entry - Id of the entry.
+* return: The type (d, f or l).
+*/
+char nameIndexType (nameIndex *ix, uint32_t entry) {
+
+	return entry < ix -> h -> nrEntries ? ix -> entries[entry].type : '\0';
+}
+
+/*
+* description: Gets the number of entries in the index.
+* param[in]: ix - The index.
+* return: The number of entries.
+*/
+uint32_t nameIndexNrEntries (nameIndex *ix) {
+
+	return ix -> h -> nrEntries;
+}
+
+/*
+* description: Gets the parent of an entry.
+* param[in]: ix - The index.
+* param[in]: entry - Id of the entry.
+* return: Id of the parent, or NAMEINDEX_NO_PARENT for a starting directory.
+*/
+uint32_t nameIndexParent (nameIndex *ix, uint32_t entry) {
+
+	uint32_t parent = ix -> entries[entry].parent;
+	return parent < entry ? parent : NAMEINDEX_NO_PARENT;
+}
+
+/*
+* description: Gets the name of an entry.
+* param[in]: ix - The index.
+* param[in]: entry - Id of the entry.
+* return: The name.
+*/
+const char *nameIndexEntryName (nameIndex *ix, uint32_t entry) {
+
+	return nameIndexName(ix, ix -> entries[entry].name);
+}
+
+/*
+* description: Gets the number of starting directories in the index.
+* param[in]: ix - The index.
+* return: The number of starting directories.
+*/
+uint32_t nameIndexNrRoots (nameIndex *ix) {
+
+	return ix -> h -> nrRoots;
+}
+
+/*
+* description: Gets a starting directory.
+* param[in]: ix - The index.
+* param[in]: i - Index of the starting directory.
+* param[out]: path - Set to its path, as given when the index was built.
+* return: Id of its entry.
+*/
+uint32_t nameIndexRoot (nameIndex *ix, uint32_t i, const char **path) {
+
+	*path = nameIndexString(ix, ix -> roots[i].path);
+	return ix -> roots[i].entry;
+}
+
+/*
+* description: Gets the path of a starting directory.
+* param[in]: ix - The index.
+* param[in]: entry - Id of the directory's entry.
+* return: The path, or its name if it is not a starting directory.
+*/
+static const char *nameIndexRootPath (nameIndex *ix, uint32_t entry) {
+
+	for (uint32_t i = 0; i < ix -> h -> nrRoots; i++) {
+
+		if (ix -> roots[i].entry == entry) {
+
+			return nameIndexString(ix, ix -> roots[i].path);
+		}
+	}
+	return nameIndexName(ix, ix -> entries[entry].name);
+}
+
+/*
+* description: Checks if a forward slash ( / ) is needed between a directory's
+* path and the name of an entry in it. Only a starting directory can end with
+* one already.
+* param[in]: ix - The index.
+* param[in]: dir - Id of the directory's entry.
+* return: If a forward slash is needed; 1, else 0.
+*/
+static int nameIndexNeedsSeparator (nameIndex *ix, uint32_t dir) {
+
+	if (ix -> entries[dir].parent < dir) {
+
+		return 1;
+	}
+	const char *root = nameIndexRootPath(ix, dir);
+	size_t len = strlen(root);
+	return len == 0 || root[len - 1] != '/';
+}
+
+/*
+* description: Builds the complete path of an entry, the same way a search
+* does. The path is stored in the calling thread's scratch buffer (see
+* arenaScratch()), and must not be free'd. A parent always has a smaller id
+* than its children, so a corrupt parent link ends the path instead of
+* looping.
+* param[in]: ix - The index.
+* param[in]: entry - Id of the entry.
+* return: The path.
+*/
+char *nameIndexPath (nameIndex *ix, uint32_t entry) {
+
+	/* Length first, then filled from the end, like objectGetPath()			*/
+	size_t length = 0;
+	uint32_t e = entry;
+	while (ix -> entries[e].parent < e) {
+
+		uint32_t parent = ix -> entries[e].parent;
+		length += strlen(nameIndexName(ix, ix -> entries[e].name)) +
+				  nameIndexNeedsSeparator(ix, parent);
+		e = parent;
+	}
+	const char *root = nameIndexRootPath(ix, e);
+	size_t rootLen = strlen(root);
+	if (e == entry && rootLen > 0 && root[rootLen - 1] == '/') {
+
+		rootLen--;					/* Printed without it, like initQueue()	*/
+	}
+	length += rootLen;
+
+	char *path = arenaScratch(length + 1);
+	path[length] = '\0';
+	e = entry;
+	while (ix -> entries[e].parent < e) {
+
+		uint32_t parent = ix -> entries[e].parent;
+		const char *name = nameIndexName(ix, ix -> entries[e].name);
+		size_t len = strlen(name);
+		length -= len;
+		memcpy(&path[length], name, len);
+		if (nameIndexNeedsSeparator(ix, parent)) {
+
+			path[--length] = '/';
+		}
+		e = parent;
+	}
+	memcpy(path, root, rootLen);
+	return path;
+}
+
+/*
+* description: Unmaps the index, and frees all memory allocated by it,
+* including the index.
+* param[in]: ix - The index.
+*/
+void nameIndexClose (nameIndex *ix) {
+
+	if (ix != NULL) {
+
+		munmap(ix -> map, ix -> size);
+		sfree(ix);
+	}
+}
@@ -0,0 +1,202 @@
+/*
+* Persistent name index. A search can record every entry it finds - name, type
+* and parent - and write them to a file, which later searches map into memory
+* and answer from, without walking the tree.
+*
+* The file holds no pointers, only offsets and indexes, so it is used as
+* mapped. Names are stored once each, sorted, so a literal target is found by
+* binary search, and a pattern is matched once per distinct name. Each entry
+* links to its parent, so paths are rebuilt from the entries.
+*
+* The header holds the time the index was built and the modification time of
+* each starting directory, and of up to NAMEINDEX_SAMPLE_DIRS directories below
+* them, spread evenly over the tree. When an index is opened, one of them that
+* has been modified since, or while the index was built, is reported as stale.
+* In a tree with more directories than that, a change in one that is not in
+* the sample is not detected.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#ifndef __NAMEINDEX__
+#define __NAMEINDEX__
+
+#include <stdint.h>
+
+/* Parent of a starting directory											*/
+#define NAMEINDEX_NO_PARENT UINT32_MAX
+
+/* Most directories below the starting directories whose modification time
+is recorded, and checked when the index is opened							*/
+#define NAMEINDEX_SAMPLE_DIRS 4096
+
+typedef struct indexBuilder indexBuilder;
+typedef struct indexWriter indexWriter;
+typedef struct nameIndex nameIndex;
+
+/*
+* description: Creates and allocates memory for an empty index builder.
+* return: The builder.
+*/
+indexBuilder *indexBuilderNew (void);
+
+/*
+* description: Adds a starting directory to the index, and records its
+* modification time. Must not be called while threads are adding entries.
+* param[in]: b - The builder.
+* param[in]: path - Path of the directory, as given.
+* return: Id of the directory's entry.
+*/
+uint32_t indexBuilderAddRoot (indexBuilder *b, const char *path);
+
+/*
+* description: Writes all entries added to the builder to a file, replacing it
+* atomically. Must not be called while threads are adding entries.
+* param[in]: b - The builder.
+* param[in]: file - Path of the file.
+* return: If the index was written; 1, else 0 (a message is printed to stderr).
+*/
+int indexBuilderWrite (indexBuilder *b, const char *file);
+
+/*
+* description: Frees all memory allocated by the builder and its writers,
+* including the builder.
+* param[in]: b - The builder.
+*/
+void indexBuilderKill (indexBuilder *b);
+
+/*
+* description: Creates a writer, through which one thread adds entries to a
+* builder. The writer is free'd with its builder.
+* param[in]: b - The builder.
+* return: The writer.
+*/
+indexWriter *indexWriterNew (indexBuilder *b);
+
+/*
+* description: Adds an entry to the index.
+* param[in]: w - The calling thread's writer.
+* param[in]: parent - Id of the entry's directory.
+* param[in]: name - Name of the entry.
+* param[in]: type - Type of the entry (d, f or l).
+* return: Id of the entry.
+*/
+uint32_t indexWriterAdd (indexWriter *w, uint32_t parent, const char *name,
+						 char type);
+
+/*
+* description: Opens an index file and maps it into memory.
+* param[in]: file - Path of the file.
+* return: The index, or NULL if it could not be opened or is not a valid
+* index (a message is printed to stderr).
+*/
+nameIndex *nameIndexOpen (const char *file);
+
+/*
+* description: Checks if any starting directory, or sampled directory below
+* them, has been modified since the index was built. Each starting directory
+* that has is reported on stderr, or else the first other directory that has.
+* param[in]: ix - The index.
+* return: Number of stale directories reported.
+*/
+int nameIndexCheckStale (nameIndex *ix);
+
+/*
+* description: Gets the number of distinct names in the index.
+* param[in]: ix - The index.
+* return: The number of names.
+*/
+uint32_t nameIndexNrNames (nameIndex *ix);
+
+/*
+* description: Gets a distinct name. Names are sorted by strcmp().
+* param[in]: ix - The index.
+* param[in]: nameId - Index of the name.
+* return: The name.
+*/
+const char *nameIndexName (nameIndex *ix, uint32_t nameId);
+
+/*
+* description: Finds a name by binary search.
+* param[in]: ix - The index.
+* param[in]: name - The name.
+* return: Index of the name, or -1 if no entry has it.
+*/
+int64_t nameIndexFind (nameIndex *ix, const char *name);
+
+/*
+* description: Gets all entries with a name.
+* param[in]: ix - The index.
+* param[in]: nameId - Index of the name.
+* param[out]: entries - Set to the ids of the entries. Points into the index.
+* return: Number of entries.
+*/
+uint32_t nameIndexEntries (nameIndex *ix, uint32_t nameId,
+						   const uint32_t **entries);
+
+/*
+* description: Gets the number of entries in the index.
+* param[in]: ix - The index.
+* return: The number of entries.
+*/
+uint32_t nameIndexNrEntries (nameIndex *ix);
+
+/*
+* description: Gets the parent of an entry.
+* param[in]: ix - The index.
+* param[in]: entry - Id of the entry.
+* return: Id of the parent, or NAMEINDEX_NO_PARENT for a starting directory.
+*/
+uint32_t nameIndexParent (nameIndex *ix, uint32_t entry);
+
+/*
+* description: Gets the name of an entry.
+* param[in]: ix - The index.
+* param[in]: entry - Id of the entry.
+* return: The name.
+*/
+const char *nameIndexEntryName (nameIndex *ix, uint32_t entry);
+
+/*
+* description: Gets the number of starting directories in the index.
+* param[in]: ix - The index.
+* return: The number of starting directories.
+*/
+uint32_t nameIndexNrRoots (nameIndex *ix);
+
+/*
+* description: Gets a starting directory.
+* param[in]: ix - The index.
+* param[in]: i - Index of the starting directory.
+* param[out]: path - Set to its path, as given when the index was built.
+* return: Id of its entry.
+*/
+uint32_t nameIndexRoot (nameIndex *ix, uint32_t i, const char **path);
+
+/*
+* description: Gets the type of an entry.
+* param[in]: ix - The index.
+* param[in]: entry - Id of the entry.
+* return: The type (d, f or l).
+*/
+char nameIndexType (nameIndex *ix, uint32_t entry);
+
+/*
+* description: Builds the complete path of an entry. The path is stored in the
+* calling thread's scratch buffer (see arenaScratch()), and must not be free'd.
+* param[in]: ix - The index.
+* param[in]: entry - Id of the entry.
+* return: The path.
+*/
+char *nameIndexPath (nameIndex *ix, uint32_t entry);
+
+/*
+* description: Unmaps the index, and frees all memory allocated by it,
+* including the index.
+* param[in]: ix - The index.
+*/
+void nameIndexClose (nameIndex *ix);
+
+#endif //__NAMEINDEX__
@@ -0,0 +1,222 @@
+/*
+* Buffered output. Each thread appends whole lines (or records, such as NUL
+* ended paths) to its own large buffer, which is written with a single write()
+* once it is full. A record may also be written in place, at the end of the
+* buffer. Writes from all buffers are serialized, so a line is never split or
+* mixed with another.
+*
+* All buffers are flushed when the process exits (through atexit), or when
+* outBufferFlushAll() is called, so that no complete line is lost on an early
+* exit.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "outBuffer.h"
+#include "saferMemHandler.h"
+
+/* len is only written by the buffer's thread, after a whole line has been
+copied. flushed is only written while holding mtxOut.						*/
+struct outBuffer {
+
+	int fd;
+	char *buf;
+	size_t size;
+	atomic_size_t len;
+	size_t flushed;
+	outBuffer *next;
+	outBuffer *prev;
+};
+
+/* Serializes writes, and guards the list of all buffers 					*/
+static pthread_mutex_t mtxOut = PTHREAD_MUTEX_INITIALIZER;
+static outBuffer *outBuffers = NULL;
+static pthread_once_t outAtExitOnce = PTHREAD_ONCE_INIT;
+
+/*
+* description: Writes all of a memory block to a file descriptor, retrying
+* partial writes. Gives up silently if the write fails.
+* param[in]: fd - The file descriptor.
+* param[in]: data - The memory block.
+* param[in]: len - Length of the block.
+*/
+static void writeAll (int fd, const char *data, size_t len) {
+
+	while (len > 0) {
+
+		ssize_t written = write(fd, data, len);
+		if (written < 0) {
+
+			if (errno == EINTR) {
+
+				continue;
+			}
+			return;
+		}
+		data += written;
+		len -= written;
+	}
+}
+
+/*
+* description: Registers outBufferFlushAll() to be run at exit.
+*/
+static void outBufferInitAtExit (void) {
+
+	atexit(outBufferFlushAll);
+}
+
+/*
+* description: Creates and allocates memory for an empty output buffer.
+* param[in]: fd - File descriptor the buffer is written to.
+* param[in]: size - Size of the buffer in bytes.
+* return: The buffer.
+*/
+outBuffer *outBufferNew (int fd, size_t size) {
+
+	pthread_once(&outAtExitOnce, outBufferInitAtExit);
+
+	outBuffer *b = smalloc(sizeof(*b));
+	b -> fd = fd;
+	b -> size = size;
+	b -> buf = smalloc(size);
+	atomic_init(&b -> len, 0);
+	b -> flushed = 0;
+
+	pthread_mutex_lock(&mtxOut);
+	b -> prev = NULL;
+	b -> next = outBuffers;
+	if (outBuffers != NULL) {
+
+		outBuffers -> prev = b;
+	}
+	outBuffers = b;
+	pthread_mutex_unlock(&mtxOut);
+	return b;
+}
+
+/*
+* description: Appends a whole record to the buffer, as it is - it must end
+* with its separator (a newline, or a NUL for --print0). If the record does
+* not fit, the buffer is flushed first. A record larger than the buffer is
+* written directly. Must only be called by the buffer's thread.
+* param[in]: b - The buffer.
+* param[in]: rec - The record.
+* param[in]: len - Length of the record.
+*/
+void outBufferRecord (outBuffer *b, const char *rec, size_t len) {
+
+	char *dst = outBufferReserve(b, len);
+	if (dst == NULL) {
+
+		pthread_mutex_lock(&mtxOut);
+		writeAll(b -> fd, rec, len);
+		pthread_mutex_unlock(&mtxOut);
+		return;
+	}
+	memcpy(dst, rec, len);
+	outBufferCommit(b, len);
+}
+
+/*
+* description: Gets room at the end of the buffer for a record of at most len
+* bytes, so that it can be written in place instead of being copied. The
+* buffer is flushed first, if there is not room enough. Nothing is written
+* until outBufferCommit() is called. Must only be called by the buffer's
+* thread.
+* param[in]: b - The buffer.
+* param[in]: len - Most bytes the record may take.
+* return: Where to write the record, or NULL if len is larger than the buffer
+* (use outBufferRecord()).
+*/
+char *outBufferReserve (outBuffer *b, size_t len) {
+
+	size_t cur = atomic_load_explicit(&b -> len, memory_order_relaxed);
+	if (cur + len > b -> size) {
+
+		outBufferFlush(b);
+		cur = 0;
+	}
+	return len > b -> size ? NULL : &b -> buf[cur];
+}
+
+/*
+* description: Appends the record written where outBufferReserve() pointed.
+* Must only be called by the buffer's thread.
+* param[in]: b - The buffer.
+* param[in]: len - Length of the record, at most what was reserved.
+*/
+void outBufferCommit (outBuffer *b, size_t len) {
+
+	size_t cur = atomic_load_explicit(&b -> len, memory_order_relaxed);
+	atomic_store_explicit(&b -> len, cur + len, memory_order_release);
+}
+
+/*
+* description: Writes everything in the buffer, and empties it. Must only be
+* called by the buffer's thread.
+* param[in]: b - The buffer.
+*/
+void outBufferFlush (outBuffer *b) {
+
+	pthread_mutex_lock(&mtxOut);
+	size_t len = atomic_load_explicit(&b -> len, memory_order_relaxed);
+	writeAll(b -> fd, &b -> buf[b -> flushed], len - b -> flushed);
+	b -> flushed = 0;
+	atomic_store_explicit(&b -> len, 0, memory_order_relaxed);
+	pthread_mutex_unlock(&mtxOut);
+}
+
+/*
+* description: Writes all complete lines in all buffers. May be called from
+* any thread, while the buffers' threads are still appending.
+*/
+void outBufferFlushAll (void) {
+
+	pthread_mutex_lock(&mtxOut);
+	for (outBuffer *b = outBuffers; b != NULL; b = b -> next) {
+
+		size_t len = atomic_load_explicit(&b -> len, memory_order_acquire);
+		writeAll(b -> fd, &b -> buf[b -> flushed], len - b -> flushed);
+		b -> flushed = len;
+	}
+	pthread_mutex_unlock(&mtxOut);
+}
+
+/*
+* description: Flushes the buffer, and frees all memory allocated by it,
+* including the buffer.
+* param[in]: b - The buffer.
+*/
+void outBufferKill (outBuffer *b) {
+
+	if (b != NULL) {
+
+		outBufferFlush(b);
+		pthread_mutex_lock(&mtxOut);
+		if (b -> prev != NULL) {
+
+			b -> prev -> next = b -> next;
+		} else {
+
+			outBuffers = b -> next;
+		}
+		if (b -> next != NULL) {
+
+			b -> next -> prev = b -> prev;
+		}
+		pthread_mutex_unlock(&mtxOut);
+		sfree(b -> buf);
+		sfree(b);
+	}
+}
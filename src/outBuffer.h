@@ -0,0 +1,85 @@
+/*
+* Buffered output. Each thread appends whole lines (or records, such as NUL
+* ended paths) to its own large buffer, which is written with a single write()
+* once it is full. A record may also be written in place, at the end of the
+* buffer. Writes from all buffers are serialized, so a line is never split or
+* mixed with another.
+*
+* All buffers are flushed when the process exits (through atexit), or when
+* outBufferFlushAll() is called, so that no complete line is lost on an early
+* exit.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#ifndef __OUTBUFFER__
+#define __OUTBUFFER__
+
+/* Default size of an output buffer in bytes								*/
+#define OUTBUFFER_DEFAULT_SIZE (64 * 1024)
+
+typedef struct outBuffer outBuffer;
+
+/*
+* description: Creates and allocates memory for an empty output buffer.
+* param[in]: fd - File descriptor the buffer is written to.
+* param[in]: size - Size of the buffer in bytes.
+* return: The buffer.
+*/
+outBuffer *outBufferNew (int fd, size_t size);
+
+/*
+* description: Appends a whole record to the buffer, as it is - it must end
+* with its separator (a newline, or a NUL for --print0). If the record does
+* not fit, the buffer is flushed first. A record larger than the buffer is
+* written directly. Must only be called by the buffer's thread.
+* param[in]: b - The buffer.
+* param[in]: rec - The record.
+* param[in]: len - Length of the record.
+*/
+void outBufferRecord (outBuffer *b, const char *rec, size_t len);
+
+/*
+* description: Gets room at the end of the buffer for a record of at most len
+* bytes, so that it can be written in place instead of being copied. The
+* buffer is flushed first, if there is not room enough. Nothing is written
+* until outBufferCommit() is called. Must only be called by the buffer's
+* thread.
+* param[in]: b - The buffer.
+* param[in]: len - Most bytes the record may take.
+* return: Where to write the record, or NULL if len is larger than the buffer
+* (use outBufferRecord()).
+*/
+char *outBufferReserve (outBuffer *b, size_t len);
+
+/*
+* description: Appends the record written where outBufferReserve() pointed.
+* Must only be called by the buffer's thread.
+* param[in]: b - The buffer.
+* param[in]: len - Length of the record, at most what was reserved.
+*/
+void outBufferCommit (outBuffer *b, size_t len);
+
+/*
+* description: Writes everything in the buffer, and empties it. Must only be
+* called by the buffer's thread.
+* param[in]: b - The buffer.
+*/
+void outBufferFlush (outBuffer *b);
+
+/*
+* description: Writes all complete lines in all buffers. May be called from
+* any thread, while the buffers' threads are still appending.
+*/
+void outBufferFlushAll (void);
+
+/*
+* description: Flushes the buffer, and frees all memory allocated by it,
+* including the buffer.
+* param[in]: b - The buffer.
+*/
+void outBufferKill (outBuffer *b);
+
+#endif //__OUTBUFFER__
@@ -12,23 +12,60 @@
 #include <string.h>
 #include <getopt.h>
 #include <unistd.h>
+#include <errno.h>
 
 #include "parseMfind.h"
+#include "queue.h"
+#include "dirReader.h"
+#include "ioRing.h"
+#include "matcher.h"
+#include "watch.h"
 #include "saferMemHandler.h"
 
 /*
-* description: Main parser for arguments. Uses getopt to parse flags. Rest of
-* the arguments are read as starting positions or the target.
+* description: Main parser for arguments. Uses getopt_long to parse flags.
+* Rest of the arguments are read as starting positions, and the last as the
+* target, unless targets were given with -e or -T, or there is a --where
+* expression. When building an index, there is no target, and when querying
+* one, there are no starting positions.
 * param[in]: a - Pointer to args struct. Arguments will be stored here.
 * param[in]: argc - Number of arguments.
 * param[in]: argv - The arguments.
 */
 void parseArgs (args *a, int argc, char *argv[]) {
 
-	/* While loop reading through flags using getopt*/
+	/* While loop reading through flags using getopt_long*/
+	static struct option longOpts[] = {
+		{"fd-budget", required_argument, NULL, OPT_FD_BUDGET},
+		{"dir-buffer", required_argument, NULL, OPT_DIR_BUFFER},
+		{"io-uring", optional_argument, NULL, OPT_IO_URING},
+		{"build-index", required_argument, NULL, OPT_BUILD_INDEX},
+		{"index", required_argument, NULL, OPT_INDEX},
+		{"watch", required_argument, NULL, OPT_WATCH},
+		{"rescan", required_argument, NULL, OPT_RESCAN},
+		{"max-results", required_argument, NULL, OPT_MAX_RESULTS},
+		{"first", no_argument, NULL, OPT_FIRST},
+		{"count", no_argument, NULL, OPT_COUNT},
+		{"exists", no_argument, NULL, OPT_EXISTS},
+		{"min-depth", required_argument, NULL, OPT_MIN_DEPTH},
+		{"max-depth", required_argument, NULL, OPT_MAX_DEPTH},
+		{"xdev", no_argument, NULL, 'x'},
+		{"exclude", required_argument, NULL, OPT_EXCLUDE},
+		{"pseudo-fs", no_argument, NULL, OPT_PSEUDO_FS},
+		{"stats", optional_argument, NULL, OPT_STATS},
+		{"order", required_argument, NULL, OPT_ORDER},
+		{"max-queued", required_argument, NULL, OPT_MAX_QUEUED},
+		{"inode-order", no_argument, NULL, OPT_INODE_ORDER},
+		{"follow", no_argument, NULL, 'L'},
+		{"print0", no_argument, NULL, OPT_PRINT0},
+		{"json", no_argument, NULL, OPT_JSON},
+		{"where", required_argument, NULL, OPT_WHERE},
+		{NULL, 0, NULL, 0}
+	};
 	int opt;
 	int nrthr = 0;
-	while ((opt = getopt(argc, argv, "t:p:")) != -1) {
+	while ((opt = getopt_long(argc, argv, "t:p:gre:T:xL", longOpts,
+							  NULL)) != -1) {
 
 		switch (opt) {
 
@@ -57,18 +94,232 @@ void parseArgs (args *a, int argc, char *argv[]) {
 					argsKill(a);
 					exit(1);
 				}
-				nrthr = strToInt(optarg);
+				a -> autoThreads = strncmp(optarg, "auto", 4) == 0 &&
+								   (optarg[4] == '\0' || optarg[4] == ':');
+				if (!a -> autoThreads) {
+
+					nrthr = strToInt(optarg);
+				} else if (optarg[4] == ':') {
+
+					nrthr = strToInt(optarg + 5);
+				} else {
+
+					nrthr = getDefaultAutoThreads();
+				}
 				if (nrthr > 0) {
 
 					a -> nrthr = nrthr - 1;
 				} else {
 
 					fprintf(stderr, "Invalid argument: -p must be a positive "
-									"integer, which %s is not\n", optarg);
+									"integer, auto or auto:n, which %s is "
+									"not\n", optarg);
+					exit(1);
+				}
+				break;
+
+			case 'g':
+			case 'r':
+				if (a -> matchMode != MATCH_LITERAL) {
+
+					fprintf(stderr, "Invalid argument: -g and -r can only be "
+									"given once, and not together\n");
+					exit(1);
+				}
+				a -> matchMode = opt == 'g' ? MATCH_GLOB : MATCH_REGEX;
+				break;
+
+			case 'e':
+				argsAddTarget(a, optarg);
+				break;
+
+			case 'T':
+				argsReadTargets(a, optarg);
+				break;
+
+			case OPT_FD_BUDGET:
+				a -> fdBudget = strToInt(optarg);
+				if (optarg[0] == '\0' || a -> fdBudget < 0) {
+
+					fprintf(stderr, "Invalid argument: --fd-budget must be a "
+									"non-negative integer, which %s is not\n",
+									optarg);
+					exit(1);
+				}
+				break;
+
+			case OPT_DIR_BUFFER:
+				a -> dirBufSize = strToSize(optarg);
+				if (a -> dirBufSize == 0) {
+
+					fprintf(stderr, "Invalid argument: --dir-buffer must be a "
+									"positive size, which %s is not\n", optarg);
+					exit(1);
+				}
+				break;
+
+			case OPT_IO_URING:
+				a -> ioDepth = IORING_DEFAULT_DEPTH;
+				if (optarg != NULL) {
+
+					a -> ioDepth = strToInt(optarg);
+					if (optarg[0] == '\0' || a -> ioDepth <= 0 ||
+						a -> ioDepth > 4096) {
+
+						fprintf(stderr, "Invalid argument: --io-uring depth "
+										"must be an integer between 1 and "
+										"4096, which %s is not\n", optarg);
+						exit(1);
+					}
+				}
+				break;
+
+			case OPT_BUILD_INDEX:
+				a -> buildIndex = optarg;
+				break;
+
+			case OPT_INDEX:
+				a -> index = optarg;
+				break;
+
+			case OPT_WATCH:
+				a -> buildIndex = optarg;
+				a -> watch = 1;
+				break;
+
+			case OPT_RESCAN:
+				a -> rescan = strToInt(optarg);
+				if (optarg[0] == '\0' || a -> rescan <= 0) {
+
+					fprintf(stderr, "Invalid argument: --rescan must be a "
+									"positive number of seconds, which %s is "
+									"not\n", optarg);
 					exit(1);
 				}
 				break;
 
+			case OPT_MAX_RESULTS:
+				a -> maxResults = strToInt(optarg);
+				if (optarg[0] == '\0' || a -> maxResults <= 0) {
+
+					fprintf(stderr, "Invalid argument: --max-results must be "
+									"a positive integer, which %s is not\n",
+									optarg);
+					exit(1);
+				}
+				break;
+
+			case OPT_FIRST:
+				a -> maxResults = 1;
+				break;
+
+			case OPT_COUNT:
+			case OPT_EXISTS:
+				if (a -> report != REPORT_PATHS) {
+
+					fprintf(stderr, "Invalid argument: --count and --exists "
+									"may only be given once, and not "
+									"together\n");
+					exit(1);
+				}
+				a -> report = opt == OPT_COUNT ? REPORT_COUNT : REPORT_EXISTS;
+				break;
+
+			case OPT_MIN_DEPTH:
+				a -> minDepth = strToInt(optarg);
+				if (optarg[0] == '\0' || a -> minDepth < 0) {
+
+					fprintf(stderr, "Invalid argument: --min-depth must be a "
+									"non-negative integer, which %s is not\n",
+									optarg);
+					exit(1);
+				}
+				break;
+
+			case OPT_MAX_DEPTH:
+				a -> maxDepth = strToInt(optarg);
+				if (optarg[0] == '\0' || a -> maxDepth < 0) {
+
+					fprintf(stderr, "Invalid argument: --max-depth must be a "
+									"non-negative integer, which %s is not\n",
+									optarg);
+					exit(1);
+				}
+				break;
+
+			case 'x':
+				a -> xdev = 1;
+				break;
+
+			case 'L':
+				a -> followLinks = 1;
+				break;
+
+			case OPT_EXCLUDE:
+				a -> excludes = srealloc(a -> excludes, sizeof(*a -> excludes) *
+										 (a -> nrExcludes + 1));
+				a -> excludes[a -> nrExcludes++] = optarg;
+				break;
+
+			case OPT_PSEUDO_FS:
+				a -> pseudoFs = 1;
+				break;
+
+			case OPT_STATS:
+				a -> stats = 1;
+				a -> statsFile = optarg;
+				break;
+
+			case OPT_ORDER:
+				if (strcmp(optarg, "hybrid") == 0) {
+
+					a -> order = SCHEDULER_HYBRID;
+				} else if (strcmp(optarg, "dfs") == 0) {
+
+					a -> order = SCHEDULER_DFS;
+				} else if (strcmp(optarg, "bfs") == 0) {
+
+					a -> order = SCHEDULER_BFS;
+				} else {
+
+					fprintf(stderr, "Invalid argument: --order must be dfs, "
+									"bfs or hybrid, which %s is not\n",
+									optarg);
+					exit(1);
+				}
+				break;
+
+			case OPT_MAX_QUEUED:
+				a -> maxQueued = strToInt(optarg);
+				if (optarg[0] == '\0' || a -> maxQueued <= 0) {
+
+					fprintf(stderr, "Invalid argument: --max-queued must be "
+									"a positive integer, which %s is not\n",
+									optarg);
+					exit(1);
+				}
+				break;
+
+			case OPT_INODE_ORDER:
+				a -> inodeOrder = 1;
+				break;
+
+			case OPT_PRINT0:
+			case OPT_JSON:
+				if (a -> output != OUTPUT_LINES) {
+
+					fprintf(stderr, "Invalid argument: --print0 and --json "
+									"may only be given once, and not "
+									"together\n");
+					exit(1);
+				}
+				a -> output = opt == OPT_PRINT0 ? OUTPUT_PRINT0 : OUTPUT_JSON;
+				break;
+
+			case OPT_WHERE:
+				a -> where = optarg;
+				break;
+
 			default:
 				fprintf(stderr, "Invalid argument: %s\n", optarg);
 				exit(1);
@@ -76,18 +327,34 @@ void parseArgs (args *a, int argc, char *argv[]) {
 		}
 	}
 
-	/* Reading through the rest of argv to get starting directories + target */
+	/* Reading through the rest of argv to get starting directories + target,
+	unless the targets were given as options								*/
+	if (a -> buildIndex != NULL && (a -> index != NULL || a -> nrTargets > 0)) {
+
+		fprintf(stderr, "Invalid argument: --build-index and --watch take no "
+						"target, and cannot be combined with --index\n");
+		exit(1);
+	} else if (a -> where != NULL &&
+			   (a -> buildIndex != NULL || a -> index != NULL)) {
+
+		fprintf(stderr, "Invalid argument: --where cannot be combined with "
+						"--index, --build-index or --watch\n");
+		exit(1);
+	}
+	int targetsGiven = a -> nrTargets > 0 || a -> buildIndex != NULL ||
+					   a -> where != NULL;
 	a -> start = smalloc(sizeof(*a -> start) * argc);
 	a -> start[0] = NULL;
 	for (int i = optind; i < argc; i++) {
 
-		if (i == argc - 1) {
+		if (i == argc - 1 && !targetsGiven) {
 
-			int strLen = strlen(argv[i]);
-			a -> target = smalloc(sizeof(char) * (strLen + 1));
-			strcpy(a -> target, argv[i]);
-			a -> target[strLen] = '\0';
+			argsAddTarget(a, argv[i]);
+		} else if (a -> index != NULL) {
 
+			fprintf(stderr, "Invalid argument: %s - starting directories are "
+							"read from the index\n", argv[i]);
+			exit(1);
 		} else {
 
 			int strLen = strlen(argv[i]);
@@ -98,10 +365,28 @@ void parseArgs (args *a, int argc, char *argv[]) {
 		}
 	}
 
-	if (a -> nrStart < 1) {
+	/* With only an expression, every entry is a target that it may match,
+	by a pattern of the mode given (-g or -r), or a glob					*/
+	if (a -> nrTargets < 1 && a -> where != NULL) {
+
+		if (a -> matchMode == MATCH_REGEX) {
+
+			argsAddTarget(a, ".*");
+		} else {
+
+			argsAddTarget(a, "*");
+			a -> matchMode = MATCH_GLOB;
+		}
+	}
+
+	if (a -> nrStart < 1 && a -> index == NULL) {
 
 		fprintf(stderr, "No starting directory, cannot start search\n");
 		exit(1);
+	} else if (a -> nrTargets < 1 && a -> buildIndex == NULL) {
+
+		fprintf(stderr, "No target, cannot start search\n");
+		exit(1);
 	}
 }
 
@@ -113,9 +398,35 @@ void argsInit (args *a) {
 
 	a -> type = '\0';
 	a -> nrthr = 0;
-	a -> target = NULL;
+	a -> autoThreads = 0;
+	a -> targets = NULL;
+	a -> nrTargets = 0;
 	a -> start = NULL;
 	a -> nrStart = 0;
+	a -> fdBudget = -1;
+	a -> dirBufSize = DIRREADER_DEFAULT_SIZE;
+	a -> ioDepth = 0;
+	a -> matchMode = MATCH_LITERAL;
+	a -> buildIndex = NULL;
+	a -> index = NULL;
+	a -> watch = 0;
+	a -> rescan = WATCH_DEFAULT_RESCAN;
+	a -> maxResults = 0;
+	a -> report = REPORT_PATHS;
+	a -> minDepth = 0;
+	a -> maxDepth = -1;
+	a -> xdev = 0;
+	a -> pseudoFs = 0;
+	a -> excludes = NULL;
+	a -> nrExcludes = 0;
+	a -> stats = 0;
+	a -> statsFile = NULL;
+	a -> order = SCHEDULER_HYBRID;
+	a -> maxQueued = 0;
+	a -> inodeOrder = 0;
+	a -> followLinks = 0;
+	a -> output = OUTPUT_LINES;
+	a -> where = NULL;
 }
 
 /*
@@ -127,7 +438,14 @@ void argsKill (args *a) {
 
 	if (a != NULL) {
 
-		sfree(a -> target);
+		if (a -> targets != NULL) {
+
+			for (int i = 0; i < a -> nrTargets; i++) {
+
+				sfree(a -> targets[i]);
+			}
+			sfree(a -> targets);
+		}
 
 		if (a -> start != NULL) {
 
@@ -137,9 +455,77 @@ void argsKill (args *a) {
 			}
 			sfree(a -> start);
 		}
+		sfree(a -> excludes);				/* Its paths are in argv		*/
 	}
 }
 
+/*
+* description: Adds a target to an args struct. The name is copied.
+* param[in]: a - Pointer to the args struct.
+* param[in]: target - Name or pattern of the target.
+*/
+void argsAddTarget (args *a, char *target) {
+
+	a -> targets = srealloc(a -> targets,
+							sizeof(*a -> targets) * (a -> nrTargets + 1));
+	int strLen = strlen(target);
+	a -> targets[a -> nrTargets] = smalloc(sizeof(char) * (strLen + 1));
+	memcpy(a -> targets[a -> nrTargets], target, strLen + 1);
+	a -> nrTargets++;
+}
+
+/*
+* description: Adds all targets in a file to an args struct, one per line.
+* Empty lines are skipped.
+* param[in]: a - Pointer to the args struct.
+* param[in]: file - Path of the file, or - for stdin.
+*/
+void argsReadTargets (args *a, char *file) {
+
+	FILE *f = strcmp(file, "-") == 0 ? stdin : fopen(file, "r");
+	if (f == NULL) {
+
+		fprintf(stderr, "Cannot read targets from %s: %s\n", file,
+				strerror(errno));
+		exit(1);
+	}
+	char *line = NULL;
+	size_t lineSize = 0;
+	ssize_t len;
+	while ((len = getline(&line, &lineSize, f)) != -1) {
+
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+
+			line[--len] = '\0';
+		}
+		if (len > 0) {
+
+			argsAddTarget(a, line);
+		}
+	}
+	sfree(line);
+	if (f != stdin) {
+
+		fclose(f);
+	}
+}
+
+/*
+* description: Gets the default most threads of -p auto - AUTO_THREADS_PER_CPU
+* per online CPU, but at most AUTO_MAX_THREADS.
+* return: The number of threads.
+*/
+int getDefaultAutoThreads (void) {
+
+	long nrCpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nrCpus < 1) {
+
+		nrCpus = 1;
+	}
+	return nrCpus * AUTO_THREADS_PER_CPU < AUTO_MAX_THREADS ?
+		   nrCpus * AUTO_THREADS_PER_CPU : AUTO_MAX_THREADS;
+}
+
 /*
 * description: Converts a string of ascii characthers into an integer.
 * param[in]: str - The sring.
@@ -160,3 +546,37 @@ int strToInt (char *str) {
 	}
 	return sum;
 }
+
+/*
+* description: Converts a string of ascii characthers into a size in bytes.
+* The string may end with k or m (case insensitive) for KiB or MiB.
+* param[in]: str - The sring.
+* return: The converted size, or 0 if the string is not a valid size.
+*/
+size_t strToSize (char *str) {
+
+	size_t sum = 0;
+	int i = 0;
+	for (; str[i] >= '0' && str[i] <= '9'; i++) {
+
+		sum = sum * 10 + str[i] - '0';
+		if (sum > (1UL << 30)) {
+
+			return 0;
+		}
+	}
+	if (str[i] == 'k' || str[i] == 'K') {
+
+		sum *= 1024;
+		i++;
+	} else if (str[i] == 'm' || str[i] == 'M') {
+
+		sum *= 1024 * 1024;
+		i++;
+	}
+	if (i == 0 || str[i] != '\0') {
+
+		return 0;
+	}
+	return sum;
+}
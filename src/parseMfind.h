@@ -14,15 +14,85 @@
 typedef struct args {
 
 	char type;
-	char *target;
+	char **targets;
+	int nrTargets;
 	char **start;
 	int nrthr;
+	int autoThreads;
 	int nrStart;
+	int fdBudget;
+	size_t dirBufSize;
+	int ioDepth;
+	int matchMode;
+	char *buildIndex;
+	char *index;
+	int watch;
+	int rescan;
+	int maxResults;
+	int report;
+	int minDepth;
+	int maxDepth;
+	int xdev;
+	int pseudoFs;
+	char **excludes;
+	int nrExcludes;
+	int stats;
+	char *statsFile;
+	int order;
+	int maxQueued;
+	int inodeOrder;
+	int followLinks;
+	int output;
+	char *where;
 } args;
 
+/* Values returned by getopt_long for options without a short flag			*/
+#define OPT_FD_BUDGET 256
+#define OPT_DIR_BUFFER 257
+#define OPT_IO_URING 258
+#define OPT_BUILD_INDEX 259
+#define OPT_INDEX 260
+#define OPT_WATCH 261
+#define OPT_RESCAN 262
+#define OPT_MAX_RESULTS 263
+#define OPT_FIRST 264
+#define OPT_COUNT 265
+#define OPT_EXISTS 266
+#define OPT_MIN_DEPTH 267
+#define OPT_MAX_DEPTH 268
+#define OPT_EXCLUDE 269
+#define OPT_PSEUDO_FS 270
+#define OPT_STATS 271
+#define OPT_ORDER 272
+#define OPT_MAX_QUEUED 273
+#define OPT_INODE_ORDER 274
+#define OPT_PRINT0 275
+#define OPT_JSON 276
+#define OPT_WHERE 277
+
+/* What is reported for the matches: each path, their number, or only if
+there is one (by the exit status)											*/
+#define REPORT_PATHS 0
+#define REPORT_COUNT 1
+#define REPORT_EXISTS 2
+
+/* How found paths are written: one per line, each ended by a NUL, or as one
+JSON object per line, with the metadata of the entry						*/
+#define OUTPUT_LINES 0
+#define OUTPUT_PRINT0 1
+#define OUTPUT_JSON 2
+
+/* Most threads of -p auto, unless given as -p auto:n - this many per online
+CPU, as threads mostly wait on the disk, but never more than the maximum	*/
+#define AUTO_THREADS_PER_CPU 4
+#define AUTO_MAX_THREADS 64
+
 /*
-* description: Main parser for arguments. Uses getopt to parse flags. Rest of
-* the arguments are read as starting positions or the target.
+* description: Main parser for arguments. Uses getopt_long to parse flags.
+* Rest of the arguments are read as starting positions, and the last as the
+* target, unless targets were given with -e or -T, or there is a --where
+* expression. When building an index, there is no target, and when querying
+* one, there are no starting positions.
 * param[in]: a - Pointer to args struct. Arguments will be stored here.
 * param[in]: argc - Number of arguments.
 * param[in]: argv - The arguments.
@@ -42,6 +112,28 @@ void argsInit (args *a);
 */
 void argsKill (args *a);
 
+/*
+* description: Adds a target to an args struct. The name is copied.
+* param[in]: a - Pointer to the args struct.
+* param[in]: target - Name or pattern of the target.
+*/
+void argsAddTarget (args *a, char *target);
+
+/*
+* description: Adds all targets in a file to an args struct, one per line.
+* Empty lines are skipped.
+* param[in]: a - Pointer to the args struct.
+* param[in]: file - Path of the file, or - for stdin.
+*/
+void argsReadTargets (args *a, char *file);
+
+/*
+* description: Gets the default most threads of -p auto - AUTO_THREADS_PER_CPU
+* per online CPU, but at most AUTO_MAX_THREADS.
+* return: The number of threads.
+*/
+int getDefaultAutoThreads (void);
+
 /*
 * description: Converts a string of ascii characthers into an integer.
 * param[in]: str - The sring.
@@ -49,4 +141,12 @@ void argsKill (args *a);
 */
 int strToInt (char *str);
 
+/*
+* description: Converts a string of ascii characthers into a size in bytes.
+* The string may end with k or m (case insensitive) for KiB or MiB.
+* param[in]: str - The sring.
+* return: The converted size, or 0 if the string is not a valid size.
+*/
+size_t strToSize (char *str);
+
 #endif	//__PARSER__
@@ -0,0 +1,296 @@
+/*
+* Set of directories that a search does not enter - paths excluded with
+* --exclude, and the mount points of pseudo filesystems (proc, sysfs and the
+* like) read from /proc/self/mountinfo. Paths are absolute and resolved, and
+* are kept in a hash set by their last component, so that a directory's full
+* path is only built when its name is that of an excluded one.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pathFilter.h"
+#include "saferMemHandler.h"
+
+/* Filesystems without files worth searching for							*/
+static const char *pseudoTypes[] = {
+	"proc", "sysfs", "devpts", "cgroup", "cgroup2", "securityfs", "debugfs",
+	"tracefs", "pstore", "bpf", "configfs", "fusectl", "mqueue",
+	"binfmt_misc", "efivarfs", "autofs", "rpc_pipefs", "nsfs", "selinuxfs",
+	"hugetlbfs", NULL
+};
+
+/* Paths with equal last components are chained through next, from the
+first one in table															*/
+struct pathFilter {
+
+	int nrPaths;
+	int capacity;
+	char **paths;
+	int *names;						/* Offset of each last component		*/
+	int *next;
+	int *table;
+	unsigned int tableMask;
+};
+
+/*
+* description: Gets the FNV-1a hash of a string.
+* param[in]: str - The string.
+* return: The hash.
+*/
+static unsigned int hashName (const char *str) {
+
+	unsigned int h = 2166136261u;
+	for (const unsigned char *p = (const unsigned char *)str; *p != '\0'; p++) {
+
+		h = (h ^ *p) * 16777619u;
+	}
+	return h;
+}
+
+/*
+* description: Rebuilds the hash table, large enough for all paths.
+* param[in]: f - The filter.
+*/
+static void pathFilterRehash (pathFilter *f) {
+
+	unsigned int size = 16;
+	while (size < (unsigned int)f -> nrPaths * 2) {
+
+		size *= 2;
+	}
+	f -> tableMask = size - 1;
+	f -> table = srealloc(f -> table, sizeof(*f -> table) * size);
+	for (unsigned int i = 0; i < size; i++) {
+
+		f -> table[i] = -1;
+	}
+	for (int i = 0; i < f -> nrPaths; i++) {
+
+		unsigned int h = hashName(&f -> paths[i][f -> names[i]]) &
+						 f -> tableMask;
+		f -> next[i] = f -> table[h];
+		f -> table[h] = i;
+	}
+}
+
+/*
+* description: Adds a resolved path to the filter, unless it is already in it.
+* param[in]: f - The filter.
+* param[in]: path - The path (copied).
+*/
+static void pathFilterInsert (pathFilter *f, const char *path) {
+
+	if (pathFilterMatch(f, path)) {
+
+		return;
+	}
+	if (f -> nrPaths == f -> capacity) {
+
+		f -> capacity = f -> capacity > 0 ? f -> capacity * 2 : 16;
+		f -> paths = srealloc(f -> paths, sizeof(*f -> paths) * f -> capacity);
+		f -> names = srealloc(f -> names, sizeof(*f -> names) * f -> capacity);
+		f -> next = srealloc(f -> next, sizeof(*f -> next) * f -> capacity);
+	}
+	int len = strlen(path);
+	f -> paths[f -> nrPaths] = smalloc(len + 1);
+	memcpy(f -> paths[f -> nrPaths], path, len + 1);
+	const char *name = strrchr(path, '/');
+	f -> names[f -> nrPaths] = name != NULL ? name - path + 1 : 0;
+	f -> nrPaths++;
+	pathFilterRehash(f);
+}
+
+/*
+* description: Decodes the octal escapes (\040 for a space) of a path in
+* /proc/self/mountinfo, in place.
+* param[in]: path - The path.
+*/
+static void pathFilterUnescape (char *path) {
+
+	char *out = path;
+	for (char *p = path; *p != '\0'; p++) {
+
+		if (p[0] == '\\' && p[1] >= '0' && p[1] <= '3' && p[2] >= '0' &&
+			p[2] <= '7' && p[3] >= '0' && p[3] <= '7') {
+
+			*out++ = (p[1] - '0') * 64 + (p[2] - '0') * 8 + (p[3] - '0');
+			p += 3;
+		} else {
+
+			*out++ = *p;
+		}
+	}
+	*out = '\0';
+}
+
+/*
+* description: Checks if a filesystem type is a pseudo filesystem.
+* param[in]: type - The type, as in /proc/self/mountinfo.
+* return: If it is; 1, else 0.
+*/
+static int pathFilterIsPseudo (const char *type) {
+
+	for (int i = 0; pseudoTypes[i] != NULL; i++) {
+
+		if (strcmp(pseudoTypes[i], type) == 0) {
+
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+* description: Creates and allocates memory for an empty filter.
+* return: The filter.
+*/
+pathFilter *pathFilterNew (void) {
+
+	pathFilter *f = scalloc(1, sizeof(*f));
+	pathFilterRehash(f);
+	return f;
+}
+
+/*
+* description: Excludes a directory. The path is resolved with realpath().
+* param[in]: f - The filter.
+* param[in]: path - Path of the directory.
+* return: If the directory exists; 1, else 0 (a message is printed to stderr).
+*/
+int pathFilterAdd (pathFilter *f, const char *path) {
+
+	char *real = realpath(path, NULL);
+	if (real == NULL) {
+
+		perror(path);
+		return 0;
+	}
+	pathFilterInsert(f, real);
+	free(real);
+	return 1;
+}
+
+/*
+* description: Excludes the mount point of every pseudo filesystem. Each line
+* of mountinfo holds the mount point as its fifth field, and the filesystem
+* type right after a lone "-".
+* param[in]: f - The filter.
+* return: Number of mount points excluded.
+*/
+int pathFilterAddPseudoMounts (pathFilter *f) {
+
+	FILE *fp = fopen(PATHFILTER_MOUNTINFO, "r");
+	if (fp == NULL) {
+
+		return 0;
+	}
+	int nrMounts = 0;
+	char *line = NULL;
+	size_t size = 0;
+	while (getline(&line, &size, fp) > 0) {
+
+		char *save = NULL;
+		char *mountPoint = NULL;
+		char *field = strtok_r(line, " \n", &save);
+		for (int i = 0; field != NULL; i++) {
+
+			if (i == 4) {
+
+				mountPoint = field;
+			} else if (strcmp(field, "-") == 0) {
+
+				char *type = strtok_r(NULL, " \n", &save);
+				if (mountPoint != NULL && type != NULL &&
+					pathFilterIsPseudo(type)) {
+
+					pathFilterUnescape(mountPoint);
+					pathFilterInsert(f, mountPoint);
+					nrMounts++;
+				}
+				break;
+			}
+			field = strtok_r(NULL, " \n", &save);
+		}
+	}
+	free(line);
+	fclose(fp);
+	return nrMounts;
+}
+
+/*
+* description: Gets the number of directories excluded.
+* param[in]: f - The filter.
+* return: The number of directories.
+*/
+int pathFilterSize (pathFilter *f) {
+
+	return f -> nrPaths;
+}
+
+/*
+* description: Checks if a directory might be excluded, by its name alone.
+* param[in]: f - The filter.
+* param[in]: name - Entry name of the directory.
+* return: If any excluded directory has the name; 1, else 0.
+*/
+int pathFilterMayMatch (pathFilter *f, const char *name) {
+
+	unsigned int h = hashName(name) & f -> tableMask;
+	for (int i = f -> table[h]; i != -1; i = f -> next[i]) {
+
+		if (strcmp(&f -> paths[i][f -> names[i]], name) == 0) {
+
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+* description: Checks if a directory is excluded.
+* param[in]: f - The filter.
+* param[in]: path - Absolute, resolved path of the directory.
+* return: If it is excluded; 1, else 0.
+*/
+int pathFilterMatch (pathFilter *f, const char *path) {
+
+	const char *name = strrchr(path, '/');
+	name = name != NULL ? name + 1 : path;
+	unsigned int h = hashName(name) & f -> tableMask;
+	for (int i = f -> table[h]; i != -1; i = f -> next[i]) {
+
+		if (strcmp(f -> paths[i], path) == 0) {
+
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+* description: Frees all memory allocated by the filter, including the filter.
+* param[in]: f - The filter.
+*/
+void pathFilterKill (pathFilter *f) {
+
+	if (f != NULL) {
+
+		for (int i = 0; i < f -> nrPaths; i++) {
+
+			sfree(f -> paths[i]);
+		}
+		sfree(f -> paths);
+		sfree(f -> names);
+		sfree(f -> next);
+		sfree(f -> table);
+		sfree(f);
+	}
+}
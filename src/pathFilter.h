@@ -0,0 +1,70 @@
+/*
+* Set of directories that a search does not enter - paths excluded with
+* --exclude, and the mount points of pseudo filesystems (proc, sysfs and the
+* like) read from /proc/self/mountinfo. Paths are absolute and resolved, and
+* are kept in a hash set by their last component, so that a directory's full
+* path is only built when its name is that of an excluded one.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#ifndef __PATHFILTER__
+#define __PATHFILTER__
+
+#define PATHFILTER_MOUNTINFO "/proc/self/mountinfo"
+
+typedef struct pathFilter pathFilter;
+
+/*
+* description: Creates and allocates memory for an empty filter.
+* return: The filter.
+*/
+pathFilter *pathFilterNew (void);
+
+/*
+* description: Excludes a directory. The path is resolved with realpath().
+* param[in]: f - The filter.
+* param[in]: path - Path of the directory.
+* return: If the directory exists; 1, else 0 (a message is printed to stderr).
+*/
+int pathFilterAdd (pathFilter *f, const char *path);
+
+/*
+* description: Excludes the mount point of every pseudo filesystem.
+* param[in]: f - The filter.
+* return: Number of mount points excluded.
+*/
+int pathFilterAddPseudoMounts (pathFilter *f);
+
+/*
+* description: Gets the number of directories excluded.
+* param[in]: f - The filter.
+* return: The number of directories.
+*/
+int pathFilterSize (pathFilter *f);
+
+/*
+* description: Checks if a directory might be excluded, by its name alone.
+* param[in]: f - The filter.
+* param[in]: name - Entry name of the directory.
+* return: If any excluded directory has the name; 1, else 0.
+*/
+int pathFilterMayMatch (pathFilter *f, const char *name);
+
+/*
+* description: Checks if a directory is excluded.
+* param[in]: f - The filter.
+* param[in]: path - Absolute, resolved path of the directory.
+* return: If it is excluded; 1, else 0.
+*/
+int pathFilterMatch (pathFilter *f, const char *path);
+
+/*
+* description: Frees all memory allocated by the filter, including the filter.
+* param[in]: f - The filter.
+*/
+void pathFilterKill (pathFilter *f);
+
+#endif //__PATHFILTER__
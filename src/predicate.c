@@ -0,0 +1,701 @@
+/*
+* Compiled find-style predicate expressions (--where). See predicate.h.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <pwd.h>
+#include <grp.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "predicate.h"
+#include "matcher.h"
+#include "saferMemHandler.h"
+
+/* Node kinds. AND, OR and NOT combine other nodes, the rest are tests		*/
+#define NODE_AND 0
+#define NODE_OR 1
+#define NODE_NOT 2
+#define NODE_NAME 3
+#define NODE_TYPE 4
+#define NODE_SIZE 5
+#define NODE_AGE 6
+#define NODE_PERM 7
+#define NODE_USER 8
+#define NODE_GROUP 9
+
+/* How a test compares - less, more or exactly (+n, -n, n), or for -perm all
+(-mode), any (/mode) or exactly the bits									*/
+#define CMP_LESS 0
+#define CMP_EQUAL 1
+#define CMP_MORE 2
+#define CMP_ALL 3
+#define CMP_ANY 4
+
+/* A node. left and right are the indexes of the nodes it combines (only left
+for NOT). A test compares value to the entry's size or age rounded up or down
+to unit (bytes or seconds), or to its mode, uid or gid. needsStat is set if
+the node's result may depend on the entry's metadata						*/
+typedef struct predicateNode {
+
+	int kind;
+	int cmp;
+	int left;
+	int right;
+	int needsStat;
+	long long value;
+	long long unit;
+	matcher *m;
+} predicateNode;
+
+struct predicate {
+
+	predicateNode *nodes;
+	int nrNodes;
+	int root;
+	unsigned int statMask;
+	long long now;
+};
+
+/* Parser state. err is set on the first error, at the token at errAt		*/
+typedef struct parser {
+
+	char **tokens;
+	int nrTokens;
+	int pos;
+	predicate *p;
+	const char *err;
+	const char *errAt;
+} parser;
+
+/*
+* description: Splits an expression into tokens at whitespace. Quotes (' or ")
+* are removed, and keep what they enclose in one token.
+* param[in]: src - The expression.
+* param[out]: buf - Filled with the tokens, each ended by a NUL. Must have
+* room for strlen(src) + 1 bytes.
+* param[out]: tokens - Filled with pointers to the tokens in buf. Must have
+* room for strlen(src) + 1 pointers.
+* return: Number of tokens, or -1 if a quote is not closed.
+*/
+static int tokenize (const char *src, char *buf, char **tokens) {
+
+	int nrTokens = 0;
+	const char *s = src;
+	char *dst = buf;
+	while (*s != '\0') {
+
+		if (isspace((unsigned char)*s)) {
+
+			s++;
+			continue;
+		}
+		tokens[nrTokens++] = dst;
+		while (*s != '\0' && !isspace((unsigned char)*s)) {
+
+			if (*s == '\'' || *s == '"') {
+
+				char quote = *s++;
+				while (*s != '\0' && *s != quote) {
+
+					*dst++ = *s++;
+				}
+				if (*s == '\0') {
+
+					return -1;
+				}
+				s++;
+			} else {
+
+				*dst++ = *s++;
+			}
+		}
+		*dst++ = '\0';
+	}
+	return nrTokens;
+}
+
+/*
+* description: Adds a node to the expression being compiled.
+* param[in]: ps - The parser.
+* param[in]: kind - Kind of the node.
+* return: Index of the node, or -1 if there are too many (err is set).
+*/
+static int nodeAdd (parser *ps, int kind) {
+
+	predicate *p = ps -> p;
+	if (p -> nrNodes == PREDICATE_MAX_NODES) {
+
+		ps -> err = "too many tests";
+		return -1;
+	}
+	predicateNode *n = &p -> nodes[p -> nrNodes];
+	memset(n, 0, sizeof(*n));
+	n -> kind = kind;
+	n -> left = -1;
+	n -> right = -1;
+	return p -> nrNodes++;
+}
+
+/*
+* description: Adds a node combining two others with AND or OR. The one that
+* does not need the entry's metadata is put first, so that it is evaluated
+* first.
+* param[in]: ps - The parser.
+* param[in]: kind - NODE_AND or NODE_OR.
+* param[in]: left - The first node.
+* param[in]: right - The second node.
+* return: Index of the node, or -1 on error.
+*/
+static int nodeCombine (parser *ps, int kind, int left, int right) {
+
+	int i = nodeAdd(ps, kind);
+	if (i < 0) {
+
+		return -1;
+	}
+	predicateNode *nodes = ps -> p -> nodes;
+	if (nodes[left].needsStat && !nodes[right].needsStat) {
+
+		int tmp = left;
+		left = right;
+		right = tmp;
+	}
+	nodes[i].left = left;
+	nodes[i].right = right;
+	nodes[i].needsStat = nodes[left].needsStat || nodes[right].needsStat;
+	return i;
+}
+
+/*
+* description: Gets the next token, without consuming it.
+* param[in]: ps - The parser.
+* return: The token, or NULL at the end of the expression.
+*/
+static const char *peek (parser *ps) {
+
+	return ps -> pos < ps -> nrTokens ? ps -> tokens[ps -> pos] : NULL;
+}
+
+/*
+* description: Parses a number as +n, -n or n.
+* param[in]: s - The number.
+* param[out]: cmp - CMP_MORE, CMP_LESS or CMP_EQUAL.
+* param[out]: value - n.
+* return: Where the digits end, or NULL if there are none.
+*/
+static const char *parseNumber (const char *s, int *cmp, long long *value) {
+
+	*cmp = *s == '+' ? CMP_MORE : *s == '-' ? CMP_LESS : CMP_EQUAL;
+	if (*cmp != CMP_EQUAL) {
+
+		s++;
+	}
+	if (!isdigit((unsigned char)*s)) {
+
+		return NULL;
+	}
+	*value = 0;
+	while (isdigit((unsigned char)*s) && *value < (1LL << 50)) {
+
+		*value = *value * 10 + *s++ - '0';
+	}
+	return s;
+}
+
+/*
+* description: Parses the argument of -size: [+-]n followed by a unit - c
+* (bytes), w (2 bytes), b (512 bytes, the default), k, M or G.
+* param[in]: ps - The parser.
+* param[in]: n - The node.
+* param[in]: arg - The argument.
+* return: If it is valid; 1, else 0 (err is set).
+*/
+static int parseSize (parser *ps, predicateNode *n, const char *arg) {
+
+	const char *unit = parseNumber(arg, &n -> cmp, &n -> value);
+	if (unit == NULL || (unit[0] != '\0' && unit[1] != '\0')) {
+
+		ps -> err = "size must be [+-]n[cwbkMG]";
+		return 0;
+	}
+	switch (unit[0]) {
+
+		case 'c':
+			n -> unit = 1;
+			break;
+
+		case 'w':
+			n -> unit = 2;
+			break;
+
+		case '\0':
+		case 'b':
+			n -> unit = 512;
+			break;
+
+		case 'k':
+			n -> unit = 1024;
+			break;
+
+		case 'M':
+			n -> unit = 1024 * 1024;
+			break;
+
+		case 'G':
+			n -> unit = 1024 * 1024 * 1024;
+			break;
+
+		default:
+			ps -> err = "size must be [+-]n[cwbkMG]";
+			return 0;
+	}
+	return 1;
+}
+
+/*
+* description: Parses the argument of -perm: an octal mode, preceded by - if
+* all its bits must be set, or / if any of them must be.
+* param[in]: ps - The parser.
+* param[in]: n - The node.
+* param[in]: arg - The argument.
+* return: If it is valid; 1, else 0 (err is set).
+*/
+static int parsePerm (parser *ps, predicateNode *n, const char *arg) {
+
+	n -> cmp = *arg == '-' ? CMP_ALL : *arg == '/' ? CMP_ANY : CMP_EQUAL;
+	if (n -> cmp != CMP_EQUAL) {
+
+		arg++;
+	}
+	char *end;
+	n -> value = strtol(arg, &end, 8);
+	if (!isdigit((unsigned char)*arg) || *end != '\0' || n -> value > 07777) {
+
+		ps -> err = "mode must be octal, as [-/]mode";
+		return 0;
+	}
+	return 1;
+}
+
+/*
+* description: Parses the argument of -user or -group: a name, or a number.
+* param[in]: ps - The parser.
+* param[in]: n - The node.
+* param[in]: arg - The argument.
+* return: If it is valid; 1, else 0 (err is set).
+*/
+static int parseOwner (parser *ps, predicateNode *n, const char *arg) {
+
+	char *end;
+	n -> value = strtol(arg, &end, 10);
+	if (isdigit((unsigned char)*arg) && *end == '\0') {
+
+		return 1;
+	}
+	if (n -> kind == NODE_USER) {
+
+		struct passwd *pw = getpwnam(arg);
+		if (pw != NULL) {
+
+			n -> value = pw -> pw_uid;
+			return 1;
+		}
+		ps -> err = "no such user";
+	} else {
+
+		struct group *gr = getgrnam(arg);
+		if (gr != NULL) {
+
+			n -> value = gr -> gr_gid;
+			return 1;
+		}
+		ps -> err = "no such group";
+	}
+	return 0;
+}
+
+/*
+* description: Parses a test and its argument.
+* param[in]: ps - The parser.
+* return: Index of its node, or -1 on error.
+*/
+static int parseTest (parser *ps) {
+
+	const char *test = ps -> tokens[ps -> pos++];
+	const char *arg = peek(ps);
+	int kind = strcmp(test, "-name") == 0 ? NODE_NAME :
+			   strcmp(test, "-type") == 0 ? NODE_TYPE :
+			   strcmp(test, "-size") == 0 ? NODE_SIZE :
+			   strcmp(test, "-mtime") == 0 ||
+			   strcmp(test, "-mmin") == 0 ? NODE_AGE :
+			   strcmp(test, "-perm") == 0 ? NODE_PERM :
+			   strcmp(test, "-user") == 0 ? NODE_USER :
+			   strcmp(test, "-group") == 0 ? NODE_GROUP : -1;
+	ps -> errAt = test;
+	if (kind < 0) {
+
+		ps -> err = "unknown test";
+		return -1;
+	} else if (arg == NULL) {
+
+		ps -> err = "missing argument";
+		return -1;
+	}
+	ps -> pos++;
+	int i = nodeAdd(ps, kind);
+	if (i < 0) {
+
+		return -1;
+	}
+	predicateNode *n = &ps -> p -> nodes[i];
+	const char *end;
+	int valid = 1;
+	switch (kind) {
+
+		case NODE_NAME:
+			n -> m = matcherCompile(arg, MATCH_GLOB);
+			valid = n -> m != NULL;
+			ps -> err = "invalid pattern";
+			break;
+
+		case NODE_TYPE:
+			n -> value = arg[0];
+			valid = (arg[0] == 'd' || arg[0] == 'f' || arg[0] == 'l') &&
+					arg[1] == '\0';
+			ps -> err = "type must be d, f or l";
+			break;
+
+		case NODE_SIZE:
+			valid = parseSize(ps, n, arg);
+			ps -> p -> statMask |= STATX_SIZE;
+			break;
+
+		case NODE_AGE:
+			n -> unit = test[2] == 't' ? 24 * 60 * 60 : 60;
+			end = parseNumber(arg, &n -> cmp, &n -> value);
+			valid = end != NULL && *end == '\0';
+			ps -> err = "time must be [+-]n";
+			ps -> p -> statMask |= STATX_MTIME;
+			break;
+
+		case NODE_PERM:
+			valid = parsePerm(ps, n, arg);
+			ps -> p -> statMask |= STATX_MODE;
+			break;
+
+		case NODE_USER:
+			valid = parseOwner(ps, n, arg);
+			ps -> p -> statMask |= STATX_UID;
+			break;
+
+		case NODE_GROUP:
+			valid = parseOwner(ps, n, arg);
+			ps -> p -> statMask |= STATX_GID;
+			break;
+
+		default:
+			break;
+	}
+	n -> needsStat = kind != NODE_NAME && kind != NODE_TYPE;
+	if (!valid) {
+
+		return -1;
+	}
+	ps -> err = NULL;
+	ps -> errAt = NULL;
+	return i;
+}
+
+static int parseOr (parser *ps);
+
+/*
+* description: Parses a test, a negation (! or -not) or a group in ( ).
+* param[in]: ps - The parser.
+* return: Index of its node, or -1 on error.
+*/
+static int parseNot (parser *ps) {
+
+	const char *token = peek(ps);
+	if (token == NULL) {
+
+		ps -> err = "expression ends too early";
+		return -1;
+	}
+	if (strcmp(token, "!") == 0 || strcmp(token, "-not") == 0) {
+
+		ps -> pos++;
+		int child = parseNot(ps);
+		int i = child < 0 ? -1 : nodeAdd(ps, NODE_NOT);
+		if (i >= 0) {
+
+			ps -> p -> nodes[i].left = child;
+			ps -> p -> nodes[i].needsStat = ps -> p -> nodes[child].needsStat;
+		}
+		return i;
+	} else if (strcmp(token, "(") == 0) {
+
+		ps -> pos++;
+		int i = parseOr(ps);
+		if (i >= 0 && (peek(ps) == NULL || strcmp(peek(ps), ")") != 0)) {
+
+			ps -> err = "missing )";
+			ps -> errAt = token;
+			return -1;
+		}
+		ps -> pos++;
+		return i;
+	}
+	return parseTest(ps);
+}
+
+/*
+* description: Parses tests joined by -a or -and, or by nothing.
+* param[in]: ps - The parser.
+* return: Index of its node, or -1 on error.
+*/
+static int parseAnd (parser *ps) {
+
+	int left = parseNot(ps);
+	const char *token;
+	while (left >= 0 && (token = peek(ps)) != NULL &&
+		   strcmp(token, "-o") != 0 && strcmp(token, "-or") != 0 &&
+		   strcmp(token, ")") != 0) {
+
+		if (strcmp(token, "-a") == 0 || strcmp(token, "-and") == 0) {
+
+			ps -> pos++;
+		}
+		int right = parseNot(ps);
+		left = right < 0 ? -1 : nodeCombine(ps, NODE_AND, left, right);
+	}
+	return left;
+}
+
+/*
+* description: Parses tests joined by -o or -or.
+* param[in]: ps - The parser.
+* return: Index of its node, or -1 on error.
+*/
+static int parseOr (parser *ps) {
+
+	int left = parseAnd(ps);
+	const char *token;
+	while (left >= 0 && (token = peek(ps)) != NULL &&
+		   (strcmp(token, "-o") == 0 || strcmp(token, "-or") == 0)) {
+
+		ps -> pos++;
+		int right = parseAnd(ps);
+		left = right < 0 ? -1 : nodeCombine(ps, NODE_OR, left, right);
+	}
+	return left;
+}
+
+/*
+* description: Compiles an expression. If it is invalid, a message is printed
+* to stderr. The times of -mtime and -mmin are counted from when it is
+* compiled.
+* param[in]: src - The expression.
+* return: The compiled expression, or NULL if it is invalid.
+*/
+predicate *predicateCompile (const char *src) {
+
+	size_t len = strlen(src);
+	char *buf = smalloc(len + 1);
+	char **tokens = smalloc(sizeof(*tokens) * (len + 1));
+	predicate *p = smalloc(sizeof(*p));
+	p -> nodes = smalloc(sizeof(*p -> nodes) * PREDICATE_MAX_NODES);
+	p -> nrNodes = 0;
+	p -> statMask = 0;
+	p -> now = time(NULL);
+
+	parser ps = {tokens, tokenize(src, buf, tokens), 0, p, NULL, NULL};
+	p -> root = -1;
+	if (ps.nrTokens < 0) {
+
+		ps.err = "a quote is not closed";
+	} else if (ps.nrTokens == 0) {
+
+		ps.err = "it is empty";
+	} else {
+
+		p -> root = parseOr(&ps);
+		if (p -> root >= 0 && ps.pos < ps.nrTokens) {
+
+			ps.err = "unexpected token";
+			ps.errAt = ps.tokens[ps.pos];
+		}
+	}
+	if (ps.err != NULL) {
+
+		if (ps.errAt != NULL) {
+
+			fprintf(stderr, "Invalid expression %s: %s at %s\n", src, ps.err,
+					ps.errAt);
+		} else {
+
+			fprintf(stderr, "Invalid expression %s: %s\n", src, ps.err);
+		}
+		predicateKill(p);
+		p = NULL;
+	}
+	sfree(tokens);
+	sfree(buf);
+	return p;
+}
+
+/*
+* description: Gets the statx fields the tests of an expression need.
+* param[in]: p - The expression.
+* return: The statx mask, 0 if only names and types are tested.
+*/
+unsigned int predicateStatMask (const predicate *p) {
+
+	return p -> statMask;
+}
+
+/*
+* description: Divides, rounding down, also if a is negative.
+* param[in]: a - The dividend.
+* param[in]: b - The divisor, positive.
+* return: The quotient.
+*/
+static long long floorDiv (long long a, long long b) {
+
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+/*
+* description: Compares a value to what a test asks for.
+* param[in]: n - The test.
+* param[in]: value - The value.
+* return: If it passes; 1, else 0.
+*/
+static int testCompare (const predicateNode *n, long long value) {
+
+	return n -> cmp == CMP_LESS ? value < n -> value :
+		   n -> cmp == CMP_MORE ? value > n -> value : value == n -> value;
+}
+
+/*
+* description: Evaluates a node for an entry, with Kleene's three valued
+* logic - a test that needs metadata is unknown without it, and AND and OR
+* are only unknown if the known operands do not decide them.
+* param[in]: p - The expression.
+* param[in]: i - Index of the node.
+* param[in]: name - Name of the entry.
+* param[in]: type - Type of the entry.
+* param[in]: stx - Metadata of the entry, or NULL.
+* return: PREDICATE_TRUE, PREDICATE_FALSE or PREDICATE_UNKNOWN.
+*/
+static int evalNode (const predicate *p, int i, const char *name, char type,
+					 const struct statx *stx) {
+
+	const predicateNode *n = &p -> nodes[i];
+	if (n -> needsStat && stx == NULL && n -> kind > NODE_NOT) {
+
+		return PREDICATE_UNKNOWN;
+	}
+	int res;
+	int other;
+	switch (n -> kind) {
+
+		case NODE_AND:
+			res = evalNode(p, n -> left, name, type, stx);
+			if (res == PREDICATE_FALSE) {
+
+				return res;
+			}
+			other = evalNode(p, n -> right, name, type, stx);
+			return other != PREDICATE_TRUE ? other : res;
+
+		case NODE_OR:
+			res = evalNode(p, n -> left, name, type, stx);
+			if (res == PREDICATE_TRUE) {
+
+				return res;
+			}
+			other = evalNode(p, n -> right, name, type, stx);
+			return other != PREDICATE_FALSE ? other : res;
+
+		case NODE_NOT:
+			res = evalNode(p, n -> left, name, type, stx);
+			return res == PREDICATE_UNKNOWN ? res : !res;
+
+		case NODE_NAME:
+			return matcherMatch(n -> m, name);
+
+		case NODE_TYPE:
+			return type == n -> value;
+
+		case NODE_SIZE:
+			return testCompare(n, ((long long)stx -> stx_size + n -> unit - 1) /
+								  n -> unit);
+
+		case NODE_AGE:
+			return testCompare(n, floorDiv(p -> now - stx -> stx_mtime.tv_sec,
+										   n -> unit));
+
+		case NODE_PERM: {
+			long long mode = stx -> stx_mode & 07777;
+			return n -> cmp == CMP_ALL ? (mode & n -> value) == n -> value :
+				   n -> cmp == CMP_ANY ? n -> value == 0 ||
+										 (mode & n -> value) != 0 :
+				   mode == n -> value;
+		}
+
+		case NODE_USER:
+			return stx -> stx_uid == n -> value;
+
+		case NODE_GROUP:
+			return stx -> stx_gid == n -> value;
+
+		default:
+			return PREDICATE_FALSE;
+	}
+}
+
+/*
+* description: Evaluates an expression for an entry.
+* param[in]: p - The expression.
+* param[in]: name - Name of the entry.
+* param[in]: type - Type of the entry ('d', 'f', 'l' or 'o').
+* param[in]: stx - Metadata of the entry, with the fields of
+* predicateStatMask(), or NULL if it has not been stat'ed.
+* return: PREDICATE_TRUE or PREDICATE_FALSE, or PREDICATE_UNKNOWN if stx is
+* NULL and the result depends on it.
+*/
+int predicateEval (const predicate *p, const char *name, char type,
+				   const struct statx *stx) {
+
+	return evalNode(p, p -> root, name, type, stx);
+}
+
+/*
+* description: Frees all memory allocated by an expression, including the
+* expression.
+* param[in]: p - The expression.
+*/
+void predicateKill (predicate *p) {
+
+	if (p == NULL) {
+
+		return;
+	}
+	for (int i = 0; i < p -> nrNodes; i++) {
+
+		matcherKill(p -> nodes[i].m);
+	}
+	sfree(p -> nodes);
+	sfree(p);
+}
@@ -0,0 +1,73 @@
+/*
+* Compiled find-style predicate expressions (--where). An expression such as
+* "-name *.log -a ( -size +10M -o -mtime -7 )" is compiled once into a flat
+* array of nodes, which is read only, so it can be shared by all threads.
+*
+* Tests: -name glob, -type d|f|l, -size [+-]n[cwbkMG], -mtime [+-]n,
+* -mmin [+-]n, -perm [-/]mode (octal), -user name|uid and -group name|gid,
+* with the meaning they have in find. +n is more than n, -n less than n and n
+* exactly n. Tests are combined with ( ), ! or -not, -a or -and (or just one
+* test after another), and -o or -or. Tokens are separated by whitespace, and
+* may be quoted with ' or ".
+*
+* An entry is first evaluated without its metadata, and the tests that need
+* it are then unknown. Only if that leaves the result unknown does the entry
+* need to be stat'ed, so names and types are tested before anything is
+* stat'ed. Operands of -a and -o are put in that order when compiling.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#ifndef __PREDICATE__
+#define __PREDICATE__
+
+/* Results of predicateEval()												*/
+#define PREDICATE_FALSE 0
+#define PREDICATE_TRUE 1
+#define PREDICATE_UNKNOWN 2
+
+/* Most nodes an expression may compile to									*/
+#define PREDICATE_MAX_NODES 1024
+
+struct statx;
+typedef struct predicate predicate;
+
+/*
+* description: Compiles an expression. If it is invalid, a message is printed
+* to stderr. The times of -mtime and -mmin are counted from when it is
+* compiled.
+* param[in]: src - The expression.
+* return: The compiled expression, or NULL if it is invalid.
+*/
+predicate *predicateCompile (const char *src);
+
+/*
+* description: Gets the statx fields the tests of an expression need.
+* param[in]: p - The expression.
+* return: The statx mask, 0 if only names and types are tested.
+*/
+unsigned int predicateStatMask (const predicate *p);
+
+/*
+* description: Evaluates an expression for an entry.
+* param[in]: p - The expression.
+* param[in]: name - Name of the entry.
+* param[in]: type - Type of the entry ('d', 'f', 'l' or 'o').
+* param[in]: stx - Metadata of the entry, with the fields of
+* predicateStatMask(), or NULL if it has not been stat'ed.
+* return: PREDICATE_TRUE or PREDICATE_FALSE, or PREDICATE_UNKNOWN if stx is
+* NULL and the result depends on it.
+*/
+int predicateEval (const predicate *p, const char *name, char type,
+				   const struct statx *stx);
+
+/*
+* description: Frees all memory allocated by an expression, including the
+* expression.
+* param[in]: p - The expression.
+*/
+void predicateKill (predicate *p);
+
+#endif //__PREDICATE__
@@ -1,7 +1,12 @@
 /*
-* A dynamic queue. Each element (node) in the list holds up to one
-* void pointer. The queue is FIFO - first element to be enqueued in the queue
-* will be the first to dequeue.
+* A work-stealing scheduler. Each worker owns a double ended queue (deque)
+* which it pushes to at the bottom. By default it also pops from the bottom,
+* so that it goes depth-first and its deque holds no more than depth times
+* fan-out elements, and a worker whose deque is empty steals from the top of
+* another worker's deque, taking the oldest and largest piece of work
+* (SCHEDULER_HYBRID). SCHEDULER_DFS also steals from the bottom, and
+* SCHEDULER_BFS also pops from the top. Each deque is guarded by its own
+* mutex, so workers only contend when they steal.
 *
 * Author: Buster Hultgren Wärn <dv17bhn@cs.umu.se>
 *
@@ -11,130 +16,240 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include "queue.h"
 #include "saferMemHandler.h"
 
-struct node {
+/* Deque as a growing ring buffer. top is stolen from, bottom is owned		*/
+struct deque {
 
-	void *value;
-	node *next;
+	pthread_mutex_t mtx;
+	void **values;
+	int capacity;
+	int top;
+	int bottom;
+	atomic_int size;
 };
 
-struct queue {
+struct scheduler {
 
-	int size;
-	node *first;
-	node *last;
+	int nrDeques;
+	int order;
+	deque *deques;
+	schedulerStats *stats;
+	atomic_int size;
 };
 
+#define DEQUE_INIT_CAPACITY 64
+
 /*
-* description: Creates and allocates memory for an empty queue.
-* return: The queue.
+* description: Doubles the capacity of a deque. Deque must be locked.
+* param[in]: d - The deque.
 */
-queue *queueEmpty (void) {
+static void dequeGrow (deque *d) {
+
+	void **values = smalloc(sizeof(*values) * d -> capacity * 2);
+	int size = atomic_load(&d -> size);
+	for (int i = 0; i < size; i++) {
 
-	queue *q = smalloc(sizeof(*q));
-	q -> first = NULL;
-	q -> last = NULL;
-	q -> size = 0;
-	return q;
+		values[i] = d -> values[(d -> top + i) % d -> capacity];
+	}
+	sfree(d -> values);
+	d -> values = values;
+	d -> top = 0;
+	d -> bottom = size;
+	d -> capacity *= 2;
+}
+
+/*
+* description: Creates and allocates memory for a scheduler with one empty
+* deque per worker.
+* param[in]: nrWorkers - Number of workers (deques). Must be positive.
+* param[in]: order - Order elements are popped in (SCHEDULER_HYBRID,
+* SCHEDULER_DFS or SCHEDULER_BFS).
+* return: The scheduler.
+*/
+scheduler *schedulerNew (int nrWorkers, int order) {
+
+	scheduler *s = smalloc(sizeof(*s));
+	s -> nrDeques = nrWorkers;
+	s -> order = order;
+	s -> deques = smalloc(sizeof(*s -> deques) * nrWorkers);
+	s -> stats = scallocAligned(64, nrWorkers, sizeof(*s -> stats));
+	atomic_init(&s -> size, 0);
+	for (int i = 0; i < nrWorkers; i++) {
+
+		deque *d = &s -> deques[i];
+		pthread_mutex_init(&d -> mtx, NULL);
+		d -> capacity = DEQUE_INIT_CAPACITY;
+		d -> values = smalloc(sizeof(*d -> values) * d -> capacity);
+		d -> top = 0;
+		d -> bottom = 0;
+		atomic_init(&d -> size, 0);
+	}
+	return s;
 }
 
 /*
-* description: Checks if queue contains any elements.
-* param[in]: q - The queue.
-* return: If true; 1, else 0.
+* description: Checks if any deque in the scheduler contains elements. Does not
+* lock any deque.
+* param[in]: s - The scheduler.
+* return: If all deques are empty; 1, else 0.
 */
-int queueIsEmpty (queue *q) {
+int schedulerIsEmpty (scheduler *s) {
 
-	return q -> size == 0;
+	return atomic_load(&s -> size) == 0;
 }
 
 /*
-* description: Gets the number of elements in quue.
-* param[in]: q - The queue.
-* return: The number of elements in the queue.
+* description: Gets the total number of elements in all deques.
+* param[in]: s - The scheduler.
+* return: The number of elements in the scheduler.
 */
-int queueGetSize (queue *q) {
+int schedulerGetSize (scheduler *s) {
 
-	return q -> size;
+	return atomic_load(&s -> size);
 }
 
 /*
-* description: Gets the value of the first element in the queue.
-* param[in]: q - The queue.
-* return: Void pointer to the value in the queue.
+* description: Locks a deque. Only if the lock is taken already, the time
+* spent waiting for it is measured, and counted to the worker locking.
+* param[in]: s - The scheduler.
+* param[in]: d - The deque.
+* param[in]: worker - Index of the worker locking.
 */
-void *queueFront (queue *q) {
+static void dequeLock (scheduler *s, deque *d, int worker) {
 
-	if (q -> first != NULL) {
+	if (pthread_mutex_trylock(&d -> mtx) == 0) {
 
-		return q -> first -> value;
+		return;
 	}
-	return NULL;
+	struct timespec begin, end;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	pthread_mutex_lock(&d -> mtx);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	s -> stats[worker].lockWaits++;
+	s -> stats[worker].lockWaitNs += (end.tv_sec - begin.tv_sec) * 1000000000L +
+									 end.tv_nsec - begin.tv_nsec;
 }
 
 /*
-* description: Adds an element to the last place in the queue.
-* param[in]: q - The queue.
+* description: Adds an element to the bottom of a worker's own deque.
+* param[in]: s - The scheduler.
+* param[in]: worker - Index of the worker that owns the deque.
 * param[in]: value - Void pointer to the value the element will hold.
 */
-void queueEnqueue (queue *q, void *value) {
-
-	if (q -> first == NULL) {
+void schedulerPush (scheduler *s, int worker, void *value) {
 
-		q -> first = smalloc(sizeof(node));
-		q -> first -> next = NULL;
-		q -> last = q -> first;
-	} else {
+	deque *d = &s -> deques[worker];
+	dequeLock(s, d, worker);
+	if (atomic_load(&d -> size) == d -> capacity) {
 
-		q -> last -> next = smalloc(sizeof(node));
-		q -> last = q -> last -> next;
-		q -> last -> next = NULL;
+		dequeGrow(d);
+	}
+	d -> values[d -> bottom] = value;
+	d -> bottom = (d -> bottom + 1) % d -> capacity;
+	int size = atomic_fetch_add(&d -> size, 1) + 1;
+	atomic_fetch_add(&s -> size, 1);
+	pthread_mutex_unlock(&d -> mtx);
+	if (size > s -> stats[worker].maxSize) {
+
+		s -> stats[worker].maxSize = size;
 	}
-
-	q -> last -> value = value;
-	q -> size++;
 }
 
 /*
-* description: Removes the first element in the queue, letting the next element
-* become the first. Will NOT free any memory.
-* param[in]: q - The queue.
+* description: Removes the element at the bottom (own end) or top (steal end)
+* of a deque.
+* param[in]: s - The scheduler.
+* param[in]: d - The deque.
+* param[in]: fromTop - If 1, take from the top, else from the bottom.
+* param[in]: worker - Index of the worker taking.
+* return: Void pointer to the value, or NULL if deque was empty.
 */
-void queueDequeue (queue *q) {
+static void *dequeTake (scheduler *s, deque *d, int fromTop, int worker) {
 
-	if (q -> first != NULL) {
+	void *value = NULL;
+	if (atomic_load(&d -> size) == 0) {
 
-		if (q -> size == 1) {
+		return NULL;
+	}
+	dequeLock(s, d, worker);
+	if (atomic_load(&d -> size) > 0) {
+
+		if (fromTop) {
 
-			sfree(q -> first);
-			q -> first = NULL;
-			q -> last = NULL;
+			value = d -> values[d -> top];
+			d -> top = (d -> top + 1) % d -> capacity;
 		} else {
 
-			node *tempNode = q -> first -> next;
+			d -> bottom = (d -> bottom - 1 + d -> capacity) % d -> capacity;
+			value = d -> values[d -> bottom];
+		}
+		atomic_fetch_sub(&d -> size, 1);
+		atomic_fetch_sub(&s -> size, 1);
+	}
+	pthread_mutex_unlock(&d -> mtx);
+	return value;
+}
+
+/*
+* description: Removes and gets the element at the bottom of a worker's own
+* deque (the top with SCHEDULER_BFS). If that deque is empty, an element will
+* be stolen from the top of another worker's deque (the bottom with
+* SCHEDULER_DFS). Will NOT free any memory.
+* param[in]: s - The scheduler.
+* param[in]: worker - Index of the worker popping.
+* return: Void pointer to the value, or NULL if all deques were empty.
+*/
+void *schedulerPop (scheduler *s, int worker) {
+
+	void *value = dequeTake(s, &s -> deques[worker],
+							s -> order == SCHEDULER_BFS, worker);
+	for (int i = 1; i < s -> nrDeques && value == NULL; i++) {
+
+		if (atomic_load(&s -> size) == 0) {
 
-			sfree(q -> first);
-			q -> first = tempNode;
+			break;
+		}
+		value = dequeTake(s, &s -> deques[(worker + i) % s -> nrDeques],
+						  s -> order != SCHEDULER_DFS, worker);
+		if (value != NULL) {
+
+			s -> stats[worker].steals++;
 		}
-		q -> size--;
 	}
+	return value;
+}
+
+/*
+* description: Gets the lock and steal statistics of a worker. Must not be
+* called while the worker is pushing or popping.
+* param[in]: s - The scheduler.
+* param[in]: worker - Index of the worker.
+* return: The statistics. Points into the scheduler.
+*/
+const schedulerStats *schedulerGetStats (scheduler *s, int worker) {
+
+	return &s -> stats[worker];
 }
 
 /*
-* description: Frees all memory allocated by the queue, inluding the queue. The
-* value will NOT be free'd.
-* param[in]: q - The queue
+* description: Frees all memory allocated by the scheduler, including the
+* scheduler. The values will NOT be free'd.
+* param[in]: s - The scheduler.
 */
-void queueKill (queue *q) {
+void schedulerKill (scheduler *s) {
 
-	while (q -> first != NULL) {
+	for (int i = 0; i < s -> nrDeques; i++) {
 
-		node *pos = q -> first -> next;
-		q -> first = q -> first -> next;
-		sfree(pos);
+		pthread_mutex_destroy(&s -> deques[i].mtx);
+		sfree(s -> deques[i].values);
 	}
-	sfree(q);
+	sfree(s -> deques);
+	sfree(s -> stats);
+	sfree(s);
 }
@@ -1,7 +1,12 @@
 /*
-* A dynamic queue. Each element (node) in the list holds up to one
-* void pointer. The queue is FIFO - first element to be enqueued in the queue
-* will be the first to dequeue.
+* A work-stealing scheduler. Each worker owns a double ended queue (deque)
+* which it pushes to at the bottom. By default it also pops from the bottom,
+* so that it goes depth-first and its deque holds no more than depth times
+* fan-out elements, and a worker whose deque is empty steals from the top of
+* another worker's deque, taking the oldest and largest piece of work
+* (SCHEDULER_HYBRID). SCHEDULER_DFS also steals from the bottom, and
+* SCHEDULER_BFS also pops from the top. Each deque is guarded by its own
+* mutex, so workers only contend when they steal.
 *
 * Author: Buster Hultgren Wärn <dv17bhn@cs.umu.se>
 *
@@ -11,57 +16,86 @@
 #ifndef __QUEUE__
 #define __QUEUE__
 
-typedef struct node node;
+typedef struct deque deque;
 
-typedef struct queue queue;
+typedef struct scheduler scheduler;
 
-/*
-* description: Creates and allocates memory for an empty queue.
-* return: The queue.
-*/
-queue *queueEmpty (void);
+/* Orders of the scheduler (see above)										*/
+#define SCHEDULER_HYBRID 0
+#define SCHEDULER_DFS 1
+#define SCHEDULER_BFS 2
+
+/* Statistics of one worker - the times it waited for a deque's lock, and
+for how long, the elements it stole, and the most elements its own deque
+held. Each on its own cache line (the array is allocated aligned to one), as
+it is written by the worker only											*/
+typedef struct schedulerStats {
+
+	long lockWaits;
+	long lockWaitNs;
+	long steals;
+	long maxSize;
+	char pad[64 - 4 * sizeof(long)];
+} schedulerStats;
 
 /*
-* description: Checks if queue contains any elements.
-* param[in]: q - The queue.
-* return: If true; 1, else 0.
+* description: Creates and allocates memory for a scheduler with one empty
+* deque per worker.
+* param[in]: nrWorkers - Number of workers (deques). Must be positive.
+* param[in]: order - Order elements are popped in (SCHEDULER_HYBRID,
+* SCHEDULER_DFS or SCHEDULER_BFS).
+* return: The scheduler.
 */
-int queueIsEmpty (queue *q);
+scheduler *schedulerNew (int nrWorkers, int order);
 
 /*
-* description: Gets the number of elements in quue.
-* param[in]: q - The queue.
-* return: The number of elements in the queue.
+* description: Checks if any deque in the scheduler contains elements. Does not
+* lock any deque.
+* param[in]: s - The scheduler.
+* return: If all deques are empty; 1, else 0.
 */
-int queueGetSize (queue *q);
+int schedulerIsEmpty (scheduler *s);
 
 /*
-* description: Gets the value of the first element in the queue.
-* param[in]: q - The queue.
-* return: Void pointer to the value in the queue.
+* description: Gets the total number of elements in all deques.
+* param[in]: s - The scheduler.
+* return: The number of elements in the scheduler.
 */
-void *queueFront (queue *q);
+int schedulerGetSize (scheduler *s);
 
 /*
-* description: Adds an element to the last place in the queue.
-* param[in]: q - The queue.
+* description: Adds an element to the bottom of a worker's own deque.
+* param[in]: s - The scheduler.
+* param[in]: worker - Index of the worker that owns the deque.
 * param[in]: value - Void pointer to the value the element will hold.
 */
-void queueEnqueue (queue *q, void *value);
+void schedulerPush (scheduler *s, int worker, void *value);
 
 /*
-* description: Removes the first element in the queue, letting the next element
-* become the first. Will NOT free any memory.
-* param[in]: q - The queue.
+* description: Removes and gets the element at the bottom of a worker's own
+* deque (the top with SCHEDULER_BFS). If that deque is empty, an element will
+* be stolen from the top of another worker's deque (the bottom with
+* SCHEDULER_DFS). Will NOT free any memory.
+* param[in]: s - The scheduler.
+* param[in]: worker - Index of the worker popping.
+* return: Void pointer to the value, or NULL if all deques were empty.
 */
-void queueDequeue (queue *q);
+void *schedulerPop (scheduler *s, int worker);
 
 /*
-* description: Frees all memory allocated by the queue, inluding the queue. The
-* value will NOT be free'd.
-* param[in]: q - The queue
+* description: Gets the lock and steal statistics of a worker. Must not be
+* called while the worker is pushing or popping.
+* param[in]: s - The scheduler.
+* param[in]: worker - Index of the worker.
+* return: The statistics. Points into the scheduler.
 */
-void queueKill (queue *q);
+const schedulerStats *schedulerGetStats (scheduler *s, int worker);
 
+/*
+* description: Frees all memory allocated by the scheduler, including the
+* scheduler. The values will NOT be free'd.
+* param[in]: s - The scheduler.
+*/
+void schedulerKill (scheduler *s);
 
 #endif //__QUEUE__
@@ -6,6 +6,11 @@
 * On a free, will check that memory is not pointing to NULL, so that a double
 * free can occur.
 *
+* Also contains a thread-local arena for small, short lived allocations.
+* Each thread carves its allocations out of its own chunk, with no locking.
+* A block may be free'd by any thread. A chunk is recycled in bulk once all of
+* its blocks are free'd and its thread has moved on to a new chunk.
+*
 * Author: Buster Hultgren Wärn <dv17bhn@cs.umu.se>
 *
 * Final build: 2018-10-26
@@ -14,6 +19,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "saferMemHandler.h"
 
@@ -67,6 +76,29 @@ void *srealloc (void *ptr, size_t size) {
 	return mem;
 }
 
+/*
+* description: Allocates zeroed memory aligned to a boundary, such as a cache
+* line. Free'd with sfree().
+* param[in]: alignment - The boundary, a power of two and a multiple of
+* sizeof(void *).
+* param[in]: nmeb - Number of elements to be allocated.
+* param[in]: size - The size of each element.
+* return: Void pointer to the allocated memory.
+*/
+void *scallocAligned (size_t alignment, size_t nmeb, size_t size) {
+
+	void *mem = NULL;
+	int err = posix_memalign(&mem, alignment, nmeb * size);
+	if (err != 0) {
+
+		errno = err;
+		perror("Posix_memalign");
+		exit errno;
+	}
+	memset(mem, 0, nmeb * size);
+	return mem;
+}
+
 /*
 * description: Free's a memory block after checking if it leads to NULL.
 * param[in]: meme - The block of memory.
@@ -78,3 +110,170 @@ void sfree (void *mem) {
 		free(mem);
 	}
 }
+
+/* Chunks are aligned to their size, so a block's chunk is found by masking.
+live is decremented by each free. When the owning thread lets go of the chunk
+it adds allocs, so live reaches 0 exactly when the last block is free'd.	*/
+typedef struct arenaChunk {
+
+	atomic_long live;
+	long allocs;
+	size_t used;
+	struct arenaChunk *next;
+} arenaChunk;
+
+#define ARENA_HEADER_SIZE ((sizeof(arenaChunk) + 15) & ~(size_t)15)
+#define ARENA_MAX_POOLED 64
+
+/* Recycled chunks, shared by all threads									*/
+static pthread_mutex_t arenaPoolMtx = PTHREAD_MUTEX_INITIALIZER;
+static arenaChunk *arenaPool = NULL;
+static int arenaPoolSize = 0;
+
+/* The calling thread's current chunk and scratch buffer					*/
+static _Thread_local arenaChunk *arenaCurrent = NULL;
+static _Thread_local void *arenaScratchBuf = NULL;
+static _Thread_local size_t arenaScratchSize = 0;
+
+/*
+* description: Recycles a chunk whose blocks are all free'd. Keeps up to
+* ARENA_MAX_POOLED chunks for reuse, else frees it.
+* param[in]: c - The chunk.
+*/
+static void arenaRecycle (arenaChunk *c) {
+
+	pthread_mutex_lock(&arenaPoolMtx);
+	if (arenaPoolSize < ARENA_MAX_POOLED) {
+
+		c -> next = arenaPool;
+		arenaPool = c;
+		arenaPoolSize++;
+		c = NULL;
+	}
+	pthread_mutex_unlock(&arenaPoolMtx);
+	sfree(c);
+}
+
+/*
+* description: Lets go of the calling thread's current chunk. If all its
+* blocks are already free'd, it is recycled.
+*/
+static void arenaRetire (void) {
+
+	arenaChunk *c = arenaCurrent;
+	arenaCurrent = NULL;
+	if (c != NULL && atomic_fetch_add(&c -> live, c -> allocs) + c -> allocs
+		== 0) {
+
+		arenaRecycle(c);
+	}
+}
+
+/*
+* description: Allocates memory from the calling thread's arena. No lock is
+* taken, unless a new chunk is needed.
+* param[in]: size - The size of the memory in bytes. At most ARENA_MAX_SIZE.
+* return: Void pointer to the allocated memory, aligned to 16 bytes.
+*/
+void *arenaAlloc (size_t size) {
+
+	size = (size + 15) & ~(size_t)15;
+	if (size > ARENA_MAX_SIZE) {
+
+		fprintf(stderr, "arenaAlloc: %zu bytes is too large\n", size);
+		exit(1);
+	}
+	arenaChunk *c = arenaCurrent;
+	if (c == NULL || c -> used + size > ARENA_CHUNK_SIZE) {
+
+		arenaRetire();
+		pthread_mutex_lock(&arenaPoolMtx);
+		c = arenaPool;
+		if (c != NULL) {
+
+			arenaPool = c -> next;
+			arenaPoolSize--;
+		}
+		pthread_mutex_unlock(&arenaPoolMtx);
+		if (c == NULL) {
+
+			c = aligned_alloc(ARENA_CHUNK_SIZE, ARENA_CHUNK_SIZE);
+			if (c == NULL) {
+
+				perror("Aligned_alloc");
+				exit errno;
+			}
+		}
+		atomic_init(&c -> live, 0);
+		c -> allocs = 0;
+		c -> used = ARENA_HEADER_SIZE;
+		arenaCurrent = c;
+	}
+	void *mem = (char *)c + c -> used;
+	c -> used += size;
+	c -> allocs++;
+	return mem;
+}
+
+/*
+* description: Free's memory allocated by arenaAlloc(). May be called from any
+* thread. Will check that memory is not pointing to NULL.
+* param[in]: mem - The memory.
+*/
+void arenaFree (void *mem) {
+
+	if (mem != NULL) {
+
+		arenaChunk *c = (arenaChunk *)((uintptr_t)mem &
+									   ~(uintptr_t)(ARENA_CHUNK_SIZE - 1));
+		if (atomic_fetch_sub(&c -> live, 1) == 1) {
+
+			arenaRecycle(c);
+		}
+	}
+}
+
+/*
+* description: Gets the calling thread's scratch buffer, grown to hold at least
+* size bytes. The buffer is valid until the next call from the same thread.
+* param[in]: size - The size needed in bytes.
+* return: Pointer to the buffer.
+*/
+void *arenaScratch (size_t size) {
+
+	if (size > arenaScratchSize) {
+
+		arenaScratchSize = size < 4096 ? 4096 : size * 2;
+		arenaScratchBuf = srealloc(arenaScratchBuf, arenaScratchSize);
+	}
+	return arenaScratchBuf;
+}
+
+/*
+* description: Lets go of the calling thread's current chunk and scratch
+* buffer. Must be called by every thread that used the arena before it exits.
+*/
+void arenaThreadExit (void) {
+
+	arenaRetire();
+	sfree(arenaScratchBuf);
+	arenaScratchBuf = NULL;
+	arenaScratchSize = 0;
+}
+
+/*
+* description: Frees all recycled chunks. Should be called when no thread uses
+* the arena anymore.
+*/
+void arenaKill (void) {
+
+	pthread_mutex_lock(&arenaPoolMtx);
+	while (arenaPool != NULL) {
+
+		arenaChunk *c = arenaPool;
+		arenaPool = c -> next;
+		sfree(c);
+	}
+	arenaPoolSize = 0;
+	pthread_mutex_unlock(&arenaPoolMtx);
+}
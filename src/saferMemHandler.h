@@ -6,6 +6,11 @@
 * On a free, will check that memory is not pointing to NULL, so that a double
 * free can occur.
 *
+* Also contains a thread-local arena for small, short lived allocations.
+* Each thread carves its allocations out of its own chunk, with no locking.
+* A block may be free'd by any thread. A chunk is recycled in bulk once all of
+* its blocks are free'd and its thread has moved on to a new chunk.
+*
 * Author: Buster Hultgren Wärn <dv17bhn@cs.umu.se>
 *
 * Final build: 2018-10-26
@@ -37,10 +42,60 @@ void *scalloc (size_t nmeb, size_t size);
 */
 void *srealloc (void *ptr, size_t size);
 
+/*
+* description: Allocates zeroed memory aligned to a boundary, such as a cache
+* line. Free'd with sfree().
+* param[in]: alignment - The boundary, a power of two and a multiple of
+* sizeof(void *).
+* param[in]: nmeb - Number of elements to be allocated.
+* param[in]: size - The size of each element.
+* return: Void pointer to the allocated memory.
+*/
+void *scallocAligned (size_t alignment, size_t nmeb, size_t size);
+
 /*
 * description: Free's a memory block after checking if it leads to NULL.
 * param[in]: meme - The block of memory.
 */
 void sfree (void *mem);
 
+/* Size of an arena chunk, and the largest block that can be allocated 	*/
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_MAX_SIZE 1024
+
+/*
+* description: Allocates memory from the calling thread's arena. No lock is
+* taken, unless a new chunk is needed.
+* param[in]: size - The size of the memory in bytes. At most ARENA_MAX_SIZE.
+* return: Void pointer to the allocated memory, aligned to 16 bytes.
+*/
+void *arenaAlloc (size_t size);
+
+/*
+* description: Free's memory allocated by arenaAlloc(). May be called from any
+* thread. Will check that memory is not pointing to NULL.
+* param[in]: mem - The memory.
+*/
+void arenaFree (void *mem);
+
+/*
+* description: Gets the calling thread's scratch buffer, grown to hold at least
+* size bytes. The buffer is valid until the next call from the same thread.
+* param[in]: size - The size needed in bytes.
+* return: Pointer to the buffer.
+*/
+void *arenaScratch (size_t size);
+
+/*
+* description: Lets go of the calling thread's current chunk and scratch
+* buffer. Must be called by every thread that used the arena before it exits.
+*/
+void arenaThreadExit (void);
+
+/*
+* description: Frees all recycled chunks. Should be called when no thread uses
+* the arena anymore.
+*/
+void arenaKill (void);
+
 #endif //__SAFERMEMHANDLER__
@@ -0,0 +1,210 @@
+/*
+* Statistics of a search. Each thread counts what it does in its own
+* trdStats, which are plain counters on their own cache line, so counting
+* costs no more than an increment. They are summed once the threads have been
+* joined, and written as JSON along with the wall and CPU time of each phase
+* of the run, and the thread levels chosen by -p auto (see --stats).
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "stats.h"
+
+/*
+* description: Reads a clock.
+* param[in]: clock - The clock, e.g. CLOCK_MONOTONIC.
+* return: Its time in nanoseconds.
+*/
+int64_t statsClock (clockid_t clock) {
+
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+* description: Starts the first phase of a run.
+* param[in]: r - The run.
+*/
+void statsRunStart (statsRun *r) {
+
+	r -> nrPhases = 0;
+	r -> nrLevels = 0;
+	r -> wallStart = statsClock(CLOCK_MONOTONIC);
+	r -> start = r -> wallStart;
+	r -> cpuStart = statsClock(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+/*
+* description: Ends the current phase of a run, and starts the next.
+* param[in]: r - The run.
+* param[in]: name - Name of the phase that ended (not copied).
+*/
+void statsRunPhase (statsRun *r, const char *name) {
+
+	int64_t wall = statsClock(CLOCK_MONOTONIC);
+	int64_t cpu = statsClock(CLOCK_PROCESS_CPUTIME_ID);
+	if (r -> nrPhases < STATS_MAX_PHASES) {
+
+		statsPhase *p = &r -> phases[r -> nrPhases++];
+		p -> name = name;
+		p -> wallNs = wall - r -> wallStart;
+		p -> cpuNs = cpu - r -> cpuStart;
+	}
+	r -> wallStart = wall;
+	r -> cpuStart = cpu;
+}
+
+/*
+* description: Records a number of threads chosen during a run. Only the
+* first STATS_MAX_LEVELS are kept.
+* param[in]: r - The run.
+* param[in]: threads - The number of threads.
+* param[in]: dirsPerSec - Directories read per second before the choice.
+* param[in]: latencyNs - Mean time to read a directory before the choice.
+*/
+void statsRunLevel (statsRun *r, int threads, double dirsPerSec,
+					double latencyNs) {
+
+	if (r -> nrLevels < STATS_MAX_LEVELS) {
+
+		statsLevel *l = &r -> levels[r -> nrLevels++];
+		l -> atNs = statsClock(CLOCK_MONOTONIC) - r -> start;
+		l -> threads = threads;
+		l -> dirsPerSec = dirsPerSec;
+		l -> latencyNs = latencyNs;
+	}
+}
+
+/*
+* description: Adds the counters of one thread to a sum. maxQueue is the
+* largest of the two.
+* param[in]: sum - The sum.
+* param[in]: s - The thread's counters.
+*/
+void trdStatsAdd (trdStats *sum, const trdStats *s) {
+
+	sum -> dirsOpened += s -> dirsOpened;
+	sum -> entries += s -> entries;
+	sum -> statCalls += s -> statCalls;
+	sum -> errors += s -> errors;
+	sum -> matches += s -> matches;
+	sum -> parks += s -> parks;
+	sum -> parkNs += s -> parkNs;
+	sum -> fullWaits += s -> fullWaits;
+	sum -> fullWaitNs += s -> fullWaitNs;
+	sum -> slices += s -> slices;
+	sum -> revisits += s -> revisits;
+	sum -> lockWaits += s -> lockWaits;
+	sum -> lockWaitNs += s -> lockWaitNs;
+	sum -> steals += s -> steals;
+	if (s -> maxQueue > sum -> maxQueue) {
+
+		sum -> maxQueue = s -> maxQueue;
+	}
+	sum -> cpuNs += s -> cpuNs;
+}
+
+/*
+* description: Writes the counters of one thread as a JSON object.
+* param[in]: fp - The stream.
+* param[in]: s - The counters.
+* param[in]: indent - Indentation of the object's members.
+*/
+static void statsWriteCounters (FILE *fp, const trdStats *s,
+								const char *indent) {
+
+	fprintf(fp, "%s\"dirsOpened\": %ld,\n", indent, s -> dirsOpened);
+	fprintf(fp, "%s\"entries\": %ld,\n", indent, s -> entries);
+	fprintf(fp, "%s\"statCalls\": %ld,\n", indent, s -> statCalls);
+	fprintf(fp, "%s\"errors\": %ld,\n", indent, s -> errors);
+	fprintf(fp, "%s\"matches\": %ld,\n", indent, s -> matches);
+	fprintf(fp, "%s\"parks\": %ld,\n", indent, s -> parks);
+	fprintf(fp, "%s\"parkMs\": %.3f,\n", indent, s -> parkNs / 1e6);
+	fprintf(fp, "%s\"fullWaits\": %ld,\n", indent, s -> fullWaits);
+	fprintf(fp, "%s\"fullWaitMs\": %.3f,\n", indent,
+			s -> fullWaitNs / 1e6);
+	fprintf(fp, "%s\"lockWaits\": %ld,\n", indent, s -> lockWaits);
+	fprintf(fp, "%s\"lockWaitMs\": %.3f,\n", indent, s -> lockWaitNs / 1e6);
+	fprintf(fp, "%s\"steals\": %ld,\n", indent, s -> steals);
+	fprintf(fp, "%s\"slices\": %ld,\n", indent, s -> slices);
+	fprintf(fp, "%s\"revisits\": %ld,\n", indent, s -> revisits);
+	fprintf(fp, "%s\"maxQueue\": %ld,\n", indent, s -> maxQueue);
+	fprintf(fp, "%s\"cpuMs\": %.3f\n", indent, s -> cpuNs / 1e6);
+}
+
+/*
+* description: Writes the phases of a run and the counters of all threads as
+* JSON.
+* param[in]: file - Path of the file, or NULL for stderr.
+* param[in]: r - The run.
+* param[in]: threads - The counters of each thread.
+* param[in]: nrThreads - Number of threads.
+* return: If the file could be written; 1, else 0 (a message is printed to
+* stderr).
+*/
+int statsWriteJson (const char *file, statsRun *r, trdStats *threads,
+					int nrThreads) {
+
+	FILE *fp = file != NULL ? fopen(file, "w") : stderr;
+	if (fp == NULL) {
+
+		perror(file);
+		return 0;
+	}
+	trdStats total;
+	memset(&total, 0, sizeof(total));
+	for (int i = 0; i < nrThreads; i++) {
+
+		trdStatsAdd(&total, &threads[i]);
+	}
+
+	fprintf(fp, "{\n  \"threads\": %d,\n  \"phases\": [\n", nrThreads);
+	for (int i = 0; i < r -> nrPhases; i++) {
+
+		statsPhase *p = &r -> phases[i];
+		fprintf(fp, "    {\"name\": \"%s\", \"wallMs\": %.3f, "
+				"\"cpuMs\": %.3f}%s\n", p -> name, p -> wallNs / 1e6,
+				p -> cpuNs / 1e6, i + 1 < r -> nrPhases ? "," : "");
+	}
+	fprintf(fp, "  ],\n");
+	if (r -> nrLevels > 0) {
+
+		fprintf(fp, "  \"threadLevels\": [\n");
+		for (int i = 0; i < r -> nrLevels; i++) {
+
+			statsLevel *l = &r -> levels[i];
+			fprintf(fp, "    {\"atMs\": %.3f, \"threads\": %d, "
+					"\"dirsPerSec\": %.0f, \"latencyUs\": %.1f}%s\n",
+					l -> atNs / 1e6, l -> threads, l -> dirsPerSec,
+					l -> latencyNs / 1e3, i + 1 < r -> nrLevels ? "," : "");
+		}
+		fprintf(fp, "  ],\n");
+	}
+	fprintf(fp, "  \"total\": {\n");
+	statsWriteCounters(fp, &total, "    ");
+	fprintf(fp, "  },\n  \"perThread\": [\n");
+	for (int i = 0; i < nrThreads; i++) {
+
+		fprintf(fp, "    {\n      \"id\": %d,\n", i);
+		statsWriteCounters(fp, &threads[i], "      ");
+		fprintf(fp, "    }%s\n", i + 1 < nrThreads ? "," : "");
+	}
+	fprintf(fp, "  ]\n}\n");
+
+	int res = !ferror(fp);
+	if (file != NULL && fclose(fp) != 0) {
+
+		res = 0;
+	}
+	if (!res) {
+
+		perror(file != NULL ? file : "stats");
+	}
+	return res;
+}
@@ -0,0 +1,132 @@
+/*
+* Statistics of a search. Each thread counts what it does in its own
+* trdStats, which are plain counters on their own cache line, so counting
+* costs no more than an increment. They are summed once the threads have been
+* joined, and written as JSON along with the wall and CPU time of each phase
+* of the run, and the thread levels chosen by -p auto (see --stats).
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#ifndef __STATS__
+#define __STATS__
+
+#include <stdint.h>
+#include <time.h>
+
+#define STATS_MAX_PHASES 8
+#define STATS_MAX_LEVELS 64
+
+/* Counters of one thread. lockWaits and lockWaitNs count the times it had
+to wait for a deque's lock, and steals the directories it took from another
+thread's deque (see schedulerGetStats()). maxQueue is the most directories
+its own deque ever held, and fullWaits the times it waited to push one
+because --max-queued were queued. slices counts the slices of huge
+directories it searched, and revisits the directories it opened but did not
+read, as they had been read already (by -L, or overlapping starts)			*/
+typedef struct trdStats {
+
+	long dirsOpened;
+	long entries;
+	long statCalls;
+	long errors;
+	long matches;
+	long parks;
+	int64_t parkNs;
+	long fullWaits;
+	int64_t fullWaitNs;
+	long slices;
+	long revisits;
+	long lockWaits;
+	int64_t lockWaitNs;
+	long steals;
+	long maxQueue;
+	int64_t cpuNs;
+} __attribute__((aligned(64))) trdStats;
+
+/* Wall and CPU time of one phase of the run								*/
+typedef struct statsPhase {
+
+	const char *name;
+	int64_t wallNs;
+	int64_t cpuNs;
+} statsPhase;
+
+/* A number of threads chosen by -p auto, at atNs into the run. dirsPerSec
+and latencyNs were measured with the number before it						*/
+typedef struct statsLevel {
+
+	int64_t atNs;
+	int threads;
+	double dirsPerSec;
+	double latencyNs;
+} statsLevel;
+
+/* Phases of the run, each ended by statsRunPhase(), and the thread levels
+chosen during it															*/
+typedef struct statsRun {
+
+	int nrPhases;
+	statsPhase phases[STATS_MAX_PHASES];
+	int nrLevels;
+	statsLevel levels[STATS_MAX_LEVELS];
+	int64_t start;
+	int64_t wallStart;
+	int64_t cpuStart;
+} statsRun;
+
+/*
+* description: Reads a clock.
+* param[in]: clock - The clock, e.g. CLOCK_MONOTONIC.
+* return: Its time in nanoseconds.
+*/
+int64_t statsClock (clockid_t clock);
+
+/*
+* description: Starts the first phase of a run.
+* param[in]: r - The run.
+*/
+void statsRunStart (statsRun *r);
+
+/*
+* description: Ends the current phase of a run, and starts the next.
+* param[in]: r - The run.
+* param[in]: name - Name of the phase that ended (not copied).
+*/
+void statsRunPhase (statsRun *r, const char *name);
+
+/*
+* description: Records a number of threads chosen during a run. Only the
+* first STATS_MAX_LEVELS are kept.
+* param[in]: r - The run.
+* param[in]: threads - The number of threads.
+* param[in]: dirsPerSec - Directories read per second before the choice.
+* param[in]: latencyNs - Mean time to read a directory before the choice.
+*/
+void statsRunLevel (statsRun *r, int threads, double dirsPerSec,
+					double latencyNs);
+
+/*
+* description: Adds the counters of one thread to a sum. maxQueue is the
+* largest of the two.
+* param[in]: sum - The sum.
+* param[in]: s - The thread's counters.
+*/
+void trdStatsAdd (trdStats *sum, const trdStats *s);
+
+/*
+* description: Writes the phases of a run and the counters of all threads as
+* JSON.
+* param[in]: file - Path of the file, or NULL for stderr.
+* param[in]: r - The run.
+* param[in]: threads - The counters of each thread.
+* param[in]: nrThreads - Number of threads.
+* return: If the file could be written; 1, else 0 (a message is printed to
+* stderr).
+*/
+int statsWriteJson (const char *file, statsRun *r, trdStats *threads,
+					int nrThreads);
+
+#endif //__STATS__
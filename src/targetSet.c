@@ -0,0 +1,308 @@
+/*
+* Set of targets, matched against every entry in one pass. Literal names are
+* kept in a hash set, so an entry is looked up once, however many targets
+* there are. Globs and regexes are compiled into one combined DFA, or, if that
+* would be too large, into one DFA each.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "targetSet.h"
+#include "matcher.h"
+#include "saferMemHandler.h"
+
+/* Literal targets with equal keys are chained through next, in increasing
+order, from the first one in table. Patterns are matched by combined, or by
+each if they were too complex to combine.									*/
+struct targetSet {
+
+	int nrTargets;
+	int mode;
+	char **names;
+	char **keys;
+	int *table;
+	int *next;
+	unsigned int tableMask;
+	matcher *combined;
+	matcher **each;
+};
+
+/*
+* description: Gets the FNV-1a hash of a string.
+* param[in]: str - The string.
+* return: The hash.
+*/
+static unsigned int hashName (const char *str) {
+
+	unsigned int h = 2166136261u;
+	for (const unsigned char *p = (const unsigned char *)str; *p != '\0'; p++) {
+
+		h = (h ^ *p) * 16777619u;
+	}
+	return h;
+}
+
+/*
+* description: Gets the key of a literal target - its last path component,
+* without trailing slashes.
+* param[in]: name - The target's name.
+* return: The key (memory is allocated).
+*/
+static char *literalKey (const char *name) {
+
+	int end = strlen(name);
+	while (end > 1 && name[end - 1] == '/') {
+
+		end--;
+	}
+	int begin = end;
+	while (begin > 0 && name[begin - 1] != '/') {
+
+		begin--;
+	}
+	char *key = smalloc(end - begin + 1);
+	memcpy(key, &name[begin], end - begin);
+	key[end - begin] = '\0';
+	return key;
+}
+
+/*
+* description: Builds the hash set of literal targets.
+* param[in]: ts - The set, with names set.
+*/
+static void targetSetBuildTable (targetSet *ts) {
+
+	unsigned int size = 16;
+	while (size < (unsigned int)ts -> nrTargets * 2) {
+
+		size *= 2;
+	}
+	ts -> tableMask = size - 1;
+	ts -> table = smalloc(sizeof(*ts -> table) * size);
+	for (unsigned int i = 0; i < size; i++) {
+
+		ts -> table[i] = -1;
+	}
+	ts -> keys = smalloc(sizeof(*ts -> keys) * ts -> nrTargets);
+	ts -> next = smalloc(sizeof(*ts -> next) * ts -> nrTargets);
+
+	/* Inserted in reverse, so that each chain is in increasing order		*/
+	for (int i = ts -> nrTargets - 1; i >= 0; i--) {
+
+		ts -> keys[i] = literalKey(ts -> names[i]);
+		ts -> next[i] = -1;
+		unsigned int h = hashName(ts -> keys[i]) & ts -> tableMask;
+		while (ts -> table[h] != -1 &&
+			   strcmp(ts -> keys[ts -> table[h]], ts -> keys[i]) != 0) {
+
+			h = (h + 1) & ts -> tableMask;
+		}
+		if (ts -> table[h] != -1) {
+
+			ts -> next[i] = ts -> table[h];
+		}
+		ts -> table[h] = i;
+	}
+}
+
+/*
+* description: Compiles the pattern targets, combined if possible, else one
+* at a time if they were only too complex together.
+* param[in]: ts - The set, with names and mode set.
+* return: If all patterns are valid; 1, else 0.
+*/
+static int targetSetCompile (targetSet *ts) {
+
+	int complex;
+	ts -> combined = matcherCompileSet(ts -> names, ts -> nrTargets,
+									   ts -> mode, &complex);
+	if (ts -> combined != NULL) {
+
+		return 1;
+	} else if (!complex) {
+
+		return 0;
+	}
+	ts -> each = scalloc(ts -> nrTargets, sizeof(*ts -> each));
+	for (int i = 0; i < ts -> nrTargets; i++) {
+
+		ts -> each[i] = matcherCompile(ts -> names[i], ts -> mode);
+		if (ts -> each[i] == NULL) {
+
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+* description: Creates a set of targets. The names are copied, and a name
+* given more than once is only kept once. A literal target is matched by its
+* last path component, like objectCmp() does.
+* param[in]: targets - The targets' names or patterns.
+* param[in]: nrTargets - Number of targets.
+* param[in]: mode - MATCH_LITERAL, MATCH_GLOB or MATCH_REGEX (see matcher.h).
+* return: The set, or NULL if a pattern is invalid (a message is printed to
+* stderr).
+*/
+targetSet *targetSetNew (char **targets, int nrTargets, int mode) {
+
+	targetSet *ts = scalloc(1, sizeof(*ts));
+	ts -> nrTargets = 0;
+	ts -> mode = mode;
+	ts -> names = smalloc(sizeof(*ts -> names) * nrTargets);
+
+	/* A target given more than once is only kept the first time, found
+	through a table of the names kept so far								*/
+	unsigned int size = 16;
+	while (size < (unsigned int)nrTargets * 2) {
+
+		size *= 2;
+	}
+	int *seen = smalloc(sizeof(*seen) * size);
+	for (unsigned int i = 0; i < size; i++) {
+
+		seen[i] = -1;
+	}
+	for (int i = 0; i < nrTargets; i++) {
+
+		unsigned int h = hashName(targets[i]) & (size - 1);
+		while (seen[h] != -1 && strcmp(ts -> names[seen[h]], targets[i]) != 0) {
+
+			h = (h + 1) & (size - 1);
+		}
+		if (seen[h] != -1) {
+
+			continue;
+		}
+		int len = strlen(targets[i]);
+		seen[h] = ts -> nrTargets;
+		ts -> names[ts -> nrTargets] = smalloc(len + 1);
+		memcpy(ts -> names[ts -> nrTargets], targets[i], len + 1);
+		ts -> nrTargets++;
+	}
+	sfree(seen);
+
+	if (mode == MATCH_LITERAL) {
+
+		targetSetBuildTable(ts);
+	} else if (!targetSetCompile(ts)) {
+
+		targetSetKill(ts);
+		return NULL;
+	}
+	return ts;
+}
+
+/*
+* description: Gets the number of targets in the set.
+* param[in]: ts - The set.
+* return: The number of targets.
+*/
+int targetSetSize (targetSet *ts) {
+
+	return ts -> nrTargets;
+}
+
+/*
+* description: Gets the name of a target, as it was given.
+* param[in]: ts - The set.
+* param[in]: id - The target's index.
+* return: The name.
+*/
+const char *targetSetName (targetSet *ts, int id) {
+
+	return ts -> names[id];
+}
+
+/*
+* description: Gets the name a literal target matches - its last path
+* component.
+* param[in]: ts - The set.
+* param[in]: id - The target's index.
+* return: The name, or NULL if the targets are patterns.
+*/
+const char *targetSetKey (targetSet *ts, int id) {
+
+	return ts -> keys != NULL ? ts -> keys[id] : NULL;
+}
+
+/*
+* description: Gets all targets that match a name.
+* param[in]: ts - The set.
+* param[in]: name - The name, NULL-terminated.
+* param[out]: ids - Filled with the indexes of the matching targets, in
+* increasing order. Must have room for targetSetSize() indexes.
+* return: Number of matching targets.
+*/
+int targetSetMatch (targetSet *ts, const char *name, int *ids) {
+
+	int nrIds = 0;
+	if (ts -> table != NULL) {
+
+		unsigned int h = hashName(name) & ts -> tableMask;
+		while (ts -> table[h] != -1) {
+
+			if (strcmp(ts -> keys[ts -> table[h]], name) == 0) {
+
+				for (int i = ts -> table[h]; i != -1; i = ts -> next[i]) {
+
+					ids[nrIds++] = i;
+				}
+				break;
+			}
+			h = (h + 1) & ts -> tableMask;
+		}
+	} else if (ts -> combined != NULL) {
+
+		const int *matched;
+		nrIds = matcherMatchAll(ts -> combined, name, &matched);
+		memcpy(ids, matched, sizeof(*ids) * nrIds);
+	} else {
+
+		for (int i = 0; i < ts -> nrTargets; i++) {
+
+			if (matcherMatch(ts -> each[i], name)) {
+
+				ids[nrIds++] = i;
+			}
+		}
+	}
+	return nrIds;
+}
+
+/*
+* description: Frees all memory allocated by the set, including the set.
+* param[in]: ts - The set.
+*/
+void targetSetKill (targetSet *ts) {
+
+	if (ts != NULL) {
+
+		for (int i = 0; i < ts -> nrTargets; i++) {
+
+			sfree(ts -> names[i]);
+			if (ts -> keys != NULL) {
+
+				sfree(ts -> keys[i]);
+			}
+			if (ts -> each != NULL) {
+
+				matcherKill(ts -> each[i]);
+			}
+		}
+		sfree(ts -> names);
+		sfree(ts -> keys);
+		sfree(ts -> table);
+		sfree(ts -> next);
+		sfree(ts -> each);
+		matcherKill(ts -> combined);
+		sfree(ts);
+	}
+}
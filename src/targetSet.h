@@ -0,0 +1,69 @@
+/*
+* Set of targets, matched against every entry in one pass. Literal names are
+* kept in a hash set, so an entry is looked up once, however many targets
+* there are. Globs and regexes are compiled into one combined DFA, or, if that
+* would be too large, into one DFA each.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#ifndef __TARGETSET__
+#define __TARGETSET__
+
+typedef struct targetSet targetSet;
+
+/*
+* description: Creates a set of targets. The names are copied, and a name
+* given more than once is only kept once. A literal target is matched by its
+* last path component, like objectCmp() does.
+* param[in]: targets - The targets' names or patterns.
+* param[in]: nrTargets - Number of targets.
+* param[in]: mode - MATCH_LITERAL, MATCH_GLOB or MATCH_REGEX (see matcher.h).
+* return: The set, or NULL if a pattern is invalid (a message is printed to
+* stderr).
+*/
+targetSet *targetSetNew (char **targets, int nrTargets, int mode);
+
+/*
+* description: Gets the number of targets in the set.
+* param[in]: ts - The set.
+* return: The number of targets.
+*/
+int targetSetSize (targetSet *ts);
+
+/*
+* description: Gets the name of a target, as it was given.
+* param[in]: ts - The set.
+* param[in]: id - The target's index.
+* return: The name.
+*/
+const char *targetSetName (targetSet *ts, int id);
+
+/*
+* description: Gets the name a literal target matches - its last path
+* component.
+* param[in]: ts - The set.
+* param[in]: id - The target's index.
+* return: The name, or NULL if the targets are patterns.
+*/
+const char *targetSetKey (targetSet *ts, int id);
+
+/*
+* description: Gets all targets that match a name.
+* param[in]: ts - The set.
+* param[in]: name - The name, NULL-terminated.
+* param[out]: ids - Filled with the indexes of the matching targets, in
+* increasing order. Must have room for targetSetSize() indexes.
+* return: Number of matching targets.
+*/
+int targetSetMatch (targetSet *ts, const char *name, int *ids);
+
+/*
+* description: Frees all memory allocated by the set, including the set.
+* param[in]: ts - The set.
+*/
+void targetSetKill (targetSet *ts);
+
+#endif //__TARGETSET__
@@ -0,0 +1,203 @@
+/*
+* matcherTest - Table-driven test of the compiled glob and regex matcher (see
+* matcher.h). Each case is a pattern, a name, and whether the name should
+* match, or whether the pattern should be rejected. Prints every case that
+* fails, and exits with 1 if any did.
+*
+* Run with "make test".
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../matcher.h"
+
+/* Expected outcome of a case												*/
+#define NO_MATCH 0
+#define MATCHES 1
+#define INVALID 2
+
+typedef struct matcherCase {
+
+	int mode;
+	const char *pattern;
+	const char *name;
+	int expect;
+} matcherCase;
+
+static const matcherCase cases[] = {
+
+	/* Literals, short and long enough for the vector compare				*/
+	{MATCH_LITERAL, "big.txt", "big.txt", MATCHES},
+	{MATCH_LITERAL, "big.txt", "big.txt2", NO_MATCH},
+	{MATCH_LITERAL, "big.txt", "Big.txt", NO_MATCH},
+	{MATCH_LITERAL, "a-rather-long-name-of-more-than-32-bytes.c",
+	 "a-rather-long-name-of-more-than-32-bytes.c", MATCHES},
+	{MATCH_LITERAL, "a-rather-long-name-of-more-than-32-bytes.c",
+	 "a-rather-long-name-of-more-than-32-bytEs.c", NO_MATCH},
+
+	/* Globs match the whole name											*/
+	{MATCH_GLOB, "*.c", "main.c", MATCHES},
+	{MATCH_GLOB, "*.c", "main.h", NO_MATCH},
+	{MATCH_GLOB, "*.c", ".c", MATCHES},
+	{MATCH_GLOB, "main", "main.c", NO_MATCH},
+	{MATCH_GLOB, "a?c", "abc", MATCHES},
+	{MATCH_GLOB, "a?c", "ac", NO_MATCH},
+	{MATCH_GLOB, "*a*b*", "xaxbx", MATCHES},
+	{MATCH_GLOB, "*a*b*", "xbxax", NO_MATCH},
+	{MATCH_GLOB, "[abc]x", "bx", MATCHES},
+	{MATCH_GLOB, "[!abc]x", "bx", NO_MATCH},
+	{MATCH_GLOB, "[^abc]x", "dx", MATCHES},
+	{MATCH_GLOB, "[a-c]", "b", MATCHES},
+	{MATCH_GLOB, "[a-c]", "d", NO_MATCH},
+	{MATCH_GLOB, "[]]", "]", MATCHES},
+	{MATCH_GLOB, "[a-]", "-", MATCHES},
+	{MATCH_GLOB, "\\*", "*", MATCHES},
+	{MATCH_GLOB, "\\*", "a", NO_MATCH},
+	{MATCH_GLOB, "\\[a", "[a", MATCHES},
+	{MATCH_GLOB, "[", "[", INVALID},
+	{MATCH_GLOB, "x[", "x[", INVALID},
+	{MATCH_GLOB, "[a-", "a", INVALID},
+	{MATCH_GLOB, "[c-a]", "b", INVALID},
+
+	/* Names are matched as bytes: é is two bytes in UTF-8					*/
+	{MATCH_GLOB, "?", "\xc3\xa9", NO_MATCH},
+	{MATCH_GLOB, "??", "\xc3\xa9", MATCHES},
+
+	/* Regexes match anywhere, unless anchored								*/
+	{MATCH_REGEX, "abc", "xabcx", MATCHES},
+	{MATCH_REGEX, "^abc", "xabc", NO_MATCH},
+	{MATCH_REGEX, "abc$", "abcx", NO_MATCH},
+	{MATCH_REGEX, "^abc$", "abc", MATCHES},
+	{MATCH_REGEX, "a.c", "abc", MATCHES},
+	{MATCH_REGEX, "\\.", "abc", NO_MATCH},
+	{MATCH_REGEX, "\\.c$", "main.c", MATCHES},
+	{MATCH_REGEX, "^(cat|dog)s?$", "dogs", MATCHES},
+	{MATCH_REGEX, "^(cat|dog)s?$", "cow", NO_MATCH},
+	{MATCH_REGEX, "^(ab)+$", "abab", MATCHES},
+	{MATCH_REGEX, "^(ab)+$", "aba", NO_MATCH},
+	{MATCH_REGEX, "^a{2,3}$", "aa", MATCHES},
+	{MATCH_REGEX, "^a{2,3}$", "aaaa", NO_MATCH},
+	{MATCH_REGEX, "^a{2}$", "a", NO_MATCH},
+	{MATCH_REGEX, "^a{2,}$", "aaaaa", MATCHES},
+	{MATCH_REGEX, "^[[:digit:]]+$", "2026", MATCHES},
+	{MATCH_REGEX, "^[^[:alpha:]]$", "a", NO_MATCH},
+	{MATCH_REGEX, "[[:bogus:]]", "a", INVALID},
+	{MATCH_REGEX, "^.$", "\xc3\xa9", NO_MATCH},
+	{MATCH_REGEX, "^..$", "\xc3\xa9", MATCHES},
+
+	/* Escapes beyond POSIX, and those that are rejected					*/
+	{MATCH_REGEX, "^\\d+$", "123", MATCHES},
+	{MATCH_REGEX, "^\\d+$", "12a", NO_MATCH},
+	{MATCH_REGEX, "^\\w+$", "a_1", MATCHES},
+	{MATCH_REGEX, "\\s", "a b", MATCHES},
+	{MATCH_REGEX, "^\\S+$", "a b", NO_MATCH},
+	{MATCH_REGEX, "^[\\d.]+$", "1.2", MATCHES},
+	{MATCH_REGEX, "\\b", "a", INVALID},
+	{MATCH_REGEX, "\\Ba", "a", INVALID},
+	{MATCH_REGEX, "\\<a", "a", INVALID},
+	{MATCH_REGEX, "a\\>", "a", INVALID},
+	{MATCH_REGEX, "(a)\\1", "aa", INVALID},
+	{MATCH_REGEX, "[\\b]", "b", INVALID},
+
+	/* Malformed regexes													*/
+	{MATCH_REGEX, "(a", "a", INVALID},
+	{MATCH_REGEX, "a)", "a", INVALID},
+	{MATCH_REGEX, "*a", "a", INVALID},
+	{MATCH_REGEX, "[a", "a", INVALID},
+	{MATCH_REGEX, "a\\", "a", INVALID},
+	{MATCH_REGEX, "[z-a]", "a", INVALID},
+};
+
+/*
+* description: Compiles a pattern. stderr is silenced if the pattern is
+* expected to be rejected, since the error message is then no failure.
+* param[in]: c - The case.
+* return: The matcher, or NULL if the pattern was rejected.
+*/
+static matcher *compileCase (const matcherCase *c) {
+
+	int saved = -1;
+	if (c -> expect == INVALID) {
+
+		fflush(stderr);
+		saved = dup(STDERR_FILENO);
+		int null = open("/dev/null", O_WRONLY);
+		dup2(null, STDERR_FILENO);
+		close(null);
+	}
+	matcher *m = matcherCompile(c -> pattern, c -> mode);
+	if (saved >= 0) {
+
+		fflush(stderr);
+		dup2(saved, STDERR_FILENO);
+		close(saved);
+	}
+	return m;
+}
+
+/*
+* description: Runs one case.
+* param[in]: c - The case.
+* return: If it passed; 1, else 0.
+*/
+static int runCase (const matcherCase *c) {
+
+	static const char *outcomes[] = {"no match", "a match", "an error"};
+	matcher *m = compileCase(c);
+	int got = m == NULL ? INVALID : matcherMatch(m, c -> name) ? MATCHES :
+			  NO_MATCH;
+	matcherKill(m);
+	if (got != c -> expect) {
+
+		printf("FAIL: mode %d, pattern \"%s\", name \"%s\": expected %s, "
+			   "got %s\n", c -> mode, c -> pattern, c -> name,
+			   outcomes[c -> expect], outcomes[got]);
+		return 0;
+	}
+	return 1;
+}
+
+/*
+* description: Runs a combined matcher of several globs, which must report
+* every pattern a name matches, in order.
+* return: If it passed; 1, else 0.
+*/
+static int runSet (void) {
+
+	char *patterns[] = {"*.c", "a*", "*.h", "a.c"};
+	int complex;
+	matcher *m = matcherCompileSet(patterns, 4, MATCH_GLOB, &complex);
+	if (m == NULL) {
+
+		printf("FAIL: set of globs was not compiled\n");
+		return 0;
+	}
+	const int *ids;
+	int nrIds = matcherMatchAll(m, "a.c", &ids);
+	int passed = nrIds == 3 && ids[0] == 0 && ids[1] == 1 && ids[2] == 3 &&
+				 matcherMatchAll(m, "b.txt", &ids) == 0;
+	matcherKill(m);
+	if (!passed) {
+
+		printf("FAIL: set of globs matched a.c against %d patterns\n", nrIds);
+	}
+	return passed;
+}
+
+int main (void) {
+
+	int nrCases = sizeof(cases) / sizeof(cases[0]);
+	int failed = 0;
+	for (int i = 0; i < nrCases; i++) {
+
+		failed += !runCase(&cases[i]);
+	}
+	failed += !runSet();
+	printf("matcher: %d of %d cases passed\n", nrCases + 1 - failed,
+		   nrCases + 1);
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+#!/bin/bash
+#
+# predicateTest - Runs find-style expressions with mfind --where (see
+# predicate.h) and with find over the same small tree, and checks that both
+# find the same entries. The tree has files of different sizes, ages and
+# permissions, a link to a file, a link to a directory and a dangling link.
+# Prints every expression that differs, and exits with 1 if any did.
+#
+# Run with "make test".
+#
+# Environment:
+# MFIND		The binary. Default is ../mfind, next to this directory.
+#
+# Author: mfind contributors
+
+HERE="$(cd "$(dirname "$0")" && pwd)"
+MFIND="${MFIND:-$HERE/../mfind}"
+
+# Expressions as given to --where, with ( ) and quotes as mfind reads them
+EXPRESSIONS=(
+	"-size +1k"
+	"-size -1M"
+	"-size 0"
+	"-size 1000c"
+	"-size 5k"
+	"-mtime +3"
+	"-mtime -2"
+	"-mtime 5"
+	"-mmin -60"
+	"-perm -111"
+	"-perm /022"
+	"-perm 644"
+	"! -type d"
+	"-not -name '*.log'"
+	"-type l"
+	"-type l -o -type d"
+	"( -name '*.log' -o -size +1k ) -type f"
+	"-type f -a ( -mtime -2 -o -perm -111 )"
+	"! ( -type f -o -name 'sub*' )"
+	"-name '*.c' -o ! -type f -size -1"
+)
+
+if [ ! -x "$MFIND" ]; then
+
+	echo "Build $MFIND first (make test)" >&2
+	exit 1
+fi
+TREE=$(mktemp -d) || exit 1
+trap 'rm -rf "$TREE"' EXIT
+
+# Creates a file.
+# $1 - path below the tree, $2 - size in bytes, $3 - age, $4 - mode
+mkFile () {
+
+	truncate -s "$2" "$TREE/$1" && touch -d "$3" "$TREE/$1" &&
+		chmod "$4" "$TREE/$1"
+}
+
+mkdir -p "$TREE/sub/deeper" "$TREE/empty" "$TREE/old" || exit 1
+mkFile empty.txt 0 "now" 644 &&
+mkFile small.c 1000 "1 hour ago" 644 &&
+mkFile run.sh 300 "1 day ago" 755 &&
+mkFile sub/five.log 5120 "5 days ago" 600 &&
+mkFile sub/big.log 2097152 "10 days ago" 664 &&
+mkFile sub/deeper/tool 4097 "4 days ago" 711 &&
+mkFile sub/deeper/notes.txt 1 "30 minutes ago" 640 &&
+mkFile old/ancient.c 1 "400 days ago" 444 || exit 1
+touch -d "20 days ago" "$TREE/old" &&
+ln -s small.c "$TREE/link.c" &&
+ln -s sub "$TREE/subLink" &&
+ln -s nowhere "$TREE/dangling" || exit 1
+
+failed=0
+for expr in "${EXPRESSIONS[@]}"; do
+
+	# find gets the expression from the shell, so ( ) are escaped, and grouped
+	# so that -print applies to all of it
+	findExpr=$(echo "$expr" | sed 's/[()]/\\&/g')
+	want=$(eval "find \"\$TREE\" \\( $findExpr \\) -print" | sort)
+	got=$("$MFIND" --print0 --where "$expr" "$TREE" | tr '\0' '\n' | sort)
+	if [ "$got" != "$want" ]; then
+
+		echo "FAIL: --where \"$expr\":"
+		diff <(echo "$want") <(echo "$got") | sed -n "s|$TREE||; /^[<>]/p"
+		failed=$((failed + 1))
+	fi
+done
+echo "predicate: $((${#EXPRESSIONS[@]} - failed)) of ${#EXPRESSIONS[@]}" \
+	 "expressions matched find"
+[ $failed -eq 0 ]
@@ -0,0 +1,179 @@
+/*
+* Concurrent set of visited directories, by device and inode number, so that
+* no directory is read twice when symbolic links are followed (-L), or when
+* starting directories overlap. With each directory, the depths it was
+* reached at are kept, so that a search limited by depth can tell if it must
+* be read again. The set is split into shards, each a hash
+* table with its own mutex, chosen by the hash of the directory, so that
+* threads adding different directories rarely contend, and no lock is taken
+* for the whole set.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "visitedSet.h"
+#include "saferMemHandler.h"
+
+#define VISITEDSET_INIT_CAPACITY 64
+
+/* A directory in a shard's table, with the depths it was reached at. Inode 0
+is never used by a file, and marks an empty slot							*/
+typedef struct visitedKey {
+
+	dev_t dev;
+	ino_t ino;
+	uint64_t depths;
+} visitedKey;
+
+/* One shard - an open addressing table, kept at most half full. Padded to
+a cache line, as it is locked by whichever thread adds to it				*/
+typedef struct visitedShard {
+
+	pthread_mutex_t mtx;
+	visitedKey *keys;
+	unsigned int mask;
+	unsigned int size;
+	char pad[64 - sizeof(pthread_mutex_t) - sizeof(visitedKey *) -
+			 2 * sizeof(unsigned int)];
+} visitedShard;
+
+struct visitedSet {
+
+	visitedShard shards[VISITEDSET_SHARDS];
+};
+
+/*
+* description: Gets the hash of a directory, by mixing its device and inode
+* number (the finalizer of splitmix64).
+* param[in]: dev - The device.
+* param[in]: ino - The inode number.
+* return: The hash.
+*/
+static uint64_t visitedHash (dev_t dev, ino_t ino) {
+
+	uint64_t h = (uint64_t)ino ^ ((uint64_t)dev * 0x9e3779b97f4a7c15ull);
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+	return h ^ (h >> 31);
+}
+
+/*
+* description: Finds the slot of a directory in a shard, or the empty slot it
+* would be put in. Shard must be locked.
+* param[in]: sh - The shard.
+* param[in]: h - Hash of the directory.
+* param[in]: dev - Device of the directory.
+* param[in]: ino - Inode number of the directory.
+* return: The slot.
+*/
+static visitedKey *visitedFind (visitedShard *sh, uint64_t h, dev_t dev,
+								ino_t ino) {
+
+	/* The low bits chose the shard, so the slot is taken from the high	*/
+	unsigned int i = (unsigned int)(h >> 32) & sh -> mask;
+	while (sh -> keys[i].ino != 0 &&
+		   (sh -> keys[i].ino != ino || sh -> keys[i].dev != dev)) {
+
+		i = (i + 1) & sh -> mask;
+	}
+	return &sh -> keys[i];
+}
+
+/*
+* description: Doubles the capacity of a shard's table. Shard must be locked.
+* param[in]: sh - The shard.
+*/
+static void visitedGrow (visitedShard *sh) {
+
+	visitedKey *old = sh -> keys;
+	unsigned int oldCapacity = sh -> mask + 1;
+	sh -> mask = oldCapacity * 2 - 1;
+	sh -> keys = scalloc(oldCapacity * 2, sizeof(*sh -> keys));
+	for (unsigned int i = 0; i < oldCapacity; i++) {
+
+		if (old[i].ino != 0) {
+
+			*visitedFind(sh, visitedHash(old[i].dev, old[i].ino), old[i].dev,
+						 old[i].ino) = old[i];
+		}
+	}
+	sfree(old);
+}
+
+/*
+* description: Creates and allocates memory for an empty set.
+* return: The set.
+*/
+visitedSet *visitedSetNew (void) {
+
+	visitedSet *v = smalloc(sizeof(*v));
+	for (int i = 0; i < VISITEDSET_SHARDS; i++) {
+
+		visitedShard *sh = &v -> shards[i];
+		pthread_mutex_init(&sh -> mtx, NULL);
+		sh -> keys = scalloc(VISITEDSET_INIT_CAPACITY, sizeof(*sh -> keys));
+		sh -> mask = VISITEDSET_INIT_CAPACITY - 1;
+		sh -> size = 0;
+	}
+	return v;
+}
+
+/*
+* description: Adds a directory to the set, reached at a depth, unless it is
+* in it already at that depth. Depths of VISITEDSET_MAX_DEPTH and more are
+* all kept as VISITEDSET_MAX_DEPTH. May be called by many threads at once.
+* param[in]: v - The set.
+* param[in]: dev - Device of the directory.
+* param[in]: ino - Inode number of the directory.
+* param[in]: depth - Depth it was reached at.
+* return: The depths it had been reached at before, bit d set for depth d,
+* or 0 if this is the first visit.
+*/
+uint64_t visitedSetAdd (visitedSet *v, dev_t dev, ino_t ino, int depth) {
+
+	uint64_t h = visitedHash(dev, ino);
+	visitedShard *sh = &v -> shards[h & (VISITEDSET_SHARDS - 1)];
+	uint64_t bit = 1ull << (depth < VISITEDSET_MAX_DEPTH ? depth :
+							VISITEDSET_MAX_DEPTH);
+	pthread_mutex_lock(&sh -> mtx);
+	visitedKey *k = visitedFind(sh, h, dev, ino);
+	uint64_t depths = k -> depths;
+	k -> depths |= bit;
+	if (k -> ino == 0) {
+
+		k -> dev = dev;
+		k -> ino = ino;
+		if (++sh -> size * 2 > sh -> mask + 1) {
+
+			visitedGrow(sh);
+		}
+	}
+	pthread_mutex_unlock(&sh -> mtx);
+	return depths;
+}
+
+/*
+* description: Frees all memory allocated by the set, including the set.
+* param[in]: v - The set.
+*/
+void visitedSetKill (visitedSet *v) {
+
+	if (v == NULL) {
+
+		return;
+	}
+	for (int i = 0; i < VISITEDSET_SHARDS; i++) {
+
+		pthread_mutex_destroy(&v -> shards[i].mtx);
+		sfree(v -> shards[i].keys);
+	}
+	sfree(v);
+}
@@ -0,0 +1,55 @@
+/*
+* Concurrent set of visited directories, by device and inode number, so that
+* no directory is read twice when symbolic links are followed (-L), or when
+* starting directories overlap. With each directory, the depths it was
+* reached at are kept, so that a search limited by depth can tell if it must
+* be read again. The set is split into shards, each a hash
+* table with its own mutex, chosen by the hash of the directory, so that
+* threads adding different directories rarely contend, and no lock is taken
+* for the whole set.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#ifndef __VISITEDSET__
+#define __VISITEDSET__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Number of shards, a power of two										*/
+#define VISITEDSET_SHARDS 64
+
+/* Largest depth kept apart from the deeper ones, one bit each				*/
+#define VISITEDSET_MAX_DEPTH 63
+
+typedef struct visitedSet visitedSet;
+
+/*
+* description: Creates and allocates memory for an empty set.
+* return: The set.
+*/
+visitedSet *visitedSetNew (void);
+
+/*
+* description: Adds a directory to the set, reached at a depth, unless it is
+* in it already at that depth. Depths of VISITEDSET_MAX_DEPTH and more are
+* all kept as VISITEDSET_MAX_DEPTH. May be called by many threads at once.
+* param[in]: v - The set.
+* param[in]: dev - Device of the directory.
+* param[in]: ino - Inode number of the directory.
+* param[in]: depth - Depth it was reached at.
+* return: The depths it had been reached at before, bit d set for depth d,
+* or 0 if this is the first visit.
+*/
+uint64_t visitedSetAdd (visitedSet *v, dev_t dev, ino_t ino, int depth);
+
+/*
+* description: Frees all memory allocated by the set, including the set.
+* param[in]: v - The set.
+*/
+void visitedSetKill (visitedSet *v);
+
+#endif //__VISITEDSET__
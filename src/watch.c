@@ -0,0 +1,955 @@
+/*
+* Watch mode. Keeps a name index up to date while the tree changes. The index
+* is first built by a normal search, then loaded into memory as a tree of
+* entries, with an inotify watch on every directory. Creates, deletes and
+* renames are applied to the tree as they happen, and the index file is
+* rewritten shortly after, so that --index queries always see a recent view.
+*
+* If the watch limit (fs.inotify.max_user_watches) is reached, directories
+* that could not be watched are rescanned periodically instead, along with
+* everything below them. If the event queue overflows, all starting
+* directories are rescanned.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#include "watch.h"
+#include "nameIndex.h"
+#include "saferMemHandler.h"
+
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+					IN_DELETE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW | \
+					IN_EXCL_UNLINK)
+
+/* Large enough for many events per read, aligned for struct inotify_event	*/
+#define WATCH_EVENT_BUFFER 65536
+
+/* An entry of the tree. Children are linked through their siblings, and all
+entries are found by (parent, name) through the hash table. A free'd node
+has no name, and is linked into the free list through nextSibling.			*/
+typedef struct watchNode {
+
+	char *name;
+	char type;
+	char unwatched;					/* A directory without a watch			*/
+	char detached;					/* Renamed, and not in the hash table	*/
+	int parent;						/* -1 for a starting directory			*/
+	int firstChild;
+	int nextSibling;
+	int prevSibling;
+	int hashNext;
+	int wd;							/* -1 if not watched					*/
+} watchNode;
+
+/* A rename whose IN_MOVED_FROM has been seen, but not its IN_MOVED_TO		*/
+typedef struct watchMove {
+
+	uint32_t cookie;
+	int node;
+} watchMove;
+
+typedef struct watchTree {
+
+	watchNode *nodes;
+	int nrNodes;
+	int capacity;
+	int freeList;
+	int *buckets;
+	unsigned int bucketMask;
+	int nrLive;
+	int *wdNodes;					/* Node of each watch descriptor		*/
+	int wdCapacity;
+	int *roots;
+	char **rootPaths;
+	int nrRoots;
+	watchMove *moves;
+	int nrMoves;
+	int movesCapacity;
+	int fd;
+	int nrUnwatched;
+	int rescan;
+	int warned;
+	int dirty;
+} watchTree;
+
+static void watchScanDir (watchTree *t, int node);
+
+/*
+* description: Gets the FNV-1a hash of an entry's parent and name.
+* param[in]: parent - The parent node.
+* param[in]: name - The name.
+* return: The hash.
+*/
+static unsigned int watchHash (int parent, const char *name) {
+
+	unsigned int h = 2166136261u ^ (unsigned int)parent * 2654435761u;
+	for (const unsigned char *p = (const unsigned char *)name;
+		 *p != '\0'; p++) {
+
+		h = (h ^ *p) * 16777619u;
+	}
+	return h;
+}
+
+/*
+* description: Gets the seconds of the monotonic clock.
+* return: The seconds.
+*/
+static time_t watchNow (void) {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+
+/*
+* description: Gets the type of an entry, the way a search does.
+* param[in]: dirFd - Open fd of the entry's directory.
+* param[in]: name - Name of the entry.
+* param[in]: dType - Its type from readdir(), or DT_UNKNOWN.
+* return: The type (d, f, l or o), or '\0' if the entry is gone.
+*/
+static char watchEntryType (int dirFd, const char *name, unsigned char dType) {
+
+	switch (dType) {
+
+		case DT_DIR:
+			return 'd';
+		case DT_REG:
+			return 'f';
+		case DT_LNK:
+			return 'l';
+		case DT_UNKNOWN:
+			break;
+		default:
+			return 'o';
+	}
+	struct stat st;
+	if (fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+
+		return '\0';
+	}
+	if (S_ISDIR(st.st_mode)) {
+
+		return 'd';
+	} else if (S_ISREG(st.st_mode)) {
+
+		return 'f';
+	} else if (S_ISLNK(st.st_mode)) {
+
+		return 'l';
+	}
+	return 'o';
+}
+
+/*
+* description: Doubles the hash table, and reinserts all nodes.
+* param[in]: t - The tree.
+*/
+static void watchRehash (watchTree *t) {
+
+	unsigned int size = (t -> bucketMask + 1) * 2;
+	t -> buckets = srealloc(t -> buckets, sizeof(*t -> buckets) * size);
+	t -> bucketMask = size - 1;
+	for (unsigned int i = 0; i < size; i++) {
+
+		t -> buckets[i] = -1;
+	}
+	for (int i = 0; i < t -> nrNodes; i++) {
+
+		watchNode *n = &t -> nodes[i];
+		if (n -> name != NULL && !n -> detached) {
+
+			unsigned int h = watchHash(n -> parent, n -> name) &
+							 t -> bucketMask;
+			n -> hashNext = t -> buckets[h];
+			t -> buckets[h] = i;
+		}
+	}
+}
+
+/*
+* description: Links a node into its parent's children and the hash table.
+* param[in]: t - The tree.
+* param[in]: node - The node, with parent and name set.
+*/
+static void watchLink (watchTree *t, int node) {
+
+	watchNode *n = &t -> nodes[node];
+	unsigned int h = watchHash(n -> parent, n -> name) & t -> bucketMask;
+	n -> hashNext = t -> buckets[h];
+	t -> buckets[h] = node;
+	n -> prevSibling = -1;
+	n -> nextSibling = -1;
+	if (n -> parent >= 0) {
+
+		watchNode *p = &t -> nodes[n -> parent];
+		n -> nextSibling = p -> firstChild;
+		if (p -> firstChild >= 0) {
+
+			t -> nodes[p -> firstChild].prevSibling = node;
+		}
+		p -> firstChild = node;
+	}
+}
+
+/*
+* description: Unlinks a node from its parent's children and the hash table.
+* Its own children stay linked to it.
+* param[in]: t - The tree.
+* param[in]: node - The node.
+*/
+static void watchUnlink (watchTree *t, int node) {
+
+	watchNode *n = &t -> nodes[node];
+	unsigned int h = watchHash(n -> parent, n -> name) & t -> bucketMask;
+	int *link = &t -> buckets[h];
+	while (*link != node) {
+
+		link = &t -> nodes[*link].hashNext;
+	}
+	*link = n -> hashNext;
+	if (n -> prevSibling >= 0) {
+
+		t -> nodes[n -> prevSibling].nextSibling = n -> nextSibling;
+	} else if (n -> parent >= 0) {
+
+		t -> nodes[n -> parent].firstChild = n -> nextSibling;
+	}
+	if (n -> nextSibling >= 0) {
+
+		t -> nodes[n -> nextSibling].prevSibling = n -> prevSibling;
+	}
+	n -> prevSibling = -1;
+	n -> nextSibling = -1;
+}
+
+/*
+* description: Finds an entry by its directory and name.
+* param[in]: t - The tree.
+* param[in]: parent - The directory's node.
+* param[in]: name - The name.
+* return: The entry's node, or -1 if there is none.
+*/
+static int watchFind (watchTree *t, int parent, const char *name) {
+
+	unsigned int h = watchHash(parent, name) & t -> bucketMask;
+	for (int i = t -> buckets[h]; i >= 0; i = t -> nodes[i].hashNext) {
+
+		if (t -> nodes[i].parent == parent &&
+			strcmp(t -> nodes[i].name, name) == 0) {
+
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+* description: Adds an entry to the tree.
+* param[in]: t - The tree.
+* param[in]: parent - The directory's node, or -1 for a starting directory.
+* param[in]: name - Name of the entry (copied).
+* param[in]: type - Type of the entry.
+* return: The entry's node. Pointers into the tree's nodes are invalidated.
+*/
+static int watchAdd (watchTree *t, int parent, const char *name, char type) {
+
+	if (t -> nrLive >= (int)(t -> bucketMask + 1)) {
+
+		watchRehash(t);
+	}
+	t -> nrLive++;
+	int node = t -> freeList;
+	if (node >= 0) {
+
+		t -> freeList = t -> nodes[node].nextSibling;
+	} else {
+
+		if (t -> nrNodes == t -> capacity) {
+
+			t -> capacity = t -> capacity > 0 ? t -> capacity * 2 : 1024;
+			t -> nodes = srealloc(t -> nodes,
+								  sizeof(*t -> nodes) * t -> capacity);
+		}
+		node = t -> nrNodes++;
+	}
+	watchNode *n = &t -> nodes[node];
+	n -> name = smalloc(strlen(name) + 1);
+	strcpy(n -> name, name);
+	n -> type = type;
+	n -> unwatched = 0;
+	n -> parent = parent;
+	n -> firstChild = -1;
+	n -> detached = 0;
+	n -> wd = -1;
+	watchLink(t, node);
+	return node;
+}
+
+/*
+* description: Removes the watch of a directory, if it has one.
+* param[in]: t - The tree.
+* param[in]: node - The directory's node.
+*/
+static void watchForget (watchTree *t, int node) {
+
+	watchNode *n = &t -> nodes[node];
+	if (n -> wd >= 0) {
+
+		if (t -> wdNodes[n -> wd] == node) {
+
+			t -> wdNodes[n -> wd] = -1;
+		}
+		inotify_rm_watch(t -> fd, n -> wd);
+		n -> wd = -1;
+	}
+	if (n -> unwatched) {
+
+		n -> unwatched = 0;
+		t -> nrUnwatched--;
+	}
+}
+
+/*
+* description: Removes all entries below a directory.
+* param[in]: t - The tree.
+* param[in]: node - The directory's node.
+*/
+static void watchRemoveChildren (watchTree *t, int node) {
+
+	while (t -> nodes[node].firstChild >= 0) {
+
+		int child = t -> nodes[node].firstChild;
+		watchRemoveChildren(t, child);
+		watchForget(t, child);
+		watchUnlink(t, child);
+		watchNode *c = &t -> nodes[child];
+		sfree(c -> name);
+		c -> name = NULL;
+		c -> nextSibling = t -> freeList;
+		t -> freeList = child;
+		t -> nrLive--;
+	}
+}
+
+/*
+* description: Removes an entry, and everything below it. The entry must
+* already be unlinked if it was (see watchUnlink()).
+* param[in]: t - The tree.
+* param[in]: node - The entry's node.
+* param[in]: linked - If the entry is still linked into the tree.
+*/
+static void watchRemove (watchTree *t, int node, int linked) {
+
+	watchRemoveChildren(t, node);
+	watchForget(t, node);
+	if (linked) {
+
+		watchUnlink(t, node);
+	}
+	watchNode *n = &t -> nodes[node];
+	sfree(n -> name);
+	n -> name = NULL;
+	n -> nextSibling = t -> freeList;
+	t -> freeList = node;
+	t -> nrLive--;
+}
+
+/*
+* description: Builds the complete path of an entry, or of a name in it, the
+* same way a search does. The path is stored in the calling thread's scratch
+* buffer (see arenaScratch()), and must not be free'd.
+* param[in]: t - The tree.
+* param[in]: node - The entry's node.
+* param[in]: name - A name in the entry, or NULL for the entry itself.
+* return: The path.
+*/
+static char *watchPath (watchTree *t, int node, const char *name) {
+
+	size_t length = name != NULL ? strlen(name) + 1 : 0;
+	int n = node;
+	while (t -> nodes[n].parent >= 0) {
+
+		length += strlen(t -> nodes[n].name) + 1;
+		n = t -> nodes[n].parent;
+	}
+	const char *root = NULL;
+	for (int i = 0; i < t -> nrRoots; i++) {
+
+		if (t -> roots[i] == n) {
+
+			root = t -> rootPaths[i];
+		}
+	}
+	size_t rootLen = strlen(root);
+	if (length > 0 && rootLen > 0 && root[rootLen - 1] == '/') {
+
+		rootLen--;					/* Separated like objectGetPath()		*/
+	}
+	length += rootLen;
+
+	char *path = arenaScratch(length + 1);
+	path[length] = '\0';
+	if (name != NULL) {
+
+		size_t len = strlen(name);
+		length -= len;
+		memcpy(&path[length], name, len);
+		path[--length] = '/';
+	}
+	for (n = node; t -> nodes[n].parent >= 0; n = t -> nodes[n].parent) {
+
+		size_t len = strlen(t -> nodes[n].name);
+		length -= len;
+		memcpy(&path[length], t -> nodes[n].name, len);
+		path[--length] = '/';
+	}
+	memcpy(path, root, rootLen);
+	return path;
+}
+
+/*
+* description: Adds a watch to a directory. If the watch limit is reached, the
+* directory is marked as unwatched, to be rescanned instead.
+* param[in]: t - The tree.
+* param[in]: node - The directory's node.
+*/
+static void watchDir (watchTree *t, int node) {
+
+	char *path = watchPath(t, node, NULL);
+	int wd = inotify_add_watch(t -> fd, path, WATCH_MASK);
+	watchNode *n = &t -> nodes[node];
+	if (wd < 0) {
+
+		if (errno == ENOSPC || errno == ENOMEM) {
+
+			if (!n -> unwatched) {
+
+				n -> unwatched = 1;
+				t -> nrUnwatched++;
+			}
+			if (!t -> warned) {
+
+				fprintf(stderr, "Watch limit reached, some directories are "
+						"rescanned every %d seconds instead\n", t -> rescan);
+				t -> warned = 1;
+			}
+		}
+		return;
+	}
+	if (n -> unwatched) {
+
+		n -> unwatched = 0;
+		t -> nrUnwatched--;
+	}
+	if (wd >= t -> wdCapacity) {
+
+		int capacity = t -> wdCapacity > 0 ? t -> wdCapacity : 1024;
+		while (capacity <= wd) {
+
+			capacity *= 2;
+		}
+		t -> wdNodes = srealloc(t -> wdNodes, sizeof(*t -> wdNodes) * capacity);
+		for (int i = t -> wdCapacity; i < capacity; i++) {
+
+			t -> wdNodes[i] = -1;
+		}
+		t -> wdCapacity = capacity;
+	}
+
+	/* The same directory twice, through a bind mount, shares its watch		*/
+	if (t -> wdNodes[wd] >= 0 && t -> wdNodes[wd] != node) {
+
+		t -> nodes[t -> wdNodes[wd]].wd = -1;
+	}
+	t -> wdNodes[wd] = node;
+	n -> wd = wd;
+}
+
+/*
+* description: Adds an entry found in a directory, if it is not known yet. A
+* new directory is watched and scanned.
+* param[in]: t - The tree.
+* param[in]: parent - The directory's node.
+* param[in]: dirFd - Open fd of the directory.
+* param[in]: name - Name of the entry.
+* param[in]: dType - Its type from readdir(), or DT_UNKNOWN.
+*/
+static void watchAddEntry (watchTree *t, int parent, int dirFd,
+						   const char *name, unsigned char dType) {
+
+	if (name[0] == '.' || watchFind(t, parent, name) >= 0) {
+
+		return;
+	}
+	char type = watchEntryType(dirFd, name, dType);
+	if (type == '\0') {
+
+		return;
+	}
+	int node = watchAdd(t, parent, name, type);
+	t -> dirty = 1;
+	if (type == 'd') {
+
+		/* Watched before it is read, so nothing created meanwhile is lost	*/
+		watchDir(t, node);
+		watchScanDir(t, node);
+	}
+}
+
+/*
+* description: Reads a directory, and adds every entry not known yet.
+* param[in]: t - The tree.
+* param[in]: node - The directory's node.
+*/
+static void watchScanDir (watchTree *t, int node) {
+
+	int fd = open(watchPath(t, node, NULL),
+				  O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+	if (fd < 0) {
+
+		return;
+	}
+	DIR *dir = fdopendir(fd);
+	if (dir == NULL) {
+
+		close(fd);
+		return;
+	}
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+
+		watchAddEntry(t, node, fd, entry -> d_name, entry -> d_type);
+	}
+	closedir(dir);
+}
+
+/*
+* description: Reads a directory again from scratch, with everything below it,
+* and watches it if it was unwatched.
+* param[in]: t - The tree.
+* param[in]: node - The directory's node.
+*/
+static void watchRescan (watchTree *t, int node) {
+
+	watchRemoveChildren(t, node);
+	if (t -> nodes[node].wd < 0) {
+
+		watchDir(t, node);
+	}
+	watchScanDir(t, node);
+	t -> dirty = 1;
+}
+
+/*
+* description: Rescans every unwatched directory that is not below another
+* unwatched directory, and tries to watch it again.
+* param[in]: t - The tree.
+*/
+static void watchRescanUnwatched (watchTree *t) {
+
+	int nrTop = 0;
+	int *top = smalloc(sizeof(*top) * t -> nrUnwatched);
+	for (int i = 0; i < t -> nrNodes && nrTop < t -> nrUnwatched; i++) {
+
+		if (t -> nodes[i].name == NULL || !t -> nodes[i].unwatched) {
+
+			continue;
+		}
+		int p = t -> nodes[i].parent;
+		while (p >= 0 && !t -> nodes[p].unwatched) {
+
+			p = t -> nodes[p].parent;
+		}
+		if (p < 0) {
+
+			top[nrTop++] = i;
+		}
+	}
+	for (int i = 0; i < nrTop; i++) {
+
+		watchRescan(t, top[i]);
+	}
+	sfree(top);
+}
+
+/*
+* description: Takes the node of a pending rename.
+* param[in]: t - The tree.
+* param[in]: cookie - Cookie of the rename's events.
+* return: The renamed node, or -1 if its IN_MOVED_FROM was not seen.
+*/
+static int watchTakeMove (watchTree *t, uint32_t cookie) {
+
+	for (int i = 0; i < t -> nrMoves; i++) {
+
+		if (t -> moves[i].cookie == cookie) {
+
+			int node = t -> moves[i].node;
+			t -> moves[i] = t -> moves[--t -> nrMoves];
+			return node;
+		}
+	}
+	return -1;
+}
+
+/*
+* description: Applies one event to the tree.
+* param[in]: t - The tree.
+* param[in]: ev - The event.
+*/
+static void watchHandleEvent (watchTree *t, struct inotify_event *ev) {
+
+	if (ev -> mask & IN_Q_OVERFLOW) {
+
+		fprintf(stderr, "Event queue overflowed, rescanning\n");
+		for (int i = 0; i < t -> nrRoots; i++) {
+
+			watchRescan(t, t -> roots[i]);
+		}
+		return;
+	}
+	if (ev -> wd < 0 || ev -> wd >= t -> wdCapacity ||
+		t -> wdNodes[ev -> wd] < 0) {
+
+		return;
+	}
+	int dir = t -> wdNodes[ev -> wd];
+	if (ev -> mask & IN_IGNORED) {
+
+		t -> wdNodes[ev -> wd] = -1;
+		t -> nodes[dir].wd = -1;
+		return;
+	}
+	if (ev -> mask & IN_DELETE_SELF) {
+
+		/* Anything but a starting directory is removed by its parent's
+		event																*/
+		if (t -> nodes[dir].parent < 0) {
+
+			watchRemoveChildren(t, dir);
+			t -> dirty = 1;
+		}
+		return;
+	}
+	if (ev -> len == 0 || ev -> name[0] == '.') {
+
+		return;
+	}
+
+	int old = watchFind(t, dir, ev -> name);
+	if (ev -> mask & (IN_CREATE | IN_MOVED_TO)) {
+
+		int moved = ev -> mask & IN_MOVED_TO ? watchTakeMove(t, ev -> cookie)
+											 : -1;
+		if (old >= 0 && old != moved) {
+
+			watchRemove(t, old, 1);				/* Replaced					*/
+		}
+		if (moved >= 0) {
+
+			/* Renamed within the tree - relinked with its subtree, which
+			keeps its watches												*/
+			watchNode *n = &t -> nodes[moved];
+			sfree(n -> name);
+			n -> name = smalloc(strlen(ev -> name) + 1);
+			strcpy(n -> name, ev -> name);
+			n -> parent = dir;
+			n -> detached = 0;
+			watchLink(t, moved);
+			t -> dirty = 1;
+		} else {
+
+			int fd = open(watchPath(t, dir, NULL),
+						  O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+			if (fd >= 0) {
+
+				watchAddEntry(t, dir, fd, ev -> name, DT_UNKNOWN);
+				close(fd);
+			}
+		}
+	} else if (ev -> mask & IN_DELETE) {
+
+		if (old >= 0) {
+
+			watchRemove(t, old, 1);
+			t -> dirty = 1;
+		}
+	} else if (ev -> mask & IN_MOVED_FROM) {
+
+		if (old >= 0) {
+
+			/* Held until its IN_MOVED_TO, or removed after this batch		*/
+			watchUnlink(t, old);
+			t -> nodes[old].detached = 1;
+			if (t -> nrMoves == t -> movesCapacity) {
+
+				t -> movesCapacity = t -> movesCapacity > 0 ?
+									 t -> movesCapacity * 2 : 16;
+				t -> moves = srealloc(t -> moves, sizeof(*t -> moves) *
+												  t -> movesCapacity);
+			}
+			t -> moves[t -> nrMoves].cookie = ev -> cookie;
+			t -> moves[t -> nrMoves].node = old;
+			t -> nrMoves++;
+			t -> dirty = 1;
+		}
+	}
+}
+
+/*
+* description: Reads and applies all pending events. Entries renamed out of
+* the tree are removed once all events read have been applied.
+* param[in]: t - The tree.
+* return: If the events could be read; 1, else 0.
+*/
+static int watchReadEvents (watchTree *t) {
+
+	char buffer[WATCH_EVENT_BUFFER]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	for (;;) {
+
+		ssize_t len = read(t -> fd, buffer, sizeof(buffer));
+		if (len < 0) {
+
+			if (errno == EAGAIN) {
+
+				break;
+			} else if (errno == EINTR) {
+
+				continue;
+			}
+			perror("inotify");
+			return 0;
+		}
+		for (char *p = buffer; p < buffer + len; ) {
+
+			struct inotify_event *ev = (struct inotify_event *)p;
+			watchHandleEvent(t, ev);
+			p += sizeof(*ev) + ev -> len;
+		}
+	}
+	for (int i = 0; i < t -> nrMoves; i++) {
+
+		watchRemove(t, t -> moves[i].node, 0);
+	}
+	t -> nrMoves = 0;
+	return 1;
+}
+
+/*
+* description: Adds an entry and everything below it to an index.
+* param[in]: t - The tree.
+* param[in]: w - Writer of the index.
+* param[in]: node - The entry's node.
+* param[in]: id - Id of the entry in the index.
+*/
+static void watchFlushNode (watchTree *t, indexWriter *w, int node,
+							uint32_t id) {
+
+	for (int c = t -> nodes[node].firstChild; c >= 0;
+		 c = t -> nodes[c].nextSibling) {
+
+		uint32_t childId = indexWriterAdd(w, id, t -> nodes[c].name,
+										  t -> nodes[c].type);
+		watchFlushNode(t, w, c, childId);
+	}
+}
+
+/*
+* description: Writes the tree to the index file. The starting directories
+* are added first, so every parent has a smaller id than its children.
+* param[in]: t - The tree.
+* param[in]: file - Path of the index.
+* return: If the index was written; 1, else 0.
+*/
+static int watchFlush (watchTree *t, const char *file) {
+
+	indexBuilder *b = indexBuilderNew();
+	uint32_t ids[t -> nrRoots];
+	for (int i = 0; i < t -> nrRoots; i++) {
+
+		ids[i] = indexBuilderAddRoot(b, t -> rootPaths[i]);
+	}
+	indexWriter *w = indexWriterNew(b);
+	for (int i = 0; i < t -> nrRoots; i++) {
+
+		watchFlushNode(t, w, t -> roots[i], ids[i]);
+	}
+	int res = indexBuilderWrite(b, file);
+	indexBuilderKill(b);
+	t -> dirty = 0;
+	return res;
+}
+
+/*
+* description: Loads the tree from an index.
+* param[in]: t - The tree, empty.
+* param[in]: ix - The index.
+*/
+static void watchLoad (watchTree *t, nameIndex *ix) {
+
+	/* Node i is entry i, as long as every entry is kept					*/
+	uint32_t nrEntries = nameIndexNrEntries(ix);
+	int *nodeOf = smalloc(sizeof(*nodeOf) * (nrEntries > 0 ? nrEntries : 1));
+	for (uint32_t e = 0; e < nrEntries; e++) {
+
+		nodeOf[e] = -1;
+	}
+	t -> nrRoots = nameIndexNrRoots(ix);
+	t -> roots = smalloc(sizeof(*t -> roots) * t -> nrRoots);
+	t -> rootPaths = smalloc(sizeof(*t -> rootPaths) * t -> nrRoots);
+	for (int i = 0; i < t -> nrRoots; i++) {
+
+		const char *path;
+		uint32_t e = nameIndexRoot(ix, i, &path);
+		t -> rootPaths[i] = smalloc(strlen(path) + 1);
+		strcpy(t -> rootPaths[i], path);
+		t -> roots[i] = watchAdd(t, -1, nameIndexEntryName(ix, e), 'd');
+		nodeOf[e] = t -> roots[i];
+	}
+	for (uint32_t e = 0; e < nrEntries; e++) {
+
+		uint32_t parent = nameIndexParent(ix, e);
+		if (nodeOf[e] < 0 && parent != NAMEINDEX_NO_PARENT &&
+			nodeOf[parent] >= 0) {
+
+			nodeOf[e] = watchAdd(t, nodeOf[parent], nameIndexEntryName(ix, e),
+								 nameIndexType(ix, e));
+		}
+	}
+	sfree(nodeOf);
+}
+
+/*
+* description: Frees all memory allocated by the tree, and closes its inotify
+* instance.
+* param[in]: t - The tree.
+*/
+static void watchKill (watchTree *t) {
+
+	for (int i = 0; i < t -> nrNodes; i++) {
+
+		sfree(t -> nodes[i].name);
+	}
+	for (int i = 0; i < t -> nrRoots; i++) {
+
+		sfree(t -> rootPaths[i]);
+	}
+	sfree(t -> nodes);
+	sfree(t -> buckets);
+	sfree(t -> wdNodes);
+	sfree(t -> roots);
+	sfree(t -> rootPaths);
+	sfree(t -> moves);
+	if (t -> fd >= 0) {
+
+		close(t -> fd);
+	}
+}
+
+/*
+* description: Watches the starting directories of an index, and rewrites the
+* index as they change, until interrupted by a signal (see INTERRUPTED).
+* param[in]: file - Path of the index, already built.
+* param[in]: rescan - Seconds between rescans of unwatched directories.
+* param[in]: interrupted - Set to non-zero by a signal handler, to stop.
+* return: If watching could start; 1, else 0 (a message is printed to stderr).
+*/
+int watchRun (const char *file, int rescan,
+			  volatile sig_atomic_t *interrupted) {
+
+	nameIndex *ix = nameIndexOpen(file);
+	if (ix == NULL) {
+
+		return 0;
+	}
+	watchTree t;
+	memset(&t, 0, sizeof(t));
+	t.freeList = -1;
+	t.bucketMask = 1023;
+	t.buckets = smalloc(sizeof(*t.buckets) * (t.bucketMask + 1));
+	for (unsigned int i = 0; i <= t.bucketMask; i++) {
+
+		t.buckets[i] = -1;
+	}
+	t.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (t.fd < 0) {
+
+		perror("inotify_init1");
+		nameIndexClose(ix);
+		watchKill(&t);
+		return 0;
+	}
+	watchLoad(&t, ix);
+	nameIndexClose(ix);
+	t.rescan = rescan;
+	for (int i = 0; i < t.nrNodes; i++) {
+
+		if (t.nodes[i].name != NULL && t.nodes[i].type == 'd') {
+
+			watchDir(&t, i);
+		}
+	}
+
+	time_t now = watchNow();
+	time_t lastEvent = now;
+	time_t lastFlush = now;
+	time_t lastRescan = now;
+	int res = 1;
+	while (!*interrupted) {
+
+		struct pollfd p = {t.fd, POLLIN, 0};
+		int ready = poll(&p, 1, 1000);
+		if (ready < 0 && errno != EINTR) {
+
+			perror("poll");
+			res = 0;
+			break;
+		}
+		now = watchNow();
+		if (ready > 0) {
+
+			if (!watchReadEvents(&t)) {
+
+				res = 0;
+				break;
+			}
+			lastEvent = now;
+		}
+		if (t.nrUnwatched > 0 && now - lastRescan >= rescan) {
+
+			watchRescanUnwatched(&t);
+			lastRescan = now;
+		}
+		if (t.dirty && (now - lastEvent >= WATCH_IDLE_FLUSH ||
+						now - lastFlush >= WATCH_MAX_FLUSH)) {
+
+			watchFlush(&t, file);
+			lastFlush = now;
+		}
+	}
+	if (t.dirty && !watchFlush(&t, file)) {
+
+		res = 0;
+	}
+	watchKill(&t);
+	return res;
+}
@@ -0,0 +1,42 @@
+/*
+* Watch mode. Keeps a name index up to date while the tree changes. The index
+* is first built by a normal search, then loaded into memory as a tree of
+* entries, with an inotify watch on every directory. Creates, deletes and
+* renames are applied to the tree as they happen, and the index file is
+* rewritten shortly after, so that --index queries always see a recent view.
+*
+* If the watch limit (fs.inotify.max_user_watches) is reached, directories
+* that could not be watched are rescanned periodically instead, along with
+* everything below them. If the event queue overflows, all starting
+* directories are rescanned.
+*
+* Author: mfind contributors
+*
+* Final build: 2026-10-17
+*/
+
+#ifndef __WATCH__
+#define __WATCH__
+
+#include <signal.h>
+
+/* Default seconds between rescans of directories that could not be watched	*/
+#define WATCH_DEFAULT_RESCAN 60
+
+/* Seconds without events before changes are written to the index, and the
+longest they are held back while events keep coming						*/
+#define WATCH_IDLE_FLUSH 1
+#define WATCH_MAX_FLUSH 5
+
+/*
+* description: Watches the starting directories of an index, and rewrites the
+* index as they change, until interrupted by a signal (see INTERRUPTED).
+* param[in]: file - Path of the index, already built.
+* param[in]: rescan - Seconds between rescans of unwatched directories.
+* param[in]: interrupted - Set to non-zero by a signal handler, to stop.
+* return: If watching could start; 1, else 0 (a message is printed to stderr).
+*/
+int watchRun (const char *file, int rescan,
+			  volatile sig_atomic_t *interrupted);
+
+#endif //__WATCH__